@@ -0,0 +1,118 @@
+/*
+ * SIS-IS Demo sort benchmark.
+ *
+ * Sorts packed user id keys, as built when sorting demo tables, with qsort
+ * and with radix sort for table sizes from 50 up to a maximum.  User ids are
+ * picked the way the shim picks them.  Both sorts must give the same order.
+ *
+ * Usage: bench_sort [max_rows]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "table.h"
+
+#define BENCH_DEFAULT_MAX_ROWS 10000000
+#define BENCH_MIN_KEYS_SORTED 20000000
+
+double elapsed(struct timespec * start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/** Fill keys with unique random user ids from a pool twice the size of the table, in row order. */
+int make_keys(uint64_t * keys, int rows)
+{
+	char * user_id_pool = calloc((size_t)rows * 2, 1);
+	if (user_id_pool == NULL)
+		return -1;
+	int i, user_id;
+	for (i = 0; i < rows; i++)
+	{
+		do {
+			user_id = (int)((((uint64_t)rand() << 31) | (uint64_t)rand()) % ((uint64_t)rows * 2));
+		} while (user_id_pool[user_id]);
+		user_id_pool[user_id] = 1;
+		keys[i] = ((uint64_t)((uint32_t)user_id ^ 0x80000000u) << 32) | (uint32_t)i;
+	}
+	free(user_id_pool);
+	return 0;
+}
+
+/** Time sorting copies of keys.  Small tables are sorted repeatedly.  Returns seconds per sort or -1 on error. */
+double time_sort(uint64_t * keys, uint64_t * out, int rows, int radix)
+{
+	int reps = BENCH_MIN_KEYS_SORTED / rows, rep;
+	if (reps < 1)
+		reps = 1;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (rep = 0; rep < reps; rep++)
+	{
+		memcpy(out, keys, sizeof(uint64_t) * rows);
+		if (radix)
+		{
+			if (radix_sort_keys(out, rows) == -1)
+				return -1;
+		}
+		else
+			qsort(out, rows, sizeof(uint64_t), table_sort_key_comparator);
+	}
+	return elapsed(&start) / reps;
+}
+
+int main(int argc, char ** argv)
+{
+	int max_rows = (argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_MAX_ROWS;
+	if (max_rows < 1 || max_rows > BENCH_DEFAULT_MAX_ROWS * 10)
+	{
+		fprintf(stderr, "Usage: %s [max_rows]\n", argv[0]);
+		return 2;
+	}
+
+	uint64_t * keys = malloc(sizeof(uint64_t) * max_rows);
+	uint64_t * qsorted = malloc(sizeof(uint64_t) * max_rows);
+	uint64_t * radix_sorted = malloc(sizeof(uint64_t) * max_rows);
+	if (keys == NULL || qsorted == NULL || radix_sorted == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 2;
+	}
+
+	srand(1);
+	printf("%10s %12s %12s %8s\n", "rows", "qsort (ms)", "radix (ms)", "speedup");
+	int rows = (max_rows < 50) ? max_rows : 50, mismatches = 0;
+	while (1)
+	{
+		if (make_keys(keys, rows) == -1)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 2;
+		}
+		double qsort_secs = time_sort(keys, qsorted, rows, 0);
+		double radix_secs = time_sort(keys, radix_sorted, rows, 1);
+		if (radix_secs < 0)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 2;
+		}
+		int same = memcmp(qsorted, radix_sorted, sizeof(uint64_t) * rows) == 0;
+		if (!same)
+			mismatches++;
+		printf("%10d %12.3f %12.3f %7.1fx%s\n", rows, qsort_secs * 1000, radix_secs * 1000, qsort_secs / radix_secs, same ? "" : "  MISMATCH");
+		if (rows == max_rows)
+			break;
+		rows = (rows > max_rows / 10) ? max_rows : rows * 10;
+	}
+
+	free(keys);
+	free(qsorted);
+	free(radix_sorted);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * SIS-IS Demo program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "chunk.h"
+
+// Next message id
+static uint32_t next_message_id = 0;
+
+/** Enlarge the receive buffer of a socket that will receive chunks. */
+void chunk_set_recv_buffer(int fd)
+{
+	// Forcing the size needs privileges, otherwise it is capped at rmem_max
+	int size = CHUNK_RECV_BUFFER_SIZE;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == -1)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+/** Send a non-empty message of up to CHUNK_MAX_MESSAGE_SIZE bytes split into chunks.  Returns -1 on failure. */
+int chunk_sendto(int fd, char * buf, int buflen, struct sockaddr * addr, socklen_t addr_size)
+{
+	if (buflen <= 0 || buflen > CHUNK_MAX_MESSAGE_SIZE)
+		return -1;
+
+	// Pick message id.  Start at a random point so a restarted sender does not reuse ids.
+	if (next_message_id == 0)
+		next_message_id = (uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16);
+	uint32_t id = __sync_fetch_and_add(&next_message_id, 1);
+
+	char chunk[CHUNK_SIZE];
+	*(uint32_t *)chunk = htonl(id);
+	*(uint32_t *)(chunk+8) = htonl((uint32_t)buflen);
+
+	// Send each chunk
+	uint32_t idx = 0;
+	int pos = 0;
+	while (pos < buflen)
+	{
+		int len = buflen - pos;
+		if (len > CHUNK_PAYLOAD_SIZE)
+			len = CHUNK_PAYLOAD_SIZE;
+		*(uint32_t *)(chunk+4) = htonl(idx);
+		memcpy(chunk+CHUNK_HEADER_SIZE, buf+pos, len);
+		if (sendto(fd, chunk, CHUNK_HEADER_SIZE+len, 0, addr, addr_size) == -1)
+			return -1;
+		pos += len;
+		idx++;
+	}
+
+	return 0;
+}
+
+/** Free a message being reassembled */
+static void chunk_message_free(chunk_message_t * message)
+{
+	free(message->buf);
+	free(message->received);
+	free(message);
+}
+
+/** Check if two senders are the same */
+static int chunk_same_sender(struct sockaddr_in6 * a, struct sockaddr_in6 * b)
+{
+	return a->sin6_port == b->sin6_port && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+}
+
+/**
+ * Add a received chunk.  Returns the length of the message once all of its
+ * chunks have been received and sets msg to it (caller frees), 0 if the
+ * message is still incomplete, or -1 if the chunk is invalid.  A new message
+ * from a sender discards any incomplete one from that sender.
+ */
+int chunk_receive(chunk_reassembler_t * reassembler, struct sockaddr_in6 * from, char * chunk, int len, char ** msg)
+{
+	// Parse header
+	if (len < CHUNK_HEADER_SIZE)
+		return -1;
+	uint32_t id = ntohl(*(uint32_t *)chunk);
+	uint32_t idx = ntohl(*(uint32_t *)(chunk+4));
+	uint32_t buflen = ntohl(*(uint32_t *)(chunk+8));
+	if (buflen == 0 || buflen > CHUNK_MAX_MESSAGE_SIZE)
+		return -1;
+	uint32_t chunks = (buflen + CHUNK_PAYLOAD_SIZE - 1) / CHUNK_PAYLOAD_SIZE;
+	uint32_t offset = idx * CHUNK_PAYLOAD_SIZE;
+	uint32_t payload_len = len - CHUNK_HEADER_SIZE;
+	if (idx >= chunks || payload_len != ((idx == chunks - 1) ? buflen - offset : CHUNK_PAYLOAD_SIZE))
+		return -1;
+
+	// Single chunk messages need no state
+	if (chunks == 1)
+	{
+		if ((*msg = malloc(buflen)) == NULL)
+			return -1;
+		memcpy(*msg, chunk+CHUNK_HEADER_SIZE, buflen);
+		return buflen;
+	}
+
+	// Find message from this sender
+	chunk_message_t ** prev = &reassembler->first;
+	chunk_message_t * message = reassembler->first;
+	while (message != NULL && !chunk_same_sender(&message->from, from))
+	{
+		prev = &message->next;
+		message = message->next;
+	}
+
+	// Drop incomplete message if this is a new one
+	if (message != NULL && (message->id != id || message->buflen != buflen))
+	{
+		*prev = message->next;
+		chunk_message_free(message);
+		message = NULL;
+	}
+
+	// Start new message
+	if (message == NULL)
+	{
+		if ((message = calloc(1, sizeof(*message))) == NULL)
+			return -1;
+		message->buf = malloc(buflen);
+		message->received = calloc((chunks + 7) / 8, 1);
+		if (message->buf == NULL || message->received == NULL)
+		{
+			chunk_message_free(message);
+			return -1;
+		}
+		message->from = *from;
+		message->id = id;
+		message->buflen = buflen;
+		message->chunks = chunks;
+		message->next = reassembler->first;
+		reassembler->first = message;
+		prev = &reassembler->first;
+	}
+
+	// Store chunk
+	if (!(message->received[idx / 8] & (1 << (idx % 8))))
+	{
+		message->received[idx / 8] |= 1 << (idx % 8);
+		message->chunks_received++;
+		memcpy(message->buf + offset, chunk+CHUNK_HEADER_SIZE, payload_len);
+	}
+	if (message->chunks_received < message->chunks)
+		return 0;
+
+	// Complete
+	*prev = message->next;
+	*msg = message->buf;
+	message->buf = NULL;
+	chunk_message_free(message);
+	return buflen;
+}
+
+/** Free all incomplete messages */
+void chunk_reassembler_free(chunk_reassembler_t * reassembler)
+{
+	chunk_message_t * message = reassembler->first, * next;
+	reassembler->first = NULL;
+	while (message != NULL)
+	{
+		next = message->next;
+		chunk_message_free(message);
+		message = next;
+	}
+}
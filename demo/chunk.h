@@ -0,0 +1,62 @@
+/*
+ * SIS-IS Demo program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Each chunk is a datagram with a header of message id, chunk index and
+// total message length (all 32-bit, network order) followed by up to
+// CHUNK_PAYLOAD_SIZE bytes of the message.
+#define CHUNK_HEADER_SIZE 12
+#define CHUNK_SIZE 8192
+#define CHUNK_PAYLOAD_SIZE (CHUNK_SIZE - CHUNK_HEADER_SIZE)
+
+// Largest message that will be sent or reassembled.  The shim's tables for
+// a million rows take about 21MB.
+#define CHUNK_MAX_MESSAGE_SIZE (64 << 20)
+
+// Socket receive buffer wanted so bursts of chunks are not dropped
+#define CHUNK_RECV_BUFFER_SIZE (16 << 20)
+
+/** Message being reassembled */
+typedef struct chunk_message {
+	struct sockaddr_in6 from;
+	uint32_t id;
+	char * buf;
+	uint32_t buflen;
+	uint32_t chunks;
+	uint32_t chunks_received;
+	unsigned char * received;	// Bitmap of received chunks
+	struct chunk_message * next;
+} chunk_message_t;
+
+/** Messages being reassembled, one per sender */
+typedef struct {
+	chunk_message_t * first;
+} chunk_reassembler_t;
+
+/** Enlarge the receive buffer of a socket that will receive chunks. */
+void chunk_set_recv_buffer(int fd);
+
+/** Send a non-empty message of up to CHUNK_MAX_MESSAGE_SIZE bytes split into chunks.  Returns -1 on failure. */
+int chunk_sendto(int fd, char * buf, int buflen, struct sockaddr * addr, socklen_t addr_size);
+
+/**
+ * Add a received chunk.  Returns the length of the message once all of its
+ * chunks have been received and sets msg to it (caller frees), 0 if the
+ * message is still incomplete, or -1 if the chunk is invalid.  A new message
+ * from a sender discards any incomplete one from that sender.
+ */
+int chunk_receive(chunk_reassembler_t * reassembler, struct sockaddr_in6 * from, char * chunk, int len, char ** msg);
+
+/** Free all incomplete messages */
+void chunk_reassembler_free(chunk_reassembler_t * reassembler);
+
+#endif
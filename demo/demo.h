@@ -38,7 +38,8 @@
   } while (0)
 #endif
 
-#define MAX_TABLE_SIZE 50
+// Rows in each table the shim generates unless told otherwise
+#define DEFAULT_TABLE_SIZE 50
 
 #define REDUNDANCY_PERCENTAGE 20
 #define MIN_NUM_PROCESSES 4
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <time.h>
 
@@ -22,6 +23,7 @@
 #include "join.h"
 #include "redundancy.h"
 #include "table.h"
+#include "chunk.h"
 
 #include "../remote_spawn/remote_spawn.h"
 #include "../tests/sisis_api.h"
@@ -31,6 +33,9 @@
 #ifndef MAX
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #endif
+#ifndef MIN
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#endif
 
 //#define PERCENT_WRONG_RESULTS 25
 #define PERCENT_WRONG_RESULTS 0
@@ -47,7 +52,9 @@ int main (int argc, char ** argv)
 {
 	// Setup list of tables
 	table1_group.first = NULL;
+	table1_group.arena.first = NULL;
 	table2_group.first = NULL;
+	table2_group.arena.first = NULL;
 	
 	// Set random seed
 	srand(time(NULL)*getpid());
@@ -63,38 +70,41 @@ void process_input(char * buf, int buflen)
 	if (table1_group.first == NULL)
 	{
 		// Table 1
-		cur_table1_item = malloc(sizeof(*cur_table1_item));
+		cur_table1_item = table_arena_alloc(&table1_group.arena, sizeof(*cur_table1_item));
 		table1_group.first = cur_table1_item;
 		// Table 2
-		cur_table2_item = malloc(sizeof(*cur_table2_item));
+		cur_table2_item = table_arena_alloc(&table2_group.arena, sizeof(*cur_table2_item));
 		table2_group.first = cur_table2_item;
 	}
 	else
 	{
 		// Table 1
-		cur_table1_item->next = malloc(sizeof(*cur_table1_item->next));
+		cur_table1_item->next = table_arena_alloc(&table1_group.arena, sizeof(*cur_table1_item->next));
 		cur_table1_item = cur_table1_item->next;
 		// Table 2
-		cur_table2_item->next = malloc(sizeof(*cur_table2_item->next));
+		cur_table2_item->next = table_arena_alloc(&table2_group.arena, sizeof(*cur_table2_item->next));
 		cur_table2_item = cur_table2_item->next;
 	}
 	
 	// Check memory
 	if (cur_table1_item == NULL || cur_table2_item == NULL)
 	{ printf("Out of memory.\n"); exit(0); }
-	cur_table1_item->table = malloc(sizeof(demo_table1_entry)*MAX_TABLE_SIZE);
 	cur_table1_item->next = NULL;
-	cur_table2_item->table = malloc(sizeof(demo_table2_entry)*MAX_TABLE_SIZE);
 	cur_table2_item->next = NULL;
 	
-	// Check memory
-	if (cur_table1_item->table == NULL || cur_table2_item->table == NULL)
+	// Allocate tables
+	demo_table1_t * table1 = table_arena_alloc(&table1_group.arena, sizeof(demo_table1_t));
+	demo_table2_t * table2 = table_arena_alloc(&table2_group.arena, sizeof(demo_table2_t));
+	if (table1 == NULL || table2 == NULL)
 	{ printf("Out of memory.\n"); exit(0); }
+	cur_table1_item->table = table1;
+	cur_table2_item->table = table2;
 	
 	// Deserialize
-	int bytes_used;
-	cur_table1_item->table_size = deserialize_table1(cur_table1_item->table, MAX_TABLE_SIZE, buf, buflen, &bytes_used);
-	cur_table2_item->table_size = deserialize_table2(cur_table2_item->table, MAX_TABLE_SIZE, buf+bytes_used, buflen-bytes_used, NULL);
+	int bytes_used = buflen;
+	if ((cur_table1_item->table_size = deserialize_table1(table1, &table1_group.arena, buf, buflen, &bytes_used)) == -1)
+		bytes_used = buflen;
+	cur_table2_item->table_size = deserialize_table2(table2, &table2_group.arena, buf+bytes_used, buflen-bytes_used, NULL);
 #ifdef DEBUG
 	printf("Table 1 Rows: %d\n", cur_table1_item->table_size);
 	printf("Table 2 Rows: %d\n", cur_table2_item->table_size);
@@ -112,7 +122,7 @@ void vote_and_process()
 	else
 	{
 		// Process tables
-		process_tables(table1_item->table, table1_item->table_size, table2_item->table, table2_item->table_size);
+		process_tables(table1_item->table, table2_item->table);
 	}
 	
 	// Clear tables
@@ -129,13 +139,16 @@ void flush_inputs()
 }
 
 /** Join tables and send result to voter processes. */
-void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2)
+void process_tables(demo_table1_t * table1, demo_table2_t * table2)
 {
 	int i;
 	
-	// Join
-	demo_merge_table_entry join_table[MAX_TABLE_SIZE];
-	int rows = merge_join(table1, rows1, table2, rows2, join_table, MAX_TABLE_SIZE);
+	// Join.  User ids are unique, so there are at most as many rows as in the smaller table.
+	table_arena_t arena = { NULL };
+	demo_merge_table_t join_table;
+	if (merge_table_init(&join_table, &arena, MAX(0, MIN(table1->size, table2->size)), table1->names) == -1)
+	{ printf("Out of memory.\n"); exit(0); }
+	int rows = merge_join(table1, table2, &join_table);
 	
 #ifdef DEBUG
 	// Print
@@ -145,7 +158,7 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 	{
 		printf("Joined Rows: %d\n", rows);
 		//for (i = 0; i < rows; i++)
-			//printf("User Id: %d\tName: %s\tGender: %c\n", join_table[i].user_id, join_table[i].name, join_table[i].gender);
+			//printf("User Id: %d\tName: %s\tGender: %c\n", join_table.user_id[i], table_name(join_table.names, join_table.name[i]), join_table.gender[i]);
 	}
 #endif
 
@@ -159,35 +172,33 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 		{
 			// Patrial table
 			case 0:
-				rows = rows - (rand() % rows) - 1;
+				join_table.size = rows = rows - (rand() % rows) - 1;
 				break;
 			// Corrupted data
 			case 1:
 				for (i = 0; i < rows; i++)
 				{
 					if (rand() % 6 == 0)
-						join_table[i].user_id = rand() % 1000000;
+						join_table.user_id[i] = rand() % 1000000;
 					if (rand() % 6 == 0)
-						join_table[i].gender = (join_table[i].gender == 'M') ? 'F' : 'M';
+						join_table.gender[i] = (join_table.gender[i] == 'M') ? 'F' : 'M';
+					// Names are shared with table 1, so swap in another row's name
 					if (rand() % 6 == 0)
-					{
-						int len = strlen(join_table[i].name);
-						int idx = len - 1;
-						while (idx > -1)
-						{
-							// Mess with a few characters
-							if (rand() % len < 3)
-								join_table[i].name[idx--] = (rand() % 26) + (rand() % 2 ? 'A' : 'a');
-						}
-					}
+						join_table.name[i] = join_table.name[rand() % rows];
 				}
 				break;
 		}
 	}
 	
 	// Serialize
-	char buf[SEND_BUFFER_SIZE];
-	int buflen = serialize_join_table(join_table, rows, buf, SEND_BUFFER_SIZE);
+	// A join error is sent as a row count of -1
+	size_t bufsize = TABLE_SERIALIZED_MAX_SIZE((size_t)MAX(0, rows), JOIN_TABLE_ROW_MAX_SIZE);
+	if (bufsize > INT_MAX)
+		bufsize = INT_MAX;
+	char * buf = malloc(bufsize);
+	int buflen = -1;
+	if (buf != NULL)
+		buflen = serialize_join_table(&join_table, buf, bufsize);
 	if (buflen == -1)
 		printf("Failed to serialize table.\n");
 	else
@@ -213,7 +224,7 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 				sockaddr.sin6_port = htons(VOTER_PORT);
 				sockaddr.sin6_addr = *remote_addr;
 				
-				if (sendto(sockfd, buf, buflen, 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+				if (chunk_sendto(sockfd, buf, buflen, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
 					printf("Failed to send message.  Error: %i\n", errno);
 			}
 			
@@ -221,4 +232,6 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 			FREE_LINKED_LIST(voter_addrs);
 		}
 	}
+	free(buf);
+	table_arena_free(&arena);
 }
\ No newline at end of file
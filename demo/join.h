@@ -13,6 +13,6 @@ void vote_and_process();
 void flush_inputs();
 
 /** Join tables and send result to voter processes. */
-void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2);
+void process_tables(demo_table1_t * table1, demo_table2_t * table2);
 
 #endif
@@ -23,6 +23,7 @@
 
 #include "demo.h"
 #include "redundancy.h"
+#include "chunk.h"
 
 #include "../remote_spawn/remote_spawn.h"
 #include "../tests/sisis_api.h"
@@ -253,6 +254,7 @@ void redundancy_main(uint64_t process_type, uint64_t process_type_version, int p
 		close_listener();
 		exit(2);
 	}
+	chunk_set_recv_buffer(sockfd);
 	
 	// Are we checking redundancy?
 	if (!(flags & REDUNDANCY_MAIN_FLAG_SKIP_REDUNDANCY))
@@ -304,6 +306,11 @@ void redundancy_main(uint64_t process_type, uint64_t process_type_version, int p
 	struct sockaddr_in6 remote_addr;
 	int buflen;
 	char buf[RECV_BUFFER_SIZE];
+	
+	// Inputs arriving in several chunks
+	chunk_reassembler_t reassembler = { NULL };
+	char * msg;
+	int msglen;
 	socklen_t addr_size = sizeof remote_addr;
 	while (1)
 	{
@@ -352,56 +359,66 @@ void redundancy_main(uint64_t process_type, uint64_t process_type_version, int p
 					// Read from socket
 					if ((buflen = recvfrom(sockfd, buf, RECV_BUFFER_SIZE, 0, (struct sockaddr *)&remote_addr, &addr_size)) != -1)
 					{
-#ifdef DEBUG
-						gettimeofday(&cur_time, NULL);
-						char addr[INET6_ADDRSTRLEN];
-						if (inet_ntop(AF_INET6, &(remote_addr.sin6_addr), addr, INET6_ADDRSTRLEN) != NULL)
-							fprintf(printf_file, "[%llu.%06llu] Input from %*s.\n", (uint64_t)cur_time.tv_sec, (uint64_t)cur_time.tv_usec, INET6_ADDRSTRLEN, addr);
-						fflush(printf_file);
-#endif
-						// Setup input
-						if (num_input == 0)
+						// Wait until all chunks of the input have arrived
+						msg = NULL;
+						if ((msglen = chunk_receive(&reassembler, &remote_addr, buf, buflen, &msg)) > 0)
 						{
-							// Set socket select timeout
-							select_timeout.tv_sec = GATHER_RESULTS_TIMEOUT_USEC / 1000000;
-							select_timeout.tv_usec = GATHER_RESULTS_TIMEOUT_USEC % 1000000;
-							
-							// Get start time
-							gettimeofday(&start_time, NULL);
-						}
-						else
-						{
-							// Determine new socket select timeout
+#ifdef DEBUG
 							gettimeofday(&cur_time, NULL);
-							timersub(&cur_time, &start_time, &tmp1);
-							timersub(&select_timeout, &tmp1, &tmp2);
-							select_timeout.tv_sec = tmp2.tv_sec;
-							select_timeout.tv_usec = tmp2.tv_usec;
-						}
-						
-						// Record input
-						num_input++;
-						
-						// Process the input
-						process_input(buf, buflen);
-						
-						// Check how many input processes there are
-						if (!(flags & REDUNDANCY_MAIN_FLAG_SINGLE_INPUT))
-						{
-							num_input_processes = get_process_type_count(input_process_type);
-			#ifdef DEBUG
-							fprintf(printf_file, "# inputs: %d\n", num_input);
-							fprintf(printf_file, "# input processes: %d\n", num_input_processes);
-							fprintf(printf_file, "Waiting %ld.%06ld seconds for more results.\n", (long)(select_timeout.tv_sec), (long)(select_timeout.tv_usec));
+							char addr[INET6_ADDRSTRLEN];
+							if (inet_ntop(AF_INET6, &(remote_addr.sin6_addr), addr, INET6_ADDRSTRLEN) != NULL)
+								fprintf(printf_file, "[%llu.%06llu] Input from %*s.\n", (uint64_t)cur_time.tv_sec, (uint64_t)cur_time.tv_usec, INET6_ADDRSTRLEN, addr);
 							fflush(printf_file);
-			#endif
+#endif
+							// Setup input
+							if (num_input == 0)
+							{
+								// Set socket select timeout
+								select_timeout.tv_sec = GATHER_RESULTS_TIMEOUT_USEC / 1000000;
+								select_timeout.tv_usec = GATHER_RESULTS_TIMEOUT_USEC % 1000000;
+								
+								// Get start time
+								gettimeofday(&start_time, NULL);
+							}
+							else
+							{
+								// Determine new socket select timeout
+								gettimeofday(&cur_time, NULL);
+								timersub(&cur_time, &start_time, &tmp1);
+								timersub(&select_timeout, &tmp1, &tmp2);
+								select_timeout.tv_sec = tmp2.tv_sec;
+								select_timeout.tv_usec = tmp2.tv_usec;
+							}
+							
+							// Record input
+							num_input++;
+							
+							// Process the input
+							process_input(msg, msglen);
+							free(msg);
+							
+							// Check how many input processes there are
+							if (!(flags & REDUNDANCY_MAIN_FLAG_SINGLE_INPUT))
+							{
+								num_input_processes = get_process_type_count(input_process_type);
+				#ifdef DEBUG
+								fprintf(printf_file, "# inputs: %d\n", num_input);
+								fprintf(printf_file, "# input processes: %d\n", num_input_processes);
+								fprintf(printf_file, "Waiting %ld.%06ld seconds for more results.\n", (long)(select_timeout.tv_sec), (long)(select_timeout.tv_usec));
+								fflush(printf_file);
+				#endif
+							}
 						}
 					}
 					
 					// Set of sockets for select call when waiting for other inputs
 					FD_ZERO(&socks);
 					FD_SET(sockfd, &socks);
-				} while(!(flags & REDUNDANCY_MAIN_FLAG_SINGLE_INPUT) && num_input < num_input_processes && select(sockfd+1, &socks, NULL, NULL, &select_timeout) > 0);
+				} while(num_input > 0 && !(flags & REDUNDANCY_MAIN_FLAG_SINGLE_INPUT) && num_input < num_input_processes && select(sockfd+1, &socks, NULL, NULL, &select_timeout) > 0);
+				
+				// Keep waiting if no input is complete yet
+				if (num_input == 0)
+					continue;
 				
 				// Check that at least 1/2 of the processes sent inputs
 				if (!(flags & REDUNDANCY_MAIN_FLAG_SINGLE_INPUT) && num_input <= num_input_processes/2)
@@ -448,41 +465,29 @@ int rib_monitor_add_ipv6_route(struct route_ipv6 * route, void * data)
 	// Make sure it is a host address
 	if (route->p->prefixlen == 128)
 	{
-		char addr[INET6_ADDRSTRLEN];
-		if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), addr, INET6_ADDRSTRLEN) != NULL)
+		// Check that this is an SIS-IS address of the current process type
+		struct in6_addr * addr = &route->p->prefix;
+		if (sisis_addr_is_sisis(addr) && sisis_addr_get_process_type(addr) == ptype && sisis_addr_get_process_version(addr) == ptype_version)
 		{
-			// Parse components
-			uint64_t prefix, sisis_version, process_type, process_version, sys_id, pid, ts;
-			if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &pid, &ts) == 0)
+			// Update current number of processes
+			pthread_mutex_lock(&num_processes_mutex);
+			if (num_processes == -1)
+				num_processes = get_process_type_version_count(ptype, ptype_version);
+			else
+				num_processes++;
+			pthread_mutex_unlock(&num_processes_mutex);
+			
+			// Set alarm to check redundancy in a little bit
+			struct itimerval itv;
+			// Check that there is a shorter timer already set
+			getitimer(ITIMER_REAL, &itv);
+			if ((itv.it_value.tv_sec == 0 && itv.it_value.tv_usec == 0) || itv.it_value.tv_sec * 1000000 + itv.it_value.tv_usec > RECHECK_PROCS_ALARM_DELAY)
 			{
-				// Check that this is an SIS-IS address
-				if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
-				{
-					// Check if this is the current process type
-					if (process_type == ptype && process_version == ptype_version)
-					{
-						// Update current number of processes
-						pthread_mutex_lock(&num_processes_mutex);
-						if (num_processes == -1)
-							num_processes = get_process_type_version_count(ptype, ptype_version);
-						else
-							num_processes++;
-						pthread_mutex_unlock(&num_processes_mutex);
-						
-						// Set alarm to check redundancy in a little bit
-						struct itimerval itv;
-						// Check that there is a shorter timer already set
-						getitimer(ITIMER_REAL, &itv);
-						if ((itv.it_value.tv_sec == 0 && itv.it_value.tv_usec == 0) || itv.it_value.tv_sec * 1000000 + itv.it_value.tv_usec > RECHECK_PROCS_ALARM_DELAY)
-						{
-							// Set timer
-							memset(&itv, 0, sizeof itv);
-							itv.it_value.tv_sec = INITIAL_CHECK_PROCS_ALARM_DELAY / 1000000;
-							itv.it_value.tv_usec = INITIAL_CHECK_PROCS_ALARM_DELAY % 1000000;
-							setitimer(ITIMER_REAL, &itv, NULL);
-						}
-					}
-				}
+				// Set timer
+				memset(&itv, 0, sizeof itv);
+				itv.it_value.tv_sec = INITIAL_CHECK_PROCS_ALARM_DELAY / 1000000;
+				itv.it_value.tv_usec = INITIAL_CHECK_PROCS_ALARM_DELAY % 1000000;
+				setitimer(ITIMER_REAL, &itv, NULL);
 			}
 		}
 	}
@@ -496,41 +501,29 @@ int rib_monitor_remove_ipv6_route(struct route_ipv6 * route, void * data)
 	// Make sure it is a host address
 	if (route->p->prefixlen == 128)
 	{
-		char addr[INET6_ADDRSTRLEN];
-		if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), addr, INET6_ADDRSTRLEN) != NULL)
+		// Check that this is an SIS-IS address of the current process type
+		struct in6_addr * addr = &route->p->prefix;
+		if (sisis_addr_is_sisis(addr) && sisis_addr_get_process_type(addr) == ptype && sisis_addr_get_process_version(addr) == ptype_version)
 		{
-			// Parse components
-			uint64_t prefix, sisis_version, process_type, process_version, sys_id, pid, ts;
-			if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &pid, &ts) == 0)
+			// Update current number of processes
+			pthread_mutex_lock(&num_processes_mutex);
+			if (num_processes == -1)
+				num_processes = get_process_type_version_count(ptype, ptype_version);
+			else
+				num_processes--;
+			pthread_mutex_unlock(&num_processes_mutex);
+			
+			// Set alarm to check redundancy in a little bit
+			struct itimerval itv;
+			// Check that there is a shorter timer already set
+			getitimer(ITIMER_REAL, &itv);
+			if ((itv.it_value.tv_sec == 0 && itv.it_value.tv_usec == 0) || itv.it_value.tv_sec * 1000000 + itv.it_value.tv_usec > RECHECK_PROCS_ALARM_DELAY)
 			{
-				// Check that this is an SIS-IS address
-				if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
-				{
-					// Check if this is the current process type
-					if (process_type == ptype && process_version == ptype_version)
-					{
-						// Update current number of processes
-						pthread_mutex_lock(&num_processes_mutex);
-						if (num_processes == -1)
-							num_processes = get_process_type_version_count(ptype, ptype_version);
-						else
-							num_processes--;
-						pthread_mutex_unlock(&num_processes_mutex);
-						
-						// Set alarm to check redundancy in a little bit
-						struct itimerval itv;
-						// Check that there is a shorter timer already set
-						getitimer(ITIMER_REAL, &itv);
-						if ((itv.it_value.tv_sec == 0 && itv.it_value.tv_usec == 0) || itv.it_value.tv_sec * 1000000 + itv.it_value.tv_usec > RECHECK_PROCS_ALARM_DELAY)
-						{
-							// Set timer
-							memset(&itv, 0, sizeof itv);
-							itv.it_value.tv_sec = INITIAL_CHECK_PROCS_ALARM_DELAY / 1000000;
-							itv.it_value.tv_usec = INITIAL_CHECK_PROCS_ALARM_DELAY % 1000000;
-							setitimer(ITIMER_REAL, &itv, NULL);
-						}
-					}
-				}
+				// Set timer
+				memset(&itv, 0, sizeof itv);
+				itv.it_value.tv_sec = INITIAL_CHECK_PROCS_ALARM_DELAY / 1000000;
+				itv.it_value.tv_usec = INITIAL_CHECK_PROCS_ALARM_DELAY % 1000000;
+				setitimer(ITIMER_REAL, &itv, NULL);
 			}
 		}
 	}
@@ -578,15 +571,13 @@ void check_redundancy()
 				struct in6_addr * remote_addr = (struct in6_addr *)node->data;
 				
 				// Parse components
-				char addr[INET6_ADDRSTRLEN];
 				uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-				if (inet_ntop(AF_INET6, remote_addr, addr, INET6_ADDRSTRLEN) != NULL)
-					if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
-						if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
-						{
-							do_startup = 0;
-							break;
-						}
+				if (get_sisis_in6_addr_components(remote_addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+					if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
+					{
+						do_startup = 0;
+						break;
+					}
 			}
 		}
 		
@@ -627,196 +618,188 @@ void check_redundancy()
 					// Get priority
 					desirable_hosts[i].priority = UINT64_MAX;
 					// Parse components
-					char addr[INET6_ADDRSTRLEN];
 					uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-					if (inet_ntop(AF_INET6, remote_addr, addr, INET6_ADDRSTRLEN) != NULL)
-						if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
-						{
-							desirable_hosts[i].priority = (sys_id == host_num ? 10000 : 0);
-							
-							// Try to find machine monitor for this host
+					if (get_sisis_in6_addr_components(remote_addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+					{
+						desirable_hosts[i].priority = (sys_id == host_num ? 10000 : 0);
+						
+						// Try to find machine monitor for this host
 #ifdef DEBUG
-							fprintf(printf_file, "Looking for machine monitor: ");
-							fflush(printf_file);
+						fprintf(printf_file, "Looking for machine monitor: ");
+						fflush(printf_file);
 #endif
-							struct in6_addr * mm_remote_addr = NULL;
-							if (monitor_addrs != NULL && monitor_addrs->size > 0)
+						struct in6_addr * mm_remote_addr = NULL;
+						if (monitor_addrs != NULL && monitor_addrs->size > 0)
+						{
+							struct listnode * mm_node;
+							LIST_FOREACH(monitor_addrs, mm_node)
 							{
-								struct listnode * mm_node;
-								LIST_FOREACH(monitor_addrs, mm_node)
+								struct in6_addr * remote_addr2 = (struct in6_addr *)mm_node->data;
+								
+								// Get system id
+								if (sisis_addr_get_sys_id(remote_addr2) == sys_id)
 								{
-									struct in6_addr * remote_addr2 = (struct in6_addr *)mm_node->data;
-									
-									// Get system id
-									uint64_t mm_sys_id;
-									if (inet_ntop(AF_INET6, remote_addr2, addr, INET6_ADDRSTRLEN) != NULL)
-										if (get_sisis_addr_components(addr, NULL, NULL, NULL, NULL, &mm_sys_id, NULL, NULL) == 0)
-											if (mm_sys_id == sys_id)
-											{
-												mm_remote_addr = remote_addr2;
-												break;
-											}
+									mm_remote_addr = remote_addr2;
+									break;
 								}
 							}
+						}
 #ifdef DEBUG
-							fprintf(printf_file, "%sFound\n", (mm_remote_addr == NULL) ? "Not " : "");
-							fflush(printf_file);
+						fprintf(printf_file, "%sFound\n", (mm_remote_addr == NULL) ? "Not " : "");
+						fflush(printf_file);
 #endif
-							// Check if there is the same process on this host
-							if (proc_addrs != NULL && proc_addrs->size > 0)
+						// Check if there is the same process on this host
+						if (proc_addrs != NULL && proc_addrs->size > 0)
+						{
+							struct listnode * proc_node;
+							LIST_FOREACH(proc_addrs, proc_node)
 							{
-								struct listnode * proc_node;
-								LIST_FOREACH(proc_addrs, proc_node)
-								{
-									struct in6_addr * remote_addr2 = (struct in6_addr *)proc_node->data;
-									
-									// Get system id
-									uint64_t proc_sys_id;
-									if (inet_ntop(AF_INET6, remote_addr2, addr, INET6_ADDRSTRLEN) != NULL)
-										if (get_sisis_addr_components(addr, NULL, NULL, NULL, NULL, &proc_sys_id, NULL, NULL) == 0)
-											if (proc_sys_id == sys_id)
-												desirable_hosts[i].priority += 1000;
-								}
+								struct in6_addr * remote_addr2 = (struct in6_addr *)proc_node->data;
+								
+								// Get system id
+								if (sisis_addr_get_sys_id(remote_addr2) == sys_id)
+									desirable_hosts[i].priority += 1000;
 							}
-							
-							// If there is no machine monitor, it is les desirable
-							if (mm_remote_addr == NULL)
-								desirable_hosts[i].priority += 200;
+						}
+						
+						// If there is no machine monitor, it is les desirable
+						if (mm_remote_addr == NULL)
+							desirable_hosts[i].priority += 200;
+						else
+						{
+							// Make new socket
+							int tmp_sock = make_socket(NULL);
+							if (tmp_sock == -1)
+								desirable_hosts[i].priority += 200;	// Error... penalize
 							else
 							{
-								// Make new socket
-								int tmp_sock = make_socket(NULL);
-								if (tmp_sock == -1)
+								// Set of sockets for select call
+								fd_set socks;
+								FD_ZERO(&socks);
+								FD_SET(tmp_sock, &socks);
+								
+								// Timeout information for select call
+								struct timeval select_timeout;
+								select_timeout.tv_sec = MACHINE_MONITOR_REQUEST_TIMEOUT / 1000000;
+								select_timeout.tv_usec = MACHINE_MONITOR_REQUEST_TIMEOUT % 1000000;
+								
+								// Set up socket info
+								struct sockaddr_in6 sockaddr;
+								int sockaddr_size = sizeof(sockaddr);
+								memset(&sockaddr, 0, sockaddr_size);
+								sockaddr.sin6_family = AF_INET6;
+								sockaddr.sin6_port = htons(MACHINE_MONITOR_PORT);
+								sockaddr.sin6_addr = *mm_remote_addr;
+#ifdef DEBUG
+								char tmp_addr_str[INET6_ADDRSTRLEN];
+								inet_ntop(AF_INET6, mm_remote_addr, tmp_addr_str, INET6_ADDRSTRLEN);
+								fprintf(printf_file, "Sending machine monitor request to %s.\n", tmp_addr_str);
+								fflush(printf_file);
+#endif
+								// Get memory stats
+								char * req = "data\n";
+								if (sendto(tmp_sock, req, strlen(req), 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+								{
+#ifdef DEBUG
+									fprintf(printf_file, "\tFailed to send machine monitor request.\n");
+									fflush(printf_file);
+#endif
 									desirable_hosts[i].priority += 200;	// Error... penalize
+								}
 								else
 								{
-									// Set of sockets for select call
-									fd_set socks;
-									FD_ZERO(&socks);
-									FD_SET(tmp_sock, &socks);
-									
-									// Timeout information for select call
-									struct timeval select_timeout;
-									select_timeout.tv_sec = MACHINE_MONITOR_REQUEST_TIMEOUT / 1000000;
-									select_timeout.tv_usec = MACHINE_MONITOR_REQUEST_TIMEOUT % 1000000;
-									
-									// Set up socket info
-									struct sockaddr_in6 sockaddr;
-									int sockaddr_size = sizeof(sockaddr);
-									memset(&sockaddr, 0, sockaddr_size);
-									sockaddr.sin6_family = AF_INET6;
-									sockaddr.sin6_port = htons(MACHINE_MONITOR_PORT);
-									sockaddr.sin6_addr = *mm_remote_addr;
 #ifdef DEBUG
-									char tmp_addr_str[INET6_ADDRSTRLEN];
-									inet_ntop(AF_INET6, mm_remote_addr, tmp_addr_str, INET6_ADDRSTRLEN);
-									fprintf(printf_file, "Sending machine monitor request to %s.\n", tmp_addr_str);
+									fprintf(printf_file, "\tSent machine monitor request.  Waiting for response...\n");
 									fflush(printf_file);
 #endif
-									// Get memory stats
-									char * req = "data\n";
-									if (sendto(tmp_sock, req, strlen(req), 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+									struct sockaddr_in6 fromaddr;
+									int fromaddr_size = sizeof(fromaddr);
+									memset(&fromaddr, 0, fromaddr_size);
+									char buf[65536];
+									int len;
+									
+									// Wait for response
+									if (select(tmp_sock+1, &socks, NULL, NULL, &select_timeout) <= 0)
 									{
 #ifdef DEBUG
-										fprintf(printf_file, "\tFailed to send machine monitor request.\n");
+										fprintf(printf_file, "\tMachine monitor request timed out.\n");
 										fflush(printf_file);
 #endif
 										desirable_hosts[i].priority += 200;	// Error... penalize
 									}
-									else
+									else if ((len = recvfrom(tmp_sock, buf, 65536, 0, (struct sockaddr *)&fromaddr, &fromaddr_size)) < 1)
 									{
 #ifdef DEBUG
-										fprintf(printf_file, "\tSent machine monitor request.  Waiting for response...\n");
+										fprintf(printf_file, "\tFailed to receive machine monitor response.\n");
 										fflush(printf_file);
 #endif
-										struct sockaddr_in6 fromaddr;
-										int fromaddr_size = sizeof(fromaddr);
-										memset(&fromaddr, 0, fromaddr_size);
-										char buf[65536];
-										int len;
-										
-										// Wait for response
-										if (select(tmp_sock+1, &socks, NULL, NULL, &select_timeout) <= 0)
-										{
-#ifdef DEBUG
-											fprintf(printf_file, "\tMachine monitor request timed out.\n");
-											fflush(printf_file);
-#endif
-											desirable_hosts[i].priority += 200;	// Error... penalize
-										}
-										else if ((len = recvfrom(tmp_sock, buf, 65536, 0, (struct sockaddr *)&fromaddr, &fromaddr_size)) < 1)
-										{
-#ifdef DEBUG
-											fprintf(printf_file, "\tFailed to receive machine monitor response.\n");
-											fflush(printf_file);
-#endif
-											desirable_hosts[i].priority += 200;	// Error... penalize
-										}
-										else if (sockaddr_size != fromaddr_size || memcmp(&sockaddr, &fromaddr, fromaddr_size) != 0)
-										{
+										desirable_hosts[i].priority += 200;	// Error... penalize
+									}
+									else if (sockaddr_size != fromaddr_size || memcmp(&sockaddr, &fromaddr, fromaddr_size) != 0)
+									{
 #ifdef DEBUG
-											inet_ntop(AF_INET6, &((struct sockaddr_in6 *)&fromaddr)->sin6_addr, tmp_addr_str, INET6_ADDRSTRLEN);
-											fprintf(printf_file, "\tFailed to receive machine monitor response.  Response from wrong host (%s).\n", tmp_addr_str);
-											fflush(printf_file);
+										inet_ntop(AF_INET6, &((struct sockaddr_in6 *)&fromaddr)->sin6_addr, tmp_addr_str, INET6_ADDRSTRLEN);
+										fprintf(printf_file, "\tFailed to receive machine monitor response.  Response from wrong host (%s).\n", tmp_addr_str);
+										fflush(printf_file);
 #endif
-											desirable_hosts[i].priority += 200;	// Error... penalize
-										}
+										desirable_hosts[i].priority += 200;	// Error... penalize
+									}
+									else
+									{
+										// Terminate if needed
+										if (len == 65536)
+											buf[len-1] = '\0';
+										
+										// Parse response
+										char * match;
+										
+										// Get memory usage
+										char * mem_usage_str = "MemoryUsage: ";
+										if ((match = strstr(buf, mem_usage_str)) == NULL)
+											desirable_hosts[i].priority += 100;	// Error... penalize
 										else
 										{
-											// Terminate if needed
-											if (len == 65536)
-												buf[len-1] = '\0';
-											
-											// Parse response
-											char * match;
-											
-											// Get memory usage
-											char * mem_usage_str = "MemoryUsage: ";
-											if ((match = strstr(buf, mem_usage_str)) == NULL)
-												desirable_hosts[i].priority += 100;	// Error... penalize
-											else
+											// Get usage
+											int usage;
+											if (sscanf(match+strlen(mem_usage_str), "%d%%", &usage))
 											{
-												// Get usage
-												int usage;
-												if (sscanf(match+strlen(mem_usage_str), "%d%%", &usage))
-												{
 #ifdef DEBUG
-													fprintf(printf_file, "\tMemory Usage = %d%%\n", usage);
-													fflush(printf_file);
+												fprintf(printf_file, "\tMemory Usage = %d%%\n", usage);
+												fflush(printf_file);
 #endif
-													desirable_hosts[i].priority += usage;
-												}
-												else
-													desirable_hosts[i].priority += 100;	// Error... penalize
+												desirable_hosts[i].priority += usage;
 											}
-											
-											// Get CPU usage
-											char * cpu_usage_str = "CPU: ";
-											if ((match = strstr(buf, cpu_usage_str)) == NULL)
-												desirable_hosts[i].priority += 100;	// Error... penalize
 											else
+												desirable_hosts[i].priority += 100;	// Error... penalize
+										}
+										
+										// Get CPU usage
+										char * cpu_usage_str = "CPU: ";
+										if ((match = strstr(buf, cpu_usage_str)) == NULL)
+											desirable_hosts[i].priority += 100;	// Error... penalize
+										else
+										{
+											// Get usage
+											int usage;
+											if (sscanf(match+strlen(cpu_usage_str), "%d%%", &usage))
 											{
-												// Get usage
-												int usage;
-												if (sscanf(match+strlen(cpu_usage_str), "%d%%", &usage))
-												{
 #ifdef DEBUG
-													fprintf(printf_file, "\tCPU Usage = %d%%\n", usage);
-													fflush(printf_file);
+												fprintf(printf_file, "\tCPU Usage = %d%%\n", usage);
+												fflush(printf_file);
 #endif
-													desirable_hosts[i].priority += usage;
-												}
-												else
-													desirable_hosts[i].priority += 100;	// Error... penalize
+												desirable_hosts[i].priority += usage;
 											}
+											else
+												desirable_hosts[i].priority += 100;	// Error... penalize
 										}
 									}
-									
-									// Close socket
-									close(tmp_sock);
 								}
+								
+								// Close socket
+								close(tmp_sock);
 							}
 						}
+					}
 					
 					i++;
 				}
@@ -926,62 +909,60 @@ void check_redundancy()
 				struct in6_addr * remote_addr = (struct in6_addr *)node->data;
 				
 				// Parse components
-				char addr[INET6_ADDRSTRLEN];
 				uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-				if (inet_ntop(AF_INET6, remote_addr, addr, INET6_ADDRSTRLEN) != NULL)
-					if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
-						// TODO: Maybe if there have the same timestamp, first kill duplicates on the same host
-						// TODO: Create list, sort by timestamp, host_num, pid
-						// Count # of addresses priors to this one in the list, ignoring extra processes on the same host.
-						// If there are num_procs processes and this is the first process on the host: Stay alive
-						if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
-							if (++younger_procs == num_procs)
+				if (get_sisis_in6_addr_components(remote_addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+					// TODO: Maybe if there have the same timestamp, first kill duplicates on the same host
+					// TODO: Create list, sort by timestamp, host_num, pid
+					// Count # of addresses priors to this one in the list, ignoring extra processes on the same host.
+					// If there are num_procs processes and this is the first process on the host: Stay alive
+					if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
+						if (++younger_procs == num_procs)
+						{
+							// TODO: In first 1.1 seconds, give second chance to avoid OSPF issues
+							struct timeval tv, tv2, tv3;
+							gettimeofday(&tv, NULL);
+							timersub(&tv, &timestamp_sisis_registered, &tv2);
+							if (tv2.tv_sec < 1 || (tv2.tv_sec == 1 && tv2.tv_usec < 100000))
 							{
-								// TODO: In first 1.1 seconds, give second chance to avoid OSPF issues
-								struct timeval tv, tv2, tv3;
+								tv.tv_sec = 1;
+								tv.tv_usec = 100000;
+								timersub(&tv, &tv2, &tv3);
+								struct timespec sleep_time, rem_sleep_time;
+								sleep_time.tv_sec = tv3.tv_sec;
+								sleep_time.tv_nsec = tv3.tv_usec * 1000;
+								// Sleep
+								while (nanosleep(&sleep_time, &rem_sleep_time) == -1)
+								{
+									if (errno == EINTR)
+										memcpy(&sleep_time, &rem_sleep_time, sizeof rem_sleep_time);
+									else
+										break;
+								}
+								// Busy wait as last resort
 								gettimeofday(&tv, NULL);
 								timersub(&tv, &timestamp_sisis_registered, &tv2);
 								if (tv2.tv_sec < 1 || (tv2.tv_sec == 1 && tv2.tv_usec < 100000))
 								{
-									tv.tv_sec = 1;
-									tv.tv_usec = 100000;
-									timersub(&tv, &tv2, &tv3);
-									struct timespec sleep_time, rem_sleep_time;
-									sleep_time.tv_sec = tv3.tv_sec;
-									sleep_time.tv_nsec = tv3.tv_usec * 1000;
-									// Sleep
-									while (nanosleep(&sleep_time, &rem_sleep_time) == -1)
+									do
 									{
-										if (errno == EINTR)
-											memcpy(&sleep_time, &rem_sleep_time, sizeof rem_sleep_time);
-										else
-											break;
-									}
-									// Busy wait as last resort
-									gettimeofday(&tv, NULL);
-									timersub(&tv, &timestamp_sisis_registered, &tv2);
-									if (tv2.tv_sec < 1 || (tv2.tv_sec == 1 && tv2.tv_usec < 100000))
-									{
-										do
-										{
-											gettimeofday(&tv, NULL);
-											timersub(&tv, &timestamp_sisis_registered, &tv2);
-										} while (tv2.tv_sec < 1 || (tv2.tv_sec == 1 && tv2.tv_usec < 100000));
-									}
-									
-									// Recheck
-									check_redundancy();
-									
-									break;
+										gettimeofday(&tv, NULL);
+										timersub(&tv, &timestamp_sisis_registered, &tv2);
+									} while (tv2.tv_sec < 1 || (tv2.tv_sec == 1 && tv2.tv_usec < 100000));
 								}
 								
+								// Recheck
+								check_redundancy();
+								
+								break;
+							}
+							
 #ifdef DEBUG
-								fprintf(printf_file, "Terminating...\n");
-								fflush(printf_file);
+							fprintf(printf_file, "Terminating...\n");
+							fflush(printf_file);
 #endif
-								close_listener();
-								exit(0);
-							}
+							close_listener();
+							exit(0);
+						}
 			}
 		}
 	}
@@ -14,12 +14,14 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <time.h>
 
 #include "demo.h"
 #include "shim.h"
 #include "table.h"
+#include "chunk.h"
 
 #include "../tests/sisis_api.h"
 #include "../tests/sisis_process_types.h"
@@ -55,7 +57,7 @@ int main (int argc, char ** argv)
 	// Check number of args
 	if (argc <  2)
 	{
-		printf("Usage: %s <host_num> [<interval>]\n", argv[0]);
+		printf("Usage: %s <host_num> [<interval> [<rows>]]\n", argv[0]);
 		exit(1);
 	}
 	
@@ -67,6 +69,26 @@ int main (int argc, char ** argv)
 	if (argc >= 3)
 		sscanf(argv[2], "%u", &sleep_time);
 	
+	// Table size
+	int rows = DEFAULT_TABLE_SIZE;
+	if (argc >= 4 && (sscanf(argv[3], "%d", &rows) != 1 || rows < 1 || rows > INT_MAX / 2))
+	{
+		printf("Invalid number of rows.\n");
+		exit(1);
+	}
+	
+	// Tables are allocated from an arena freed after each round.  User ids are picked from a pool twice the size of the table.
+	table_arena_t arena = { NULL };
+	table_names_t names;
+	demo_table1_t table1;
+	demo_table2_t table2;
+	char * user_id_pool = malloc(rows * 2);
+	if (user_id_pool == NULL)
+	{
+		printf("Out of memory.\n");
+		exit(1);
+	}
+	
 	// Set up signal handling
 	signal(SIGABRT, terminate);
 	signal(SIGTERM, terminate);
@@ -136,48 +158,58 @@ int main (int argc, char ** argv)
 	{
 		// Create random tables
 		int i;
+		table_arena_free(&arena);
+		if (table_names_init(&names, &arena, rows, (size_t)rows * sizeof("User #2147483647")) == -1
+			|| table1_init(&table1, &arena, rows, &names) == -1 || table2_init(&table2, &arena, rows) == -1)
+		{
+			printf("Out of memory.\n");
+			exit(1);
+		}
 		
 		// Table 1
 		printf("Building table 1...\n");
-		demo_table1_entry table1[MAX_TABLE_SIZE];
-		short user_id_pool[100];
-		for (i = 0; i < 100; i++)
-			user_id_pool[i] = 0;
-		for (i = 0; i < MAX_TABLE_SIZE; i++)
+		memset(user_id_pool, 0, rows * 2);
+		for (i = 0; i < rows; i++)
 		{
 			do {
-				table1[i].user_id = rand() % 100;
-			} while (user_id_pool[table1[i].user_id]);
-			user_id_pool[table1[i].user_id] = 1;
+				table1.user_id[i] = rand() % (rows * 2);
+			} while (user_id_pool[table1.user_id[i]]);
+			user_id_pool[table1.user_id[i]] = 1;
 			
-			sprintf(table1[i].name, "User #%d", i+1);
+			char name[TABLE1_NAME_LEN];
+			int len = snprintf(name, sizeof(name), "User #%d", i+1);
+			table1.name[i] = table_names_add(&names, name, len);
 		}
+		table1.size = rows;
 		
 		// Table 2
 		printf("Building table 2...\n");
-		demo_table2_entry table2[MAX_TABLE_SIZE];
-		for (i = 0; i < 100; i++)
-			user_id_pool[i] = 0;
-		for (i = 0; i < MAX_TABLE_SIZE; i++)
+		memset(user_id_pool, 0, rows * 2);
+		for (i = 0; i < rows; i++)
 		{
 			do {
-				table2[i].user_id = rand() % 100;
-			} while (user_id_pool[table2[i].user_id]);
-			user_id_pool[table2[i].user_id] = 1;
+				table2.user_id[i] = rand() % (rows * 2);
+			} while (user_id_pool[table2.user_id[i]]);
+			user_id_pool[table2.user_id[i]] = 1;
 			
-			table2[i].gender = (i % 3) ? 'M' : 'F';
+			table2.gender[i] = (i % 3) ? 'M' : 'F';
 		}
+		table2.size = rows;
 		
 		// Send real result to voter
-		send_real_result_to_voter(table1, MAX_TABLE_SIZE, table2, MAX_TABLE_SIZE);
+		send_real_result_to_voter(&table1, &table2);
 		
 		// Serialize
 		printf("Serializing...\n");
-		char buf[RECV_BUFFER_SIZE];
-		int buflen, buflen2;
-		buflen = serialize_table1(table1, MAX_TABLE_SIZE, buf, RECV_BUFFER_SIZE);
+		size_t bufsize = TABLE_SERIALIZED_MAX_SIZE((size_t)rows, TABLE1_ROW_MAX_SIZE) + TABLE_SERIALIZED_MAX_SIZE((size_t)rows, TABLE2_ROW_MAX_SIZE);
+		if (bufsize > INT_MAX)
+			bufsize = INT_MAX;
+		char * buf = malloc(bufsize);
+		int buflen = -1, buflen2 = -1;
+		if (buf != NULL)
+			buflen = serialize_table1(&table1, buf, bufsize);
 		if (buflen != -1)
-			buflen2 = serialize_table2(table2, MAX_TABLE_SIZE, buf+buflen, RECV_BUFFER_SIZE - buflen);
+			buflen2 = serialize_table2(&table2, buf+buflen, bufsize - buflen);
 		if (buflen == -1 || buflen2 == -1)
 			printf("Failed to serialize tables.\n");
 		else
@@ -208,7 +240,7 @@ int main (int argc, char ** argv)
 					sockaddr.sin6_addr = *remote_addr;
 					
 					printf("Sending data to sort process...\n");
-					if (sendto(sockfd, buf, buflen+buflen2, 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+					if (chunk_sendto(sockfd, buf, buflen+buflen2, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
 						printf("Failed to send message.  Error: %i\n", errno);
 				}
 				
@@ -216,6 +248,7 @@ int main (int argc, char ** argv)
 				FREE_LINKED_LIST(sort_addrs);
 			}
 		}
+		free(buf);
 		
 		// Sleep
 		sleep(sleep_time);
@@ -226,19 +259,31 @@ int main (int argc, char ** argv)
 		close(sockfd);
 }
 
-void send_real_result_to_voter(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2)
+void send_real_result_to_voter(demo_table1_t * table1, demo_table2_t * table2)
 {
 	// Sort tables
-	sort_table1_by_user_id(table1, rows1);
-	sort_table2_by_user_id(table2, rows2);
+	sort_table1_by_user_id(table1);
+	sort_table2_by_user_id(table2);
 	
-	// Join
-	demo_merge_table_entry join_table[MAX_TABLE_SIZE];
-	int rows = merge_join(table1, rows1, table2, rows2, join_table, MAX_TABLE_SIZE);
+	// Join.  User ids are unique, so there are at most as many rows as in the smaller table.
+	table_arena_t arena = { NULL };
+	demo_merge_table_t join_table;
+	if (merge_table_init(&join_table, &arena, (table1->size < table2->size) ? table1->size : table2->size, table1->names) == -1)
+	{
+		printf("Out of memory.\n");
+		return;
+	}
+	int rows = merge_join(table1, table2, &join_table);
 	
 	// Serialize
-	char buf[SEND_BUFFER_SIZE];
-	int buflen = serialize_join_table(join_table, rows, buf, SEND_BUFFER_SIZE);
+	// A join error is sent as a row count of -1
+	size_t bufsize = TABLE_SERIALIZED_MAX_SIZE((size_t)((rows < 0) ? 0 : rows), JOIN_TABLE_ROW_MAX_SIZE);
+	if (bufsize > INT_MAX)
+		bufsize = INT_MAX;
+	char * buf = malloc(bufsize);
+	int buflen = -1;
+	if (buf != NULL)
+		buflen = serialize_join_table(&join_table, buf, bufsize);
 	if (buflen == -1)
 		printf("Failed to serialize table.\n");
 	else
@@ -264,7 +309,7 @@ void send_real_result_to_voter(demo_table1_entry * table1, int rows1, demo_table
 				sockaddr.sin6_port = htons(VOTER_ANSWER_PORT);
 				sockaddr.sin6_addr = *remote_addr;
 				
-				if (sendto(sockfd, buf, buflen, 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+				if (chunk_sendto(sockfd, buf, buflen, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
 					printf("Failed to send message.  Error: %i\n", errno);
 			}
 			
@@ -272,4 +317,6 @@ void send_real_result_to_voter(demo_table1_entry * table1, int rows1, demo_table
 			FREE_LINKED_LIST(voter_addrs);
 		}
 	}
+	free(buf);
+	table_arena_free(&arena);
 }
\ No newline at end of file
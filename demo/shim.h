@@ -3,6 +3,6 @@
 
 #include "table.h"
 
-void send_real_result_to_voter(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2);
+void send_real_result_to_voter(demo_table1_t * table1, demo_table2_t * table2);
 
 #endif
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include <time.h>
 
@@ -21,26 +23,36 @@
 #include "sort.h"
 #include "redundancy.h"
 #include "table.h"
+#include "chunk.h"
 
 #include "../tests/sisis_api.h"
 #include "../tests/sisis_process_types.h"
 
-#ifdef BUBBLE_SORT
+#ifndef MAX
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
+#if defined(PARALLEL_SORT)
+	#define VERSION 4
+#elif defined(RADIX_SORT)
+	#define VERSION 3
+#elif defined(BUBBLE_SORT)
 	#define VERSION 2
 #else
 	#define VERSION 1
 #endif
 
 // Setup tables
-// We only need one set of tables since there is a single shim
-demo_table1_entry table1[MAX_TABLE_SIZE];
-int table1_size;
-demo_table2_entry table2[MAX_TABLE_SIZE];
-int table2_size;
+// We only need one set of tables since there is a single shim.  They are allocated from an arena freed on each input.
+table_arena_t table_arena = { NULL };
+demo_table1_t table1;
+demo_table2_t table2;
 
 /** Bubble sort */
 void bubble_sort(void * base, size_t num, size_t size, int (*comparator) (const void *, const void *))
 {
+	if (num < 2)
+		return;
 	void * swap_elem = malloc(size);
 	size_t i;
 	short swapped;
@@ -59,10 +71,166 @@ void bubble_sort(void * base, size_t num, size_t size, int (*comparator) (const
 			}
 		}
 	}while (swapped);
+	free(swap_elem);
+}
+
+// Worker pool for parallel sorting.  The calling thread is thread 0 and there
+// are num_threads-1 workers.  Each thread radix sorts a slice of the keys.
+static struct {
+	int num_threads;
+	pthread_t * workers;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_barrier_t barrier;
+	unsigned long generation;	// Incremented for each sort
+	uint64_t * keys;
+	uint64_t * tmp;
+	int size;
+	uint32_t * counts;	// Digit counts for each pass, thread and bucket
+} sort_pool = {
+	.num_threads = 1,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+};
+
+#define SORT_POOL_COUNTS(pass, thread) (sort_pool.counts + ((pass) * sort_pool.num_threads + (thread)) * TABLE_RADIX_BUCKETS)
+
+/**
+ * Sort thread's part of the current keys.  Each pass, every thread counts
+ * the digits in its slice, then moves its keys after those of the same digit
+ * from lower slices, so the sort is stable like the sequential one.
+ */
+static void parallel_sort_slice(int thread)
+{
+	int num_threads = sort_pool.num_threads, size = sort_pool.size;
+	int lo = (int)((int64_t)size * thread / num_threads);
+	int hi = (int)((int64_t)size * (thread + 1) / num_threads);
+	uint64_t * src = sort_pool.keys, * dst = sort_pool.tmp, * swap;
+	uint32_t offsets[TABLE_RADIX_BUCKETS];
+	int i, t, pass;
+	for (pass = 0; pass < TABLE_RADIX_PASSES; pass++)
+	{
+		int shift = 32 + pass * TABLE_RADIX_BITS;
+		
+		// Count digits in slice
+		uint32_t * count = SORT_POOL_COUNTS(pass, thread);
+		memset(count, 0, sizeof(uint32_t) * TABLE_RADIX_BUCKETS);
+		for (i = lo; i < hi; i++)
+			count[(src[i] >> shift) & (TABLE_RADIX_BUCKETS - 1)]++;
+		pthread_barrier_wait(&sort_pool.barrier);
+		
+		// Skip digits that are the same for every key.  All threads see the same counts.
+		uint32_t same = 0, d = (src[0] >> shift) & (TABLE_RADIX_BUCKETS - 1);
+		for (t = 0; t < num_threads; t++)
+			same += SORT_POOL_COUNTS(pass, t)[d];
+		if (same == (uint32_t)size)
+			continue;
+		
+		// Find where this slice's keys go
+		uint32_t pos = 0;
+		for (d = 0; d < TABLE_RADIX_BUCKETS; d++)
+			for (t = 0; t < num_threads; t++)
+			{
+				if (t == thread)
+					offsets[d] = pos;
+				pos += SORT_POOL_COUNTS(pass, t)[d];
+			}
+		
+		for (i = lo; i < hi; i++)
+			dst[offsets[(src[i] >> shift) & (TABLE_RADIX_BUCKETS - 1)]++] = src[i];
+		pthread_barrier_wait(&sort_pool.barrier);
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	
+	// Copy back if the last pass left the keys in the temporary buffer
+	if (src != sort_pool.keys)
+		memcpy(sort_pool.keys + lo, src + lo, sizeof(uint64_t) * (hi - lo));
+	pthread_barrier_wait(&sort_pool.barrier);
+}
+
+/** Sort pool worker */
+static void * parallel_sort_worker(void * arg)
+{
+	int thread = (int)(long)arg;
+	unsigned long seen = 0;
+	while (1)
+	{
+		// Wait for keys to sort
+		pthread_mutex_lock(&sort_pool.lock);
+		while (sort_pool.generation == seen)
+			pthread_cond_wait(&sort_pool.start, &sort_pool.lock);
+		seen = sort_pool.generation;
+		pthread_mutex_unlock(&sort_pool.lock);
+		
+		parallel_sort_slice(thread);
+	}
+	return NULL;
+}
+
+/** Start the parallel sort worker pool.  Uses one thread per CPU if num_threads < 1.  Returns the number of threads sorting. */
+int parallel_sort_init(int num_threads)
+{
+	if (num_threads < 1)
+		num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads > PARALLEL_SORT_MAX_THREADS)
+		num_threads = PARALLEL_SORT_MAX_THREADS;
+	if (num_threads < 2 || sort_pool.workers != NULL)
+		return sort_pool.num_threads;
+	
+	sort_pool.workers = malloc(sizeof(pthread_t) * num_threads);
+	sort_pool.counts = malloc(sizeof(uint32_t) * TABLE_RADIX_PASSES * num_threads * TABLE_RADIX_BUCKETS);
+	if (sort_pool.workers == NULL || sort_pool.counts == NULL)
+	{
+		free(sort_pool.workers);
+		free(sort_pool.counts);
+		sort_pool.workers = NULL;
+		sort_pool.counts = NULL;
+		return sort_pool.num_threads;
+	}
+	
+	// Use as many workers as could be started
+	long t;
+	for (t = 1; t < num_threads; t++)
+		if (pthread_create(&sort_pool.workers[t], NULL, parallel_sort_worker, (void *)t) != 0)
+			break;
+	sort_pool.num_threads = (int)t;
+	pthread_barrier_init(&sort_pool.barrier, NULL, sort_pool.num_threads);
+	return sort_pool.num_threads;
+}
+
+/** Sort packed keys with the worker pool.  Gives the same order as radix_sort_keys.  Returns -1 if out of memory. */
+int parallel_sort_keys(uint64_t * keys, int size)
+{
+	// Small tables are not worth waking the workers for
+	if (sort_pool.num_threads < 2 || size < PARALLEL_SORT_MIN_ROWS)
+		return radix_sort_keys(keys, size);
+	
+	uint64_t * tmp = malloc(sizeof(uint64_t) * size);
+	if (tmp == NULL)
+		return -1;
+	
+	// Start workers and sort the first slice
+	pthread_mutex_lock(&sort_pool.lock);
+	sort_pool.keys = keys;
+	sort_pool.tmp = tmp;
+	sort_pool.size = size;
+	sort_pool.generation++;
+	pthread_cond_broadcast(&sort_pool.start);
+	pthread_mutex_unlock(&sort_pool.lock);
+	parallel_sort_slice(0);
+	
+	free(tmp);
+	return 0;
 }
 
 int main (int argc, char ** argv)
 {
+#ifdef PARALLEL_SORT
+	printf("Sorting with %d threads.\n", parallel_sort_init(0));
+#endif
+	
 	// Start main loop
 	redundancy_main((uint64_t)SISIS_PTYPE_DEMO1_SORT, (uint64_t)VERSION, SORT_PORT, 0, process_input, vote_and_process, NULL, REDUNDANCY_MAIN_FLAG_SINGLE_INPUT, argc, argv);
 }
@@ -70,13 +238,21 @@ int main (int argc, char ** argv)
 /** Process input from a single process. */
 void process_input(char * buf, int buflen)
 {
+	// Free last input
+	table_arena_free(&table_arena);
+	
 	// Deserialize
 	int bytes_used;
-	table1_size = deserialize_table1(table1, MAX_TABLE_SIZE, buf, buflen, &bytes_used);
-	table2_size = deserialize_table2(table2, MAX_TABLE_SIZE, buf+bytes_used, buflen-bytes_used, NULL);
+	if (deserialize_table1(&table1, &table_arena, buf, buflen, &bytes_used) == -1
+		|| deserialize_table2(&table2, &table_arena, buf+bytes_used, buflen-bytes_used, NULL) == -1)
+	{
+		printf("Failed to deserialize tables.\n");
+		table1.size = table2.size = 0;
+		return;
+	}
 #ifdef DEBUG
-	printf("Table 1 Rows: %d\n", table1_size);
-	printf("Table 2 Rows: %d\n", table2_size);
+	printf("Table 1 Rows: %d\n", table1.size);
+	printf("Table 2 Rows: %d\n", table2.size);
 #endif
 }
 
@@ -85,30 +261,35 @@ void vote_and_process()
 {
 	// No need to vote since there is only one shim
 	// Process tables
-	process_tables(table1, table1_size, table2, table2_size);
+	process_tables(&table1, &table2);
 }
 
 /** Sort tables and send results to join processes. */
-void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2)
+void process_tables(demo_table1_t * table1, demo_table2_t * table2)
 {
 	// Sort tables
-	sort_table1_by_user_id(table1, rows1);
-	sort_table2_by_user_id(table2, rows2);
+	sort_table1_by_user_id(table1);
+	sort_table2_by_user_id(table2);
 	
 #ifdef DEBUG
 	// Print
-	for (i = 0; i < rows1; i++)
-		printf("User Id: %d\tName: %s\n", table1[i].user_id, table1[i].name);
-	for (i = 0; i < rows2; i++)
-		printf("User Id: %d\tGender: %c\n", table2[i].user_id, table2[i].gender);
+	int i;
+	for (i = 0; i < table1->size; i++)
+		printf("User Id: %d\tName: %s\n", table1->user_id[i], table_name(table1->names, table1->name[i]));
+	for (i = 0; i < table2->size; i++)
+		printf("User Id: %d\tGender: %c\n", table2->user_id[i], table2->gender[i]);
 #endif
 	
 	// Serialize
-	char buf[SEND_BUFFER_SIZE];
-	int buflen2;
-	int buflen = serialize_table1(table1, rows1, buf, SEND_BUFFER_SIZE);
+	size_t bufsize = TABLE_SERIALIZED_MAX_SIZE((size_t)MAX(0, table1->size), TABLE1_ROW_MAX_SIZE) + TABLE_SERIALIZED_MAX_SIZE((size_t)MAX(0, table2->size), TABLE2_ROW_MAX_SIZE);
+	if (bufsize > INT_MAX)
+		bufsize = INT_MAX;
+	char * buf = malloc(bufsize);
+	int buflen = -1, buflen2 = -1;
+	if (buf != NULL)
+		buflen = serialize_table1(table1, buf, bufsize);
 	if (buflen != -1)
-		buflen2 = serialize_table2(table2, rows2, buf+buflen, SEND_BUFFER_SIZE - buflen);
+		buflen2 = serialize_table2(table2, buf+buflen, bufsize - buflen);
 	if (buflen == -1 || buflen2 == -1)
 		printf("Failed to serialize tables.\n");
 	else
@@ -137,7 +318,7 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 				sockaddr.sin6_port = htons(JOIN_PORT);
 				sockaddr.sin6_addr = *remote_addr;
 				
-				if (sendto(sockfd, buf, buflen+buflen2, 0, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
+				if (chunk_sendto(sockfd, buf, buflen+buflen2, (struct sockaddr *)&sockaddr, sockaddr_size) == -1)
 					printf("Failed to send message.  Error: %i\n", errno);
 			}
 			
@@ -145,4 +326,5 @@ void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * t
 			FREE_LINKED_LIST(join_addrs);
 		}
 	}
+	free(buf);
 }
\ No newline at end of file
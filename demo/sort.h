@@ -11,9 +11,21 @@ void process_input(char * buf, int buflen);
 void vote_and_process();
 
 /** Sort tables and send results to join processes. */
-void process_tables(demo_table1_entry * table1, int rows1, demo_table2_entry * table2, int rows2);
+void process_tables(demo_table1_t * table1, demo_table2_t * table2);
 
 /** Bubble sort */
 void bubble_sort(void * base, size_t num, size_t size, int (*comparator) (const void *, const void *));
 
+// Parallel sort threads, including the caller
+#define PARALLEL_SORT_MAX_THREADS 64
+
+// Smaller tables are sorted by the calling thread alone
+#define PARALLEL_SORT_MIN_ROWS 65536
+
+/** Start the parallel sort worker pool.  Uses one thread per CPU if num_threads < 1.  Returns the number of threads sorting. */
+int parallel_sort_init(int num_threads);
+
+/** Sort packed keys with the worker pool.  Gives the same order as radix_sort_keys.  Returns -1 if out of memory. */
+int parallel_sort_keys(uint64_t * keys, int size);
+
 #endif
\ No newline at end of file
@@ -130,6 +130,10 @@ int main (int argc, char ** argv)
 		stop_redundancy_for_process_type((uint64_t)SISIS_PTYPE_DEMO1_SORT, 1llu);
 	if (argc < 2 || strcmp(argv[1], "sortv2") == 0)
 		stop_redundancy_for_process_type((uint64_t)SISIS_PTYPE_DEMO1_SORT, 2llu);
+	if (argc < 2 || strcmp(argv[1], "sortv3") == 0)
+		stop_redundancy_for_process_type((uint64_t)SISIS_PTYPE_DEMO1_SORT, 3llu);
+	if (argc < 2 || strcmp(argv[1], "sortv4") == 0)
+		stop_redundancy_for_process_type((uint64_t)SISIS_PTYPE_DEMO1_SORT, 4llu);
 	if (argc < 2 || strcmp(argv[1], "join") == 0)
 		stop_redundancy_for_process_type((uint64_t)SISIS_PTYPE_DEMO1_JOIN, 1llu);
 	
@@ -5,9 +5,11 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <netinet/in.h>
 #include <math.h>
+#include <limits.h>
 
 #include "table.h"
 #include "sort.h"
@@ -16,67 +18,248 @@
 #define ABS(a) ((a) < 0 ? (0 - (a)) : (a))
 
 
-/** Serialize table 1.  Returns -1 if buffer is not long enough. */
-int serialize_table1(demo_table1_entry * table, int size, char * buf, int bufsize)
+/** Write an unsigned varint.  Returns bytes used or -1 if buffer is not long enough. */
+static inline int put_varint(char * buf, int bufsize, uint32_t val)
 {
 	int len = 0;
+	while (val >= 0x80)
+	{
+		if (len >= bufsize)
+			return -1;
+		buf[len++] = (char)(val | 0x80);
+		val >>= 7;
+	}
+	if (len >= bufsize)
+		return -1;
+	buf[len++] = (char)val;
+	return len;
+}
+
+/** Read an unsigned varint.  Returns bytes used or -1 if it is truncated or too long. */
+static inline int get_varint(char * buf, int bufsize, uint32_t * val)
+{
+	int len = 0, shift = 0;
+	*val = 0;
+	while (len < bufsize && len < TABLE_VARINT_MAX_SIZE)
+	{
+		unsigned char byte = (unsigned char)buf[len++];
+		*val |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return len;
+		shift += 7;
+	}
+	return -1;
+}
+
+/** Write a signed int as a zigzag varint so small negative ids stay short. */
+static inline int put_int(char * buf, int bufsize, int val)
+{
+	return put_varint(buf, bufsize, ((uint32_t)val << 1) ^ (uint32_t)(val >> 31));
+}
+
+/** Read a zigzag varint int. */
+static inline int get_int(char * buf, int bufsize, int * val)
+{
+	uint32_t tmp;
+	int len = get_varint(buf, bufsize, &tmp);
+	*val = (int)((tmp >> 1) ^ (0 - (tmp & 1)));
+	return len;
+}
+
+/** Write a name as its length followed by its characters. */
+static inline int put_name(char * buf, int bufsize, const char * name)
+{
+	int name_len = strnlen(name, TABLE1_NAME_LEN - 1);
+	int len = put_varint(buf, bufsize, name_len);
+	if (len == -1 || len + name_len > bufsize)
+		return -1;
+	memcpy(buf+len, name, name_len);
+	return len + name_len;
+}
+
+/** Read a length prefixed name into a dictionary. */
+static inline int get_name(char * buf, int bufsize, table_names_t * names, uint32_t * offset)
+{
+	uint32_t name_len;
+	int len = get_varint(buf, bufsize, &name_len);
+	if (len == -1 || name_len > TABLE1_NAME_LEN - 1 || (uint32_t)len + name_len > (uint32_t)bufsize)
+		return -1;
+	if ((*offset = table_names_add(names, buf+len, name_len)) == TABLE_NAME_NONE)
+		return -1;
+	return len + name_len;
+}
+
+/** Set up a dictionary for up to max_names names taking up to max_bytes of heap (with terminators).  Returns -1 if out of memory. */
+int table_names_init(table_names_t * names, table_arena_t * arena, int max_names, size_t max_bytes)
+{
+	if (max_names < 0 || max_names > TABLE_NAMES_MAX || max_bytes > UINT32_MAX)
+		return -1;
+	
+	// Keep the hash table at most half full.  The limit on names keeps this from overflowing.
+	uint32_t slots = 2;
+	while (slots < (uint32_t)max_names * 2)
+		slots *= 2;
+	names->slots = table_arena_alloc(arena, sizeof(uint32_t) * slots);
+	names->heap = table_arena_alloc(arena, max_bytes);
+	if (names->slots == NULL || names->heap == NULL)
+		return -1;
+	memset(names->slots, 0, sizeof(uint32_t) * slots);
+	names->slot_mask = slots - 1;
+	names->heap_size = 0;
+	names->heap_capacity = max_bytes;
+	names->count = 0;
+	names->max_count = max_names;
+	return 0;
+}
+
+/** Add a name or find it if it is already there.  Returns its offset or TABLE_NAME_NONE if the dictionary is full. */
+uint32_t table_names_add(table_names_t * names, const char * name, int len)
+{
+	// FNV-1a hash
+	uint32_t hash = 2166136261u;
+	int i;
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+	
+	// Look for name
+	uint32_t slot = hash & names->slot_mask;
+	while (names->slots[slot] != 0)
+	{
+		uint32_t offset = names->slots[slot] - 1;
+		if (memcmp(names->heap + offset, name, len) == 0 && names->heap[offset + len] == '\0')
+			return offset;
+		slot = (slot + 1) & names->slot_mask;
+	}
+	
+	// Add name
+	if (names->count >= names->max_count || names->heap_capacity - names->heap_size < (uint32_t)len + 1)
+		return TABLE_NAME_NONE;
+	uint32_t offset = names->heap_size;
+	memcpy(names->heap + offset, name, len);
+	names->heap[offset + len] = '\0';
+	names->heap_size += len + 1;
+	names->slots[slot] = offset + 1;
+	names->count++;
+	return offset;
+}
+
+/** Allocate columns for up to capacity rows of table 1.  Returns -1 if out of memory. */
+int table1_init(demo_table1_t * table, table_arena_t * arena, int capacity, table_names_t * names)
+{
+	table->size = 0;
+	table->capacity = capacity;
+	table->user_id = table_arena_alloc(arena, sizeof(int) * capacity);
+	table->name = table_arena_alloc(arena, sizeof(uint32_t) * capacity);
+	table->names = names;
+	return (table->user_id == NULL || table->name == NULL) ? -1 : 0;
+}
+
+/** Allocate columns for up to capacity rows of table 2.  Returns -1 if out of memory. */
+int table2_init(demo_table2_t * table, table_arena_t * arena, int capacity)
+{
+	table->size = 0;
+	table->capacity = capacity;
+	table->user_id = table_arena_alloc(arena, sizeof(int) * capacity);
+	table->gender = table_arena_alloc(arena, capacity);
+	return (table->user_id == NULL || table->gender == NULL) ? -1 : 0;
+}
+
+/** Allocate columns for up to capacity rows of a merge table.  Returns -1 if out of memory. */
+int merge_table_init(demo_merge_table_t * table, table_arena_t * arena, int capacity, table_names_t * names)
+{
+	table->size = 0;
+	table->capacity = capacity;
+	table->user_id = table_arena_alloc(arena, sizeof(int) * capacity);
+	table->name = table_arena_alloc(arena, sizeof(uint32_t) * capacity);
+	table->gender = table_arena_alloc(arena, capacity);
+	table->names = names;
+	return (table->user_id == NULL || table->name == NULL || table->gender == NULL) ? -1 : 0;
+}
+
+/** Read the row count of a serialized table.  Returns bytes used or -1 on errors, including more rows than the buffer can hold. */
+static int get_rows(char * buf, int bufsize, int row_min_size, int * rows)
+{
+	uint32_t tmp;
+	int len = get_varint(buf, bufsize, &tmp);
+	if (len == -1 || tmp > (uint32_t)(bufsize - len) / row_min_size)
+		return -1;
+	*rows = tmp;
+	return len;
+}
+
+/** Allocate a dictionary for the names in a serialized table. */
+static table_names_t * alloc_names(table_arena_t * arena, int rows, int bufsize)
+{
+	// Names come from the buffer, so it bounds the heap
+	table_names_t * names = table_arena_alloc(arena, sizeof(table_names_t));
+	if (names == NULL || table_names_init(names, arena, rows, (size_t)bufsize + rows) == -1)
+		return NULL;
+	return names;
+}
+
+/** Serialize table 1.  Returns -1 if buffer is not long enough. */
+int serialize_table1(demo_table1_t * table, char * buf, int bufsize)
+{
+	int len, len2;
 	int i;
 	
 	// Serialize size of array
-	if (len + sizeof(size) > bufsize)
+	if ((len = put_varint(buf, bufsize, table->size)) == -1)
 		return -1;
-	*(int*)(buf) = htonl(size);
-	len += sizeof(size);
 	
 	// Serialize each row
-	for (i = 0; i < size; i++)
+	for (i = 0; i < table->size; i++)
 	{
-		// Add length
-		int len2 = sizeof(table[i].user_id) + TABLE1_NAME_LEN;
-		if (len + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		*(int*)(buf+len) = htonl(table[i].user_id);
-		len += sizeof(table[i].user_id);
+		if ((len2 = put_int(buf+len, bufsize-len, table->user_id[i])) == -1)
+			return -1;
+		len += len2;
 		
 		// Copy name
-		memcpy(buf+len, table[i].name, TABLE1_NAME_LEN);
-		len += TABLE1_NAME_LEN;
+		if ((len2 = put_name(buf+len, bufsize-len, table_name(table->names, table->name[i]))) == -1)
+			return -1;
+		len += len2;
 	}
 	return len;
 }
 
-/** Deserialize table 1.  Returns -1 if table is not big enough or other errors. */
-int deserialize_table1(demo_table1_entry * table, int size, char * buf, int bufsize, int * bytes_used)
+/** Deserialize table 1, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_table1(demo_table1_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used)
 {
-	int rows = 0;
-	int i, pos = 0;
+	int rows;
+	int i, pos, len2;
 	
 	// Get size of array
-	if (pos + sizeof(rows) > bufsize)
+	memset(table, 0, sizeof(*table));
+	table->size = -1;
+	if ((pos = get_rows(buf, bufsize, TABLE1_ROW_MIN_SIZE, &rows)) == -1)
 		return -1;
-	rows = ntohl(*(int*)(buf));
-	pos += sizeof(rows);
-	if (rows > size)
+	table_names_t * names = alloc_names(arena, rows, bufsize);
+	if (names == NULL || table1_init(table, arena, rows, names) == -1)
+	{
+		table->size = -1;
 		return -1;
+	}
 	
 	// Get each row
 	for (i = 0; i < rows; i++)
 	{
-		// Check length
-		int len2 = sizeof(table[i].user_id) + TABLE1_NAME_LEN;
-		if (pos + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		table[i].user_id = ntohl(*(int*)(buf+pos));
-		pos += sizeof(table[i].user_id);
+		if ((len2 = get_int(buf+pos, bufsize-pos, &table->user_id[i])) == -1)
+			break;
+		pos += len2;
 		
 		// Copy name
-		memcpy(table[i].name, buf+pos, TABLE1_NAME_LEN);
-		pos += TABLE1_NAME_LEN;
+		if ((len2 = get_name(buf+pos, bufsize-pos, names, &table->name[i])) == -1)
+			break;
+		pos += len2;
+	}
+	if (i < rows)
+	{
+		table->size = -1;
+		return -1;
 	}
+	table->size = rows;
 	
 	if (bytes_used != NULL)
 		*bytes_used = pos;
@@ -85,66 +268,67 @@ int deserialize_table1(demo_table1_entry * table, int size, char * buf, int bufs
 }
 
 /** Serialize table 2.  Returns -1 if buffer is not long enough. */
-int serialize_table2(demo_table2_entry * table, int size, char * buf, int bufsize)
+int serialize_table2(demo_table2_t * table, char * buf, int bufsize)
 {
-	int len = 0;
+	int len, len2;
 	int i;
 	
 	// Serialize size of array
-	if (len + sizeof(size) > bufsize)
+	if ((len = put_varint(buf, bufsize, table->size)) == -1)
 		return -1;
-	*(int*)(buf) = htonl(size);
-	len += sizeof(size);
 	
 	// Serialize each row
-	for (i = 0; i < size; i++)
+	for (i = 0; i < table->size; i++)
 	{
-		// Add length
-		int len2 = sizeof(table[i].user_id) + 1;
-		if (len + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		*(int*)(buf+len) = htonl(table[i].user_id);
-		len += sizeof(table[i].user_id);
+		if ((len2 = put_int(buf+len, bufsize-len, table->user_id[i])) == -1)
+			return -1;
+		len += len2;
 		
 		// Copy gender
-		buf[len] = table[i].gender;
-		len++;
+		if (len >= bufsize)
+			return -1;
+		buf[len++] = table->gender[i];
 	}
 	return len;
 }
 
-/** Deserialize table 2.  Returns -1 if table is not big enough or other errors. */
-int deserialize_table2(demo_table2_entry * table, int size, char * buf, int bufsize, int * bytes_used)
+/** Deserialize table 2, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_table2(demo_table2_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used)
 {
-	int rows = 0;
-	int i, pos = 0;
+	int rows;
+	int i, pos, len2;
 	
 	// Get size of array
-	if (pos + sizeof(rows) > bufsize)
+	memset(table, 0, sizeof(*table));
+	table->size = -1;
+	if ((pos = get_rows(buf, bufsize, TABLE2_ROW_MIN_SIZE, &rows)) == -1)
 		return -1;
-	rows = ntohl(*(int*)(buf));
-	pos += sizeof(rows);
-	if (rows > size)
+	if (table2_init(table, arena, rows) == -1)
+	{
+		table->size = -1;
 		return -1;
+	}
 	
 	// Get each row
 	for (i = 0; i < rows; i++)
 	{
-		// Check length
-		int len2 = sizeof(table[i].user_id) + 1;
-		if (pos + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		table[i].user_id = ntohl(*(int*)(buf+pos));
-		pos += sizeof(table[i].user_id);
+		if ((len2 = get_int(buf+pos, bufsize-pos, &table->user_id[i])) == -1)
+			break;
+		pos += len2;
 		
 		// Copy gender
-		table[i].gender = buf[pos];
-		pos++;
+		if (pos >= bufsize)
+			break;
+		table->gender[i] = buf[pos++];
+	}
+	if (i < rows)
+	{
+		table->size = -1;
+		return -1;
 	}
+	table->size = rows;
 	
 	if (bytes_used != NULL)
 		*bytes_used = pos;
@@ -153,74 +337,78 @@ int deserialize_table2(demo_table2_entry * table, int size, char * buf, int bufs
 }
 
 /** Serialize join table.  Returns -1 if buffer is not long enough. */
-int serialize_join_table(demo_merge_table_entry * table, int size, char * buf, int bufsize)
+int serialize_join_table(demo_merge_table_t * table, char * buf, int bufsize)
 {
-	int len = 0;
+	int len, len2;
 	int i;
 	
-	// Serialize size of array
-	if (len + sizeof(size) > bufsize)
+	// Serialize size of array.  A failed join is sent as -1.
+	if ((len = put_varint(buf, bufsize, table->size)) == -1)
 		return -1;
-	*(int*)(buf) = htonl(size);
-	len += sizeof(size);
 	
 	// Serialize each row
-	for (i = 0; i < size; i++)
+	for (i = 0; i < table->size; i++)
 	{
-		// Add length
-		int len2 = sizeof(table[i].user_id) + TABLE1_NAME_LEN + 1;
-		if (len + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		*(int*)(buf+len) = htonl(table[i].user_id);
-		len += sizeof(table[i].user_id);
+		if ((len2 = put_int(buf+len, bufsize-len, table->user_id[i])) == -1)
+			return -1;
+		len += len2;
 		
 		// Copy name
-		memcpy(buf+len, table[i].name, TABLE1_NAME_LEN);
-		len += TABLE1_NAME_LEN;
+		if ((len2 = put_name(buf+len, bufsize-len, table_name(table->names, table->name[i]))) == -1)
+			return -1;
+		len += len2;
 		
 		// Copy gender
-		buf[len] = table[i].gender;
-		len++;
+		if (len >= bufsize)
+			return -1;
+		buf[len++] = table->gender[i];
 	}
 	return len;
 }
 
-/** Deserialize join table.  Returns -1 if table is not big enough or other errors. */
-int deserialize_join_table(demo_merge_table_entry * table, int size, char * buf, int bufsize, int * bytes_used)
+/** Deserialize join table, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_join_table(demo_merge_table_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used)
 {
-	int rows = 0;
-	int i, pos = 0;
+	int rows;
+	int i, pos, len2;
 	
 	// Get size of array
-	if (pos + sizeof(rows) > bufsize)
+	memset(table, 0, sizeof(*table));
+	table->size = -1;
+	if ((pos = get_rows(buf, bufsize, JOIN_TABLE_ROW_MIN_SIZE, &rows)) == -1)
 		return -1;
-	rows = ntohl(*(int*)(buf));
-	pos += sizeof(rows);
-	if (rows > size)
+	table_names_t * names = alloc_names(arena, rows, bufsize);
+	if (names == NULL || merge_table_init(table, arena, rows, names) == -1)
+	{
+		table->size = -1;
 		return -1;
+	}
 	
 	// Get each row
 	for (i = 0; i < rows; i++)
 	{
-		// Check length
-		int len2 = sizeof(table[i].user_id) + TABLE1_NAME_LEN + 1;
-		if (pos + len2 > bufsize)
-			return -1;
-		
 		// Copy user id
-		table[i].user_id = ntohl(*(int*)(buf+pos));
-		pos += sizeof(table[i].user_id);
+		if ((len2 = get_int(buf+pos, bufsize-pos, &table->user_id[i])) == -1)
+			break;
+		pos += len2;
 		
 		// Copy name
-		memcpy(table[i].name, buf+pos, TABLE1_NAME_LEN);
-		pos += TABLE1_NAME_LEN;
+		if ((len2 = get_name(buf+pos, bufsize-pos, names, &table->name[i])) == -1)
+			break;
+		pos += len2;
 		
 		// Copy gender
-		table[i].gender = buf[pos];
-		pos++;
+		if (pos >= bufsize)
+			break;
+		table->gender[i] = buf[pos++];
+	}
+	if (i < rows)
+	{
+		table->size = -1;
+		return -1;
 	}
+	table->size = rows;
 	
 	if (bytes_used != NULL)
 		*bytes_used = pos;
@@ -228,76 +416,258 @@ int deserialize_join_table(demo_merge_table_entry * table, int size, char * buf,
 	return rows;
 }
 
-/** Compare user id of two table 1 entries */
-int table1_user_id_comparator(const void * v_a, const void * v_b)
+/** Compare packed user id sort keys */
+int table_sort_key_comparator(const void * v_a, const void * v_b)
 {
-	demo_table1_entry * a = (demo_table1_entry *)v_a;
-	demo_table1_entry * b = (demo_table1_entry *)v_b;
-	if (a->user_id < b->user_id)
+	uint64_t a = *(uint64_t *)v_a;
+	uint64_t b = *(uint64_t *)v_b;
+	if (a < b)
 		return -1;
-	else if (a->user_id > b->user_id)
+	else if (a > b)
 		return 1;
 	return 0;
 }
 
-/** Sort table 1 by user_id */
-void sort_table1_by_user_id(demo_table1_entry * table, int size)
+/** Stable LSD radix sort of packed keys by user id (their upper 32 bits).  Returns -1 if out of memory. */
+int radix_sort_keys(uint64_t * keys, int size)
+{
+	if (size < 2)
+		return 0;
+	uint64_t * tmp = malloc(sizeof(uint64_t) * size);
+	if (tmp == NULL)
+		return -1;
+	
+	// Count digits for all passes at once
+	uint32_t counts[TABLE_RADIX_PASSES][TABLE_RADIX_BUCKETS];
+	memset(counts, 0, sizeof(counts));
+	int i, pass;
+	for (i = 0; i < size; i++)
+	{
+		uint32_t key = (uint32_t)(keys[i] >> 32);
+		for (pass = 0; pass < TABLE_RADIX_PASSES; pass++)
+			counts[pass][(key >> (pass * TABLE_RADIX_BITS)) & (TABLE_RADIX_BUCKETS - 1)]++;
+	}
+	
+	// Distribute by each digit, least significant first
+	uint64_t * src = keys, * dst = tmp, * swap;
+	for (pass = 0; pass < TABLE_RADIX_PASSES; pass++)
+	{
+		int shift = 32 + pass * TABLE_RADIX_BITS;
+		
+		// Skip digits that are the same for every key
+		uint32_t * count = counts[pass];
+		if (count[(src[0] >> shift) & (TABLE_RADIX_BUCKETS - 1)] == (uint32_t)size)
+			continue;
+		
+		// Turn counts into starting positions
+		uint32_t pos = 0, tmp_count;
+		for (i = 0; i < TABLE_RADIX_BUCKETS; i++)
+		{
+			tmp_count = count[i];
+			count[i] = pos;
+			pos += tmp_count;
+		}
+		
+		for (i = 0; i < size; i++)
+			dst[count[(src[i] >> shift) & (TABLE_RADIX_BUCKETS - 1)]++] = src[i];
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	
+	// Copy back if the last pass left the keys in the temporary buffer
+	if (src != keys)
+		memcpy(keys, src, sizeof(uint64_t) * size);
+	free(tmp);
+	return 0;
+}
+
+/**
+ * Sort a user id column.  Returns the original row of each sorted row (caller
+ * frees) or NULL if out of memory.
+ */
+static int * sort_user_ids(int * user_id, int size)
 {
-#ifdef BUBBLE_SORT
-	bubble_sort(table, size, sizeof(demo_table1_entry), table1_user_id_comparator);
+	// Pack user id (flipped so unsigned order matches signed order) and row into one key
+	uint64_t * keys = malloc(sizeof(uint64_t) * (size ? size : 1));
+	if (keys == NULL)
+		return NULL;
+	int i;
+	for (i = 0; i < size; i++)
+		keys[i] = ((uint64_t)((uint32_t)user_id[i] ^ 0x80000000u) << 32) | (uint32_t)i;
+	
+#if defined(PARALLEL_SORT)
+	// Keys are unique, so any correct sort gives the same order
+	if (parallel_sort_keys(keys, size) == -1)
+	{
+		free(keys);
+		return NULL;
+	}
+#elif defined(RADIX_SORT)
+	// Keys start in row order and the sort is stable, so this matches sorting whole keys
+	if (radix_sort_keys(keys, size) == -1)
+	{
+		free(keys);
+		return NULL;
+	}
+#elif defined(BUBBLE_SORT)
+	bubble_sort(keys, size, sizeof(uint64_t), table_sort_key_comparator);
 #else
-	qsort(table, size, sizeof(demo_table1_entry), table1_user_id_comparator);
+	qsort(keys, size, sizeof(uint64_t), table_sort_key_comparator);
 #endif
+	
+	// Unpack.  Row i of the order is stored over the first half of key i / 2, which was already read.
+	int * order = (int *)keys;
+	for (i = 0; i < size; i++)
+	{
+		uint64_t key = keys[i];
+		user_id[i] = (int)((uint32_t)(key >> 32) ^ 0x80000000u);
+		order[i] = (int)(uint32_t)key;
+	}
+	return order;
 }
 
-/** Compare user id of two table 2 entries */
-int table2_user_id_comparator(const void * v_a, const void * v_b)
+/** Reorder a column of 4 byte values.  Returns -1 if out of memory. */
+static int permute_column32(uint32_t * column, int * order, int size)
 {
-	demo_table2_entry * a = (demo_table2_entry *)v_a;
-	demo_table2_entry * b = (demo_table2_entry *)v_b;
-	if (a->user_id < b->user_id)
+	uint32_t * tmp = malloc(sizeof(uint32_t) * (size ? size : 1));
+	if (tmp == NULL)
 		return -1;
-	else if (a->user_id > b->user_id)
-		return 1;
+	int i;
+	for (i = 0; i < size; i++)
+		tmp[i] = column[order[i]];
+	memcpy(column, tmp, sizeof(uint32_t) * size);
+	free(tmp);
 	return 0;
 }
 
+/** Reorder a column of single byte values.  Returns -1 if out of memory. */
+static int permute_column8(char * column, int * order, int size)
+{
+	char * tmp = malloc(size ? size : 1);
+	if (tmp == NULL)
+		return -1;
+	int i;
+	for (i = 0; i < size; i++)
+		tmp[i] = column[order[i]];
+	memcpy(column, tmp, size);
+	free(tmp);
+	return 0;
+}
+
+/** Sort table 1 by user_id */
+void sort_table1_by_user_id(demo_table1_t * table)
+{
+	if (table->size < 2)
+		return;
+	int * order = sort_user_ids(table->user_id, table->size);
+	if (order == NULL || permute_column32(table->name, order, table->size) == -1)
+		table->size = -1;
+	free(order);
+}
+
 /** Sort table 2 by user_id */
-void sort_table2_by_user_id(demo_table2_entry * table, int size)
+void sort_table2_by_user_id(demo_table2_t * table)
 {
-#ifdef BUBBLE_SORT
-	bubble_sort(table, size, sizeof(demo_table2_entry), table2_user_id_comparator);
-#else
-	qsort(table, size, sizeof(demo_table2_entry), table2_user_id_comparator);
-#endif
+	if (table->size < 2)
+		return;
+	int * order = sort_user_ids(table->user_id, table->size);
+	if (order == NULL || permute_column8(table->gender, order, table->size) == -1)
+		table->size = -1;
+	free(order);
 }
 
-/** Merge join table 1 and 2.  Input tables should be pre-sorted.  Assumes user_id is a primary key. */
-int merge_join(demo_table1_entry * table1, int size1, demo_table2_entry * table2, int size2, demo_merge_table_entry * table, int size)
+/** Sort merge table by user_id */
+void sort_merge_table_by_user_id(demo_merge_table_t * table)
+{
+	if (table->size < 2)
+		return;
+	int * order = sort_user_ids(table->user_id, table->size);
+	if (order == NULL || permute_column32(table->name, order, table->size) == -1 || permute_column8(table->gender, order, table->size) == -1)
+		table->size = -1;
+	free(order);
+}
+
+/** Merge join table 1 and 2 into table, which shares table 1's names.  Input tables should be pre-sorted.  Assumes user_id is a primary key. */
+int merge_join(demo_table1_t * table1, demo_table2_t * table2, demo_merge_table_t * table)
 {
 	int rows = 0;
+	int size1 = table1->size, size2 = table2->size;
+	int * user_id1 = table1->user_id, * user_id2 = table2->user_id;
 	
+	table->names = table1->names;
 	int idx1 = 0, idx2 = 0;
 	for (; idx1 < size1 && idx2 < size2; idx1++)
 	{
 		// Find matching user id
-		for (; idx2 < size2 && table1[idx1].user_id > table2[idx2].user_id; idx2++);
+		for (; idx2 < size2 && user_id1[idx1] > user_id2[idx2]; idx2++);
 		
-		if (idx2 < size2 && table1[idx1].user_id == table2[idx2].user_id)
+		if (idx2 < size2 && user_id1[idx1] == user_id2[idx2])
 		{
-			if (rows >= size)
+			if (rows >= table->capacity)
+			{
+				table->size = -1;
 				return -1;
-			table[rows].user_id = table1[idx1].user_id;
-			memcpy(table[rows].name, table1[idx1].name, TABLE1_NAME_LEN);
-			table[rows].gender = table2[idx2].gender;
+			}
+			table->user_id[rows] = user_id1[idx1];
+			table->name[rows] = table1->name[idx1];
+			table->gender[rows] = table2->gender[idx2];
 			
 			rows++;
 		}
 	}
 	
+	table->size = rows;
 	return rows;
 }
 
+/** Allocate memory from an arena.  Returns NULL if out of memory. */
+void * table_arena_alloc(table_arena_t * arena, size_t size)
+{
+	size = (size + TABLE_ARENA_ALIGN - 1) & ~(size_t)(TABLE_ARENA_ALIGN - 1);
+	
+	// Use current block if there is room
+	table_arena_block_t * block = arena->first;
+	if (block != NULL && block->size - block->used >= size)
+	{
+		void * ptr = block->data + block->used;
+		block->used += size;
+		return ptr;
+	}
+	
+	// Start new block.  Large allocations get a block of their own behind the current one.
+	size_t block_size = (size > TABLE_ARENA_BLOCK_SIZE / 4) ? size : TABLE_ARENA_BLOCK_SIZE;
+	table_arena_block_t * new_block = malloc(sizeof(table_arena_block_t) + block_size);
+	if (new_block == NULL)
+		return NULL;
+	new_block->size = block_size;
+	new_block->used = size;
+	if (block != NULL && block_size == size)
+	{
+		new_block->next = block->next;
+		block->next = new_block;
+	}
+	else
+	{
+		new_block->next = block;
+		arena->first = new_block;
+	}
+	return new_block->data;
+}
+
+/** Free all memory allocated from an arena */
+void table_arena_free(table_arena_t * arena)
+{
+	table_arena_block_t * block = arena->first, * next;
+	arena->first = NULL;
+	while (block != NULL)
+	{
+		next = block->next;
+		free(block);
+		block = next;
+	}
+}
+
 /** Voter on a group of table 1s. */
 table_group_item_t * table1_vote(table_group_t * tables)
 {
@@ -316,8 +686,8 @@ table_group_item_t * table1_vote(table_group_t * tables)
 			// Don't compare against itself
 			if (item2 != item)
 			{
-				demo_table1_entry * t1 = (demo_table1_entry *)(item->table);
-				demo_table1_entry * t2 = (demo_table1_entry *)(item2->table);
+				demo_table1_t * t1 = (demo_table1_t *)(item->table);
+				demo_table1_t * t2 = (demo_table1_t *)(item2->table);
 				dist += table1_distance(t1, item->table_size, t2, item2->table_size);
 			}
 			
@@ -339,8 +709,45 @@ table_group_item_t * table1_vote(table_group_t * tables)
 	return winner;
 }
 
+/** Count rows where two user id columns differ */
+static inline int user_id_distance(int * user_id1, int * user_id2, int size)
+{
+	int dist = 0, i;
+	for (i = 0; i < size; i++)
+		dist += (user_id1[i] != user_id2[i]);
+	return dist;
+}
+
+/** Count rows where two gender columns differ */
+static inline int gender_distance(char * gender1, char * gender2, int size)
+{
+	int dist = 0, i;
+	for (i = 0; i < size; i++)
+		dist += (gender1[i] != gender2[i]);
+	return dist;
+}
+
+/** Count rows where two name columns differ */
+static inline int name_distance(table_names_t * names1, uint32_t * name1, table_names_t * names2, uint32_t * name2, int size)
+{
+	int dist = 0, i;
+	
+	// Offsets in the same dictionary are equal only for equal names
+	if (names1 == names2)
+	{
+		for (i = 0; i < size; i++)
+			dist += (name1[i] != name2[i]);
+	}
+	else
+	{
+		for (i = 0; i < size; i++)
+			dist += (strcmp(table_name(names1, name1[i]), table_name(names2, name2[i])) != 0);
+	}
+	return dist;
+}
+
 /** Compute distance between 2 table 1s. */
-int table1_distance(demo_table1_entry * table1, int size1, demo_table1_entry * table2, int size2)
+int table1_distance(demo_table1_t * table1, int size1, demo_table1_t * table2, int size2)
 {
 	int dist = 0;
 	
@@ -348,13 +755,11 @@ int table1_distance(demo_table1_entry * table1, int size1, demo_table1_entry * t
 	dist += ABS(size1 - size2) * 3;	// 3 is an arbitrary weight
 	
 	// Check each entry
-	int i;
-	for (i = 0; i < MIN(size1, size2); i++)
+	int size = MIN(size1, size2);
+	if (size > 0)
 	{
-		if (table1[i].user_id != table2[i].user_id)
-			dist += 1;
-		if (strcmp(table1[i].name, table2[i].name))
-			dist += 1;
+		dist += user_id_distance(table1->user_id, table2->user_id, size);
+		dist += name_distance(table1->names, table1->name, table2->names, table2->name, size);
 	}
 	
 	return dist;
@@ -378,8 +783,8 @@ table_group_item_t * table2_vote(table_group_t * tables)
 			// Don't compare against itself
 			if (item2 != item)
 			{
-				demo_table2_entry * t1 = (demo_table2_entry *)(item->table);
-				demo_table2_entry * t2 = (demo_table2_entry *)(item2->table);
+				demo_table2_t * t1 = (demo_table2_t *)(item->table);
+				demo_table2_t * t2 = (demo_table2_t *)(item2->table);
 				dist += table2_distance(t1, item->table_size, t2, item2->table_size);
 			}
 			
@@ -402,7 +807,7 @@ table_group_item_t * table2_vote(table_group_t * tables)
 }
 
 /** Compute distance between 2 table 2s. */
-int table2_distance(demo_table2_entry * table1, int size1, demo_table2_entry * table2, int size2)
+int table2_distance(demo_table2_t * table1, int size1, demo_table2_t * table2, int size2)
 {
 	int dist = 0;
 	
@@ -410,13 +815,11 @@ int table2_distance(demo_table2_entry * table1, int size1, demo_table2_entry * t
 	dist += ABS(size1 - size2) * 3;	// 3 is an arbitrary weight
 	
 	// Check each entry
-	int i;
-	for (i = 0; i < MIN(size1, size2); i++)
+	int size = MIN(size1, size2);
+	if (size > 0)
 	{
-		if (table1[i].user_id != table2[i].user_id)
-			dist += 1;
-		if (table1[i].gender != table2[i].gender)
-			dist += 1;
+		dist += user_id_distance(table1->user_id, table2->user_id, size);
+		dist += gender_distance(table1->gender, table2->gender, size);
 	}
 	
 	return dist;
@@ -440,8 +843,8 @@ table_group_item_t * merge_table_vote(table_group_t * tables)
 			// Don't compare against itself
 			if (item2 != item)
 			{
-				demo_merge_table_entry * t1 = (demo_merge_table_entry *)(item->table);
-				demo_merge_table_entry * t2 = (demo_merge_table_entry *)(item2->table);
+				demo_merge_table_t * t1 = (demo_merge_table_t *)(item->table);
+				demo_merge_table_t * t2 = (demo_merge_table_t *)(item2->table);
 				dist += merge_table_distance(t1, item->table_size, t2, item2->table_size);
 			}
 			
@@ -464,7 +867,7 @@ table_group_item_t * merge_table_vote(table_group_t * tables)
 }
 
 /** Compute distance between 2 join tables. */
-int merge_table_distance(demo_merge_table_entry * table1, int size1, demo_merge_table_entry * table2, int size2)
+int merge_table_distance(demo_merge_table_t * table1, int size1, demo_merge_table_t * table2, int size2)
 {
 	int dist = 0;
 	
@@ -472,15 +875,12 @@ int merge_table_distance(demo_merge_table_entry * table1, int size1, demo_merge_
 	dist += ABS(size1 - size2) * 3;	// 3 is an arbitrary weight
 	
 	// Check each entry
-	int i;
-	for (i = 0; i < MIN(size1, size2); i++)
+	int size = MIN(size1, size2);
+	if (size > 0)
 	{
-		if (table1[i].user_id != table2[i].user_id)
-			dist += 1;
-		if (strcmp(table1[i].name, table2[i].name))
-			dist += 1;
-		if (table1[i].gender != table2[i].gender)
-			dist += 1;
+		dist += user_id_distance(table1->user_id, table2->user_id, size);
+		dist += name_distance(table1->names, table1->name, table2->names, table2->name, size);
+		dist += gender_distance(table1->gender, table2->gender, size);
 	}
 	
 	return dist;
@@ -489,18 +889,8 @@ int merge_table_distance(demo_merge_table_entry * table1, int size1, demo_merge_
 /** Free a group of tables and data inside */
 int table_group_free(table_group_t * tables)
 {
-	table_group_item_t * item = tables->first, * item2;
+	// Items and tables all live in the arena
 	tables->first = NULL;
-	while (item != NULL)
-	{
-		// Get next item
-		item2 = item->next;
-		
-		// Free memory
-		free(item->table);
-		free(item);
-		
-		// Set next item
-		item = item2;
-	}
+	table_arena_free(&tables->arena);
+	return 0;
 }
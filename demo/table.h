@@ -7,59 +7,160 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define TABLE1_NAME_LEN 64
 
-/** Demo table 1 entry */
+// Arenas hand out memory from large blocks and free it all at once
+#define TABLE_ARENA_BLOCK_SIZE 65536
+#define TABLE_ARENA_ALIGN sizeof(void *)
+
+typedef struct table_arena_block {
+	struct table_arena_block * next;
+	size_t size;
+	size_t used;
+	char data[];
+} table_arena_block_t;
+
 typedef struct {
-	int user_id;
-	char name[TABLE1_NAME_LEN];
-} demo_table1_entry;
+	table_arena_block_t * first;
+} table_arena_t;
 
-/** Demo table 2 entry */
+/** Allocate memory from an arena.  Returns NULL if out of memory. */
+void * table_arena_alloc(table_arena_t * arena, size_t size);
+
+/** Free all memory allocated from an arena */
+void table_arena_free(table_arena_t * arena);
+
+/**
+ * Name dictionary.  Each distinct name is stored once, NUL terminated, in a
+ * single heap and tables refer to names by their offset in it.  Offsets of
+ * the same dictionary can be compared instead of the names.
+ */
 typedef struct {
-	int user_id;
-	char gender;
-} demo_table2_entry;
+	char * heap;
+	uint32_t heap_size;
+	uint32_t heap_capacity;
+	uint32_t * slots;	// Hash table of offsets plus one, 0 if empty
+	uint32_t slot_mask;
+	uint32_t count;
+	uint32_t max_count;
+} table_names_t;
 
-/** Merge table entry */
+#define TABLE_NAME_NONE ((uint32_t)-1)
+
+// Most names a dictionary can hold
+#define TABLE_NAMES_MAX (1 << 30)
+
+/** Set up a dictionary for up to max_names names taking up to max_bytes of heap (with terminators).  Returns -1 if out of memory. */
+int table_names_init(table_names_t * names, table_arena_t * arena, int max_names, size_t max_bytes);
+
+/** Add a name or find it if it is already there.  Returns its offset or TABLE_NAME_NONE if the dictionary is full. */
+uint32_t table_names_add(table_names_t * names, const char * name, int len);
+
+/** Get a name by offset */
+static inline const char * table_name(table_names_t * names, uint32_t offset)
+{
+	return names->heap + offset;
+}
+
+// Tables are stored by column.  Size is -1 if the table could not be read.
+
+/** Demo table 1 */
+typedef struct {
+	int size;
+	int capacity;
+	int * user_id;
+	uint32_t * name;	// Offsets in names
+	table_names_t * names;
+} demo_table1_t;
+
+/** Demo table 2 */
+typedef struct {
+	int size;
+	int capacity;
+	int * user_id;
+	char * gender;
+} demo_table2_t;
+
+/** Merge table */
 typedef struct {
-	int user_id;
-	char name[TABLE1_NAME_LEN];
-	char gender;
-} demo_merge_table_entry;
+	int size;
+	int capacity;
+	int * user_id;
+	uint32_t * name;	// Offsets in names
+	char * gender;
+	table_names_t * names;
+} demo_merge_table_t;
+
+/** Allocate columns for up to capacity rows of table 1.  Returns -1 if out of memory. */
+int table1_init(demo_table1_t * table, table_arena_t * arena, int capacity, table_names_t * names);
+
+/** Allocate columns for up to capacity rows of table 2.  Returns -1 if out of memory. */
+int table2_init(demo_table2_t * table, table_arena_t * arena, int capacity);
+
+/** Allocate columns for up to capacity rows of a merge table.  Returns -1 if out of memory. */
+int merge_table_init(demo_merge_table_t * table, table_arena_t * arena, int capacity, table_names_t * names);
+
+// Serialized tables are a varint row count followed by the rows.  Ints are
+// zigzag varints, names are a varint length followed by the characters
+// (without padding or terminator) and genders are a single byte.
+#define TABLE_VARINT_MAX_SIZE 5
+#define TABLE1_ROW_MAX_SIZE (TABLE_VARINT_MAX_SIZE + 1 + TABLE1_NAME_LEN - 1)
+#define TABLE2_ROW_MAX_SIZE (TABLE_VARINT_MAX_SIZE + 1)
+#define JOIN_TABLE_ROW_MAX_SIZE (TABLE1_ROW_MAX_SIZE + 1)
+
+// Smallest rows, with an empty name, for checking row counts against buffers
+#define TABLE1_ROW_MIN_SIZE 2
+#define TABLE2_ROW_MIN_SIZE 2
+#define JOIN_TABLE_ROW_MIN_SIZE 3
+
+/** Largest possible serialized size of a table, for sizing buffers */
+#define TABLE_SERIALIZED_MAX_SIZE(rows, row_max_size) (TABLE_VARINT_MAX_SIZE + (rows) * (row_max_size))
 
 /** Serialize table 1.  Returns -1 if buffer is not long enough. */
-int serialize_table1(demo_table1_entry * table, int size, char * buf, int bufsize);
+int serialize_table1(demo_table1_t * table, char * buf, int bufsize);
 
-/** Deserialize table 1.  Returns -1 if table is not big enough or other errors. */
-int deserialize_table1(demo_table1_entry * table, int size, char * buf, int bufsize, int * bytes_used);
+/** Deserialize table 1, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_table1(demo_table1_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used);
 
 /** Serialize table 2.  Returns -1 if buffer is not long enough. */
-int serialize_table2(demo_table2_entry * table, int size, char * buf, int bufsize);
+int serialize_table2(demo_table2_t * table, char * buf, int bufsize);
 
-/** Deserialize table 2.  Returns -1 if table is not big enough or other errors. */
-int deserialize_table2(demo_table2_entry * table, int size, char * buf, int bufsize, int * bytes_used);
+/** Deserialize table 2, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_table2(demo_table2_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used);
 
 /** Serialize join table.  Returns -1 if buffer is not long enough. */
-int serialize_join_table(demo_merge_table_entry * table, int size, char * buf, int bufsize);
+int serialize_join_table(demo_merge_table_t * table, char * buf, int bufsize);
 
-/** Deserialize join table.  Returns -1 if table is not big enough or other errors. */
-int deserialize_join_table(demo_merge_table_entry * table, int size, char * buf, int bufsize, int * bytes_used);
+/** Deserialize join table, allocating it from the arena.  Returns -1 on errors. */
+int deserialize_join_table(demo_merge_table_t * table, table_arena_t * arena, char * buf, int bufsize, int * bytes_used);
 
-/** Compare user id of two table 1 entries */
-int table1_user_id_comparator(const void * v_a, const void * v_b);
+// Tables are sorted by packing each user id (with its sign bit flipped) and
+// row into a 64-bit key, sorting the keys and reordering the other columns.
+// Radix sort uses 3 passes of 11 bits over the user id.
+#define TABLE_RADIX_BITS 11
+#define TABLE_RADIX_BUCKETS (1 << TABLE_RADIX_BITS)
+#define TABLE_RADIX_PASSES 3
 
-/** Sort table 1 by user_id */
-void sort_table1_by_user_id(demo_table1_entry * table, int size);
+/** Compare packed user id sort keys */
+int table_sort_key_comparator(const void * v_a, const void * v_b);
 
-/** Compare user id of two table 2 entries */
-int table2_user_id_comparator(const void * v_a, const void * v_b);
+/** Stable LSD radix sort of packed keys by user id (their upper 32 bits).  Returns -1 if out of memory. */
+int radix_sort_keys(uint64_t * keys, int size);
+
+/** Sort table 1 by user_id */
+void sort_table1_by_user_id(demo_table1_t * table);
 
 /** Sort table 2 by user_id */
-void sort_table2_by_user_id(demo_table2_entry * table, int size);
+void sort_table2_by_user_id(demo_table2_t * table);
+
+/** Sort merge table by user_id */
+void sort_merge_table_by_user_id(demo_merge_table_t * table);
 
-/** Merge join table 1 and 2.  Input tables should be pre-sorted.  Assumes user_id is a primary key. */
-int merge_join(demo_table1_entry * table1, int size1, demo_table2_entry * table2, int size2, demo_merge_table_entry * table, int size);
+/** Merge join table 1 and 2 into table, which shares table 1's names.  Input tables should be pre-sorted.  Assumes user_id is a primary key. */
+int merge_join(demo_table1_t * table1, demo_table2_t * table2, demo_merge_table_t * table);
 
 typedef struct table_group_item {
 	void * table;
@@ -67,8 +168,10 @@ typedef struct table_group_item {
 	struct table_group_item * next;
 } table_group_item_t;
 
+/** Group of tables.  Items and tables are allocated from the group's arena. */
 typedef struct {
 	table_group_item_t * first;
+	table_arena_t arena;
 } table_group_t;
 
 /** Get table group size */
@@ -85,19 +188,19 @@ static inline int get_table_group_size(table_group_t * group)
 table_group_item_t * table1_vote(table_group_t * tables);
 
 /** Compute distance between 2 table 1s. */
-int table1_distance(demo_table1_entry * table1, int size1, demo_table1_entry * table2, int size2);
+int table1_distance(demo_table1_t * table1, int size1, demo_table1_t * table2, int size2);
 
 /** Voter on a group of table 2s. */
 table_group_item_t * table2_vote(table_group_t * tables);
 
 /** Compute distance between 2 table 2s. */
-int table2_distance(demo_table2_entry * table1, int size1, demo_table2_entry * table2, int size2);
+int table2_distance(demo_table2_t * table1, int size1, demo_table2_t * table2, int size2);
 
 /** Voter on a group of join tables. */
 table_group_item_t * merge_table_vote(table_group_t * tables);
 
 /** Compute distance between 2 join tables. */
-int merge_table_distance(demo_merge_table_entry * table1, int size1, demo_merge_table_entry * table2, int size2);
+int merge_table_distance(demo_merge_table_t * table1, int size1, demo_merge_table_t * table2, int size2);
 
 /** Free a group of tables and data inside */
 int table_group_free(table_group_t * tables);
@@ -214,47 +214,42 @@ void * update_hostname(void * data_v)
 #ifdef HAVE_IPV6
 int rib_monitor_add_ipv6_route(struct route_ipv6 * route, void * data)
 {
-	char prefix_str[INET6_ADDRSTRLEN];
-	if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), prefix_str, INET6_ADDRSTRLEN) != NULL)
+	// Check that this is an SIS-IS address
+	struct in6_addr * addr = &route->p->prefix;
+	if (sisis_addr_is_sisis(addr))
 	{
-		uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-		if (get_sisis_addr_components(prefix_str, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+		uint64_t process_type = sisis_addr_get_process_type(addr), process_version = sisis_addr_get_process_version(addr), sys_id = sisis_addr_get_sys_id(addr);
+		
+		// Get process number and name to send
+		process_visualization_info_t proc_info = get_process_info((int)process_type, (int)process_version);
+		
+		// Send message
+		char buf[512];
+		if (num_proc_pre_host[sys_id%16] == 0 || process_type == (uint64_t)SISIS_PTYPE_MACHINE_MONITOR)
 		{
-			// Check that this is an SIS-IS address
-			if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
+			// Set temporary hostname if the host need to be set to up
+			if (num_proc_pre_host[sys_id%16] == 0)
 			{
-				// Get process number and name to send
-				process_visualization_info_t proc_info = get_process_info((int)process_type, (int)process_version);
+				char hostname[64];
+				sprintf(hostname, "Host #%llu", sys_id%16);
 				
-				// Send message
-				char buf[512];
-				if (num_proc_pre_host[sys_id%16] == 0 || process_type == (uint64_t)SISIS_PTYPE_MACHINE_MONITOR)
-				{
-					// Set temporary hostname if the host need to be set to up
-					if (num_proc_pre_host[sys_id%16] == 0)
-					{
-						char hostname[64];
-						sprintf(hostname, "Host #%llu", sys_id%16);
-						
-						// Set host to up
-						sprintf(buf, "hostUp %llu %s\n", sys_id % 16, hostname);
-						send(sockfd, buf, strlen(buf), 0);
-					}
-					
-					// Get hostname asynchronously
-					update_hostname_data_t * data = malloc(sizeof(update_hostname_data_t));
-					if (data != NULL)
-					{
-						data->sys_id = sys_id;
-						pthread_create(&data->thread, NULL, update_hostname, (void*)data);
-					}
-				}
-				
-				num_proc_pre_host[sys_id%16]++;
-				sprintf(buf, "procAdd %llu %i %s\n", sys_id % 16, proc_info.proc_num, proc_info.desc);
+				// Set host to up
+				sprintf(buf, "hostUp %llu %s\n", sys_id % 16, hostname);
 				send(sockfd, buf, strlen(buf), 0);
 			}
+			
+			// Get hostname asynchronously
+			update_hostname_data_t * data = malloc(sizeof(update_hostname_data_t));
+			if (data != NULL)
+			{
+				data->sys_id = sys_id;
+				pthread_create(&data->thread, NULL, update_hostname, (void*)data);
+			}
 		}
+		
+		num_proc_pre_host[sys_id%16]++;
+		sprintf(buf, "procAdd %llu %i %s\n", sys_id % 16, proc_info.proc_num, proc_info.desc);
+		send(sockfd, buf, strlen(buf), 0);
 	}
 	
 	// Free memory
@@ -263,29 +258,24 @@ int rib_monitor_add_ipv6_route(struct route_ipv6 * route, void * data)
 
 int rib_monitor_remove_ipv6_route(struct route_ipv6 * route, void * data)
 {
-	char prefix_str[INET6_ADDRSTRLEN];
-	if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), prefix_str, INET6_ADDRSTRLEN) != NULL)
+	// Check that this is an SIS-IS address
+	struct in6_addr * addr = &route->p->prefix;
+	if (sisis_addr_is_sisis(addr))
 	{
-		uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-		if (get_sisis_addr_components(prefix_str, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+		uint64_t process_type = sisis_addr_get_process_type(addr), process_version = sisis_addr_get_process_version(addr), sys_id = sisis_addr_get_sys_id(addr);
+		
+		// Get process number and name to send
+		process_visualization_info_t proc_info = get_process_info((int)process_type, (int)process_version);
+		
+		// Send message
+		char buf[512];
+		if (--num_proc_pre_host[sys_id%16] == 0)
 		{
-			// Check that this is an SIS-IS address
-			if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
-			{
-				// Get process number and name to send
-				process_visualization_info_t proc_info = get_process_info((int)process_type, (int)process_version);
-				
-				// Send message
-				char buf[512];
-				if (--num_proc_pre_host[sys_id%16] == 0)
-				{
-					sprintf(buf, "hostDown %llu\n", sys_id % 16);
-					send(sockfd, buf, strlen(buf), 0);
-				}
-				sprintf(buf, "procDel %llu %i %s\n", sys_id % 16, proc_info.proc_num, proc_info.desc);
-				send(sockfd, buf, strlen(buf), 0);
-			}
+			sprintf(buf, "hostDown %llu\n", sys_id % 16);
+			send(sockfd, buf, strlen(buf), 0);
 		}
+		sprintf(buf, "procDel %llu %i %s\n", sys_id % 16, proc_info.proc_num, proc_info.desc);
+		send(sockfd, buf, strlen(buf), 0);
 	}
 	
 	// Free memory
@@ -351,7 +341,7 @@ int main (int argc, char ** argv)
 	info.rib_add_ipv6_route = rib_monitor_add_ipv6_route;
 	info.rib_remove_ipv6_route = rib_monitor_remove_ipv6_route;
 	info.data = NULL;
-	subscribe_to_rib_changes(&info);
+	subscribe_to_sisis_rib_changes(&info, -1);
 	
 	// Do nothing
 	while (1)
@@ -21,6 +21,7 @@
 #include "voter.h"
 #include "redundancy.h"
 #include "table.h"
+#include "chunk.h"
 
 #include "../tests/sisis_api.h"
 #include "../tests/sisis_process_types.h"
@@ -34,8 +35,9 @@ pthread_t validate_thread;
 table_group_t merge_table_group;
 table_group_item_t * cur_merge_table_item;
 
-// Expected table
-demo_merge_table_entry expected_table[MAX_TABLE_SIZE];
+// Expected table.  Allocated from an arena freed for each new answer.
+table_arena_t expected_table_arena = { NULL };
+demo_merge_table_t expected_table;
 int expected_table_size = 0;
 struct timeval expected_table_received;
 int expected_table_checked = 1;
@@ -48,6 +50,7 @@ int main (int argc, char ** argv)
 	
 	// Setup list of tables
 	merge_table_group.first = NULL;
+	merge_table_group.arena.first = NULL;
 	
 	// Start main loop
 	redundancy_main((uint64_t)SISIS_PTYPE_DEMO1_VOTER, (uint64_t)VERSION, VOTER_PORT, (uint64_t)SISIS_PTYPE_DEMO1_JOIN, process_input, vote_and_process, flush_inputs, REDUNDANCY_MAIN_FLAG_SKIP_REDUNDANCY, argc, argv);
@@ -64,10 +67,18 @@ void * validator(void * param)
 	char port_str[16];
 	sprintf(port_str, "%u", VOTER_ANSWER_PORT);
 	int fd = make_socket(port_str);
+	chunk_set_recv_buffer(fd);
 	
 	// Receive buffer
 	int buflen;
 	char buf[RECV_BUFFER_SIZE];
+	struct sockaddr_in6 remote_addr;
+	socklen_t addr_size;
+	
+	// Answers arriving in several chunks
+	chunk_reassembler_t reassembler = { NULL };
+	char * msg;
+	int msglen;
 	
 	// Timing info
 	struct timeval tv_now, tv_diff;
@@ -75,7 +86,8 @@ void * validator(void * param)
 	// Receive message
 	while (1)
 	{
-		if ((buflen = recvfrom(fd, buf, RECV_BUFFER_SIZE, 0, NULL, NULL)) != -1)
+		addr_size = sizeof(remote_addr);
+		if ((buflen = recvfrom(fd, buf, RECV_BUFFER_SIZE, 0, (struct sockaddr *)&remote_addr, &addr_size)) != -1 && (msglen = chunk_receive(&reassembler, &remote_addr, buf, buflen, &msg)) > 0)
 		{
 			// Deserialize
 			int bytes_used;
@@ -96,9 +108,11 @@ void * validator(void * param)
 			
 			// Store new excepted information
 			gettimeofday(&expected_table_received, NULL);
-			expected_table_size = deserialize_join_table(expected_table, MAX_TABLE_SIZE, buf, buflen, &bytes_used);
+			table_arena_free(&expected_table_arena);
+			expected_table_size = deserialize_join_table(&expected_table, &expected_table_arena, msg, msglen, &bytes_used);
 			expected_table_checked = 0;
 			pthread_mutex_unlock(&expected_table_mutex);
+			free(msg);
 			
 			// Output missed result
 			if (miss)
@@ -123,29 +137,30 @@ void process_input(char * buf, int buflen)
 	if (merge_table_group.first == NULL)
 	{
 		// Table
-		cur_merge_table_item = malloc(sizeof(*cur_merge_table_item));
+		cur_merge_table_item = table_arena_alloc(&merge_table_group.arena, sizeof(*cur_merge_table_item));
 		merge_table_group.first = cur_merge_table_item;
 	}
 	else
 	{
 		// Table 1
-		cur_merge_table_item->next = malloc(sizeof(*cur_merge_table_item->next));
+		cur_merge_table_item->next = table_arena_alloc(&merge_table_group.arena, sizeof(*cur_merge_table_item->next));
 		cur_merge_table_item = cur_merge_table_item->next;
 	}
 	
 	// Check memory
 	if (cur_merge_table_item == NULL)
 	{ printf("Out of memory.\n"); exit(0); }
-	cur_merge_table_item->table = malloc(sizeof(demo_merge_table_entry)*MAX_TABLE_SIZE);
 	cur_merge_table_item->next = NULL;
 	
+	cur_merge_table_item->table = table_arena_alloc(&merge_table_group.arena, sizeof(demo_merge_table_t));
+	
 	// Check memory
 	if (cur_merge_table_item->table == NULL)
 	{ printf("Out of memory.\n"); exit(0); }
 	
-	// Deserialize
+	// Deserialize.  A join error is sent as an invalid row count.
 	int bytes_used;
-	cur_merge_table_item->table_size = deserialize_join_table(cur_merge_table_item->table, MAX_TABLE_SIZE, buf, buflen, &bytes_used);
+	cur_merge_table_item->table_size = deserialize_join_table(cur_merge_table_item->table, &merge_table_group.arena, buf, buflen, &bytes_used);
 }
 
 /** Vote on input and process */
@@ -165,7 +180,7 @@ void vote_and_process()
 			printf("Join error.\n");
 		else
 		{
-			demo_merge_table_entry * join_table = (demo_merge_table_entry *)merge_table_item->table;
+			demo_merge_table_t * join_table = (demo_merge_table_t *)merge_table_item->table;
 			
 			// Get current time
 			struct timeval tv_now, tv_diff;
@@ -175,7 +190,7 @@ void vote_and_process()
 			/*
 			printf("Joined Rows: %d\n", merge_table_item->table_size);
 			for (i = 0; i < merge_table_item->table_size; i++)
-				printf("User Id: %d\tName: %s\tGender: %c\n", join_table[i].user_id, join_table[i].name, join_table[i].gender);
+				printf("User Id: %d\tName: %s\tGender: %c\n", join_table->user_id[i], table_name(join_table->names, join_table->name[i]), join_table->gender[i]);
 			*/
 			pthread_mutex_lock(&expected_table_mutex);
 			// Determine time that passed
@@ -184,12 +199,8 @@ void vote_and_process()
 			short correct = 1;
 			if (expected_table_size != merge_table_item->table_size)
 				correct = 0;
-			else
-			{
-				for (i = 0; correct && i < expected_table_size; i++)
-					if (join_table[i].user_id != expected_table[i].user_id || strcmp(join_table[i].name, expected_table[i].name) != 0 || join_table[i].gender != expected_table[i].gender)
-						correct = 0;
-			}
+			else if (merge_table_distance(join_table, merge_table_item->table_size, &expected_table, expected_table_size) != 0)
+				correct = 0;
 			expected_table_checked = 1;
 			pthread_mutex_unlock(&expected_table_mutex);
 			
@@ -208,7 +219,7 @@ void vote_and_process()
 			{
 				printf("********************************** Voted Table *********************************\n");
 				for (i = 0; i < merge_table_item->table_size; i++)
-					printf("User Id: %d\tName: %s\tGender: %c\n", join_table[i].user_id, join_table[i].name, join_table[i].gender);
+					printf("User Id: %d\tName: %s\tGender: %c\n", join_table->user_id[i], table_name(join_table->names, join_table->name[i]), join_table->gender[i]);
 			}
 			
 			// Check if any of the input tables disagreed with the voter on table
@@ -220,12 +231,12 @@ void vote_and_process()
 				if (!correct)
 				{
 					printf("********************************** Input Table *********************************\n");
-					demo_merge_table_entry * t1 = (demo_merge_table_entry *)(item->table);
+					demo_merge_table_t * t1 = (demo_merge_table_t *)(item->table);
 					for (i = 0; i < item->table_size; i++)
-						printf("User Id: %d\tName: %s\tGender: %c\n", t1[i].user_id, t1[i].name, t1[i].gender);
+						printf("User Id: %d\tName: %s\tGender: %c\n", t1->user_id[i], table_name(t1->names, t1->name[i]), t1->gender[i]);
 				}
 				
-				if (merge_table_distance((demo_merge_table_entry *)(item->table), item->table_size, (demo_merge_table_entry *)merge_table_item->table, merge_table_item->table_size))
+				if (merge_table_distance((demo_merge_table_t *)(item->table), item->table_size, (demo_merge_table_t *)merge_table_item->table, merge_table_item->table_size))
 					num_diff++;
 				
 				// Get next item
@@ -23,6 +23,7 @@
 #include "../tests/sisis_api.h"
 #include "../tests/sisis_structs.h"
 #include "../tests/sisis_process_types.h"
+#include "../tests/sisis_addr_format.h"
 
 #define VERSION 1
 
@@ -192,11 +193,10 @@ int main (int argc, char ** argv)
 		if (inet_ntop(AF_INET6, remote_addr, addr_str, INET6_ADDRSTRLEN+1) != 1)
 		{
 			// Get SIS-IS address info
-			uint64_t remote_host_num;
-			get_sisis_addr_components(addr_str, NULL, NULL, NULL, NULL, &remote_host_num, NULL, NULL);
+			uint64_t remote_host_num = sisis_addr_get_sys_id(remote_addr);
 			
 			uint64_t t1,t2,t3,t4,t5,t6,t7;
-			get_sisis_addr_components(addr_str, &t1,&t2,&t3,&t4,&t5,&t6,&t7);
+			get_sisis_in6_addr_components(remote_addr, &t1,&t2,&t3,&t4,&t5,&t6,&t7);
 			printf("%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n", t1,t2,t3,t4,t5,t6,t7);
 			
 			printf("Host[%llu]: %s\n", remote_host_num, addr_str);
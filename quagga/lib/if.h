@@ -178,8 +178,12 @@ struct connected
   /* Label for Linux 2.2.X and upper. */
   char *label;
 	
-	/* Expiration date, if ZEBRA_IFA_EXPIRES flag is set. */
-	time_t expires;
+	/* Expiration deadline on the monotonic clock in milliseconds, if
+	   ZEBRA_IFA_EXPIRES flag is set. */
+	u_int64_t expires;
+
+	/* Position in zebra's expiry queue plus one, or zero if not queued. */
+	int expires_pos;
 };
 
 /* Does the destination field contain a peer address? */
@@ -862,6 +862,8 @@ static const struct zebra_desc_table command_types[] = {
   DESC_ENTRY	(ZEBRA_ROUTER_ID_ADD),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_DELETE),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_UPDATE),
+  DESC_ENTRY	(ZEBRA_INTERFACE_ADDRESS_ADD_BATCH),
+  DESC_ENTRY	(ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH),
 };
 #undef DESC_ENTRY
 
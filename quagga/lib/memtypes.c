@@ -249,6 +249,11 @@ struct memory_list memory_list_sisis[] =
 {
   { MTYPE_SISIS,			"SIS-IS instance"			},
   { MTYPE_SISIS_LISTENER,		"SIS-IS listen socket details"	},
+  { MTYPE_SISIS_CLIENT,			"SIS-IS client"				},
+  { MTYPE_SISIS_REQUEST,		"SIS-IS queued request"			},
+  { MTYPE_SISIS_SUBSCRIPTION,		"SIS-IS client subscription"		},
+  { MTYPE_SISIS_ADMISSION,		"SIS-IS admitted address"		},
+  { MTYPE_SISIS_BUCKET,		"SIS-IS rate limit bucket"		},
   { -1, NULL }
 };
 
@@ -193,6 +193,11 @@ enum
   MTYPE_ISIS_EXTERNAL_INFO,
   MTYPE_SISIS,
   MTYPE_SISIS_LISTENER,
+  MTYPE_SISIS_CLIENT,
+  MTYPE_SISIS_REQUEST,
+  MTYPE_SISIS_SUBSCRIPTION,
+  MTYPE_SISIS_ADMISSION,
+  MTYPE_SISIS_BUCKET,
   MTYPE_SHIM,
   MTYPE_SHIM_SISIS_LISTENER,
   MTYPE_ROSPF6_SHIM_MESSAGE,
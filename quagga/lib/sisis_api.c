@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -21,6 +22,7 @@
 #include <sys/time.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <fcntl.h>
 #include <sockunion.h>
 
 #include <zebra.h>
@@ -29,10 +31,15 @@
 #include "sisis_structs.h"
 #include "sisis_api.h"
 #include "sisis_netlink.h"
+#include "sisis_addr_index.h"
+#include "sisis_registry.h"
 
 //#define TIME_DEBUG
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
+#ifndef MAX
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+#endif
 
 int socket_opened = 0;
 int sisis_socket = 0;
@@ -40,6 +47,9 @@ struct sockaddr_in sisis_listener_addr;
 
 int sisis_listener_port = 54345;
 char * sisis_listener_ip_addr = "127.0.0.1";
+char * sisis_listener_unix_path = NULL;
+int sisis_socket_unix = 0;
+unsigned int sisis_address_ttl = SISIS_ADDRESS_TTL_DEFAULT;
 unsigned int next_request_id = 1;
 
 // IPv4/IPv6 Ribs
@@ -54,20 +64,78 @@ struct list_sis * ipv6_rib_routes = NULL;
 
 int sisis_socket_open();
 
-// Reregistration information
-pthread_mutex_t reregistration_array_mutex = PTHREAD_MUTEX_INITIALIZER;
-reregistration_info_t * reregistrations[MAX_REREGISTRATION_THREADS] = { NULL };
+// Reregistration timer wheel.  Each slot holds the addresses that come due
+// on that tick; addresses more than one revolution out wait extra rounds.
+pthread_mutex_t reregistration_mutex = PTHREAD_MUTEX_INITIALIZER;
+reregistration_info_t * reregistration_wheel[SISIS_REREGISTRATION_WHEEL_SLOTS] = { NULL };
+unsigned int reregistration_wheel_pos = 0;
+unsigned int reregistration_seed = 0;
+short reregistration_thread_started = 0;
+pthread_t reregistration_thread;
+#ifdef USE_IPV6
+reregistration_batch_t * reregistration_batch_pool = NULL;		// Free refresh batches
+#endif /* USE_IPV6 */
 
 // Listen for messages
 pthread_t sisis_recv_from_thread;
 void * sisis_recv_loop(void *);
 
-// Request which we are waiting for an ACK or NACK for
-pthread_mutex_t awaiting_acks_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
-struct sisis_request_ack_info awaiting_acks_pool[AWAITING_ACK_POOL_SIZE] = { { 0, 0, PTHREAD_MUTEX_INITIALIZER, 0} };
+// Requests which we are waiting for an ACK or NACK for, in an open
+// addressing table indexed by request id.  A slot's key holds the request id
+// and state and only changes by compare and swap, so whoever takes a request
+// out of a waiting state owns it.  Matching an ACK takes no lock.
+struct sisis_request_slot sisis_requests[SISIS_REQUEST_TABLE_SIZE];
+uint64_t next_request_expiry_check = 0;
+
+// Completed asynchronous requests waiting for sisis_dispatch_completions()
+pthread_mutex_t completed_requests_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Freed asynchronous requests kept for reuse
+#define SISIS_REQUEST_ASYNC_SIZE (sizeof(struct sisis_request_ack_info) + (SISIS_MAX_BATCH_ADDRESSES + 7) / 8)
+pthread_mutex_t request_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+struct sisis_request_ack_info * request_pool = NULL;
+int request_pool_size = 0;
+struct sisis_request_ack_info * completed_requests_head = NULL, * completed_requests_tail = NULL;
+int completion_pipe[2] = { -1, -1 };
+
+#ifdef USE_IPV6
+// Address change subscriptions
+pthread_mutex_t subscriptions_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t subscriptions_cond = PTHREAD_COND_INITIALIZER;
+struct sisis_subscription_info * subscriptions = NULL;
+unsigned int next_subscription_id = 1;
+static void sisis_notify_subscription(unsigned int id, char * msg, int msg_len);
+static void sisis_resubscribe(void);
+#endif /* USE_IPV6 */
 
 /**
- * Sets up socket to SIS-IS listener.
+ * Connects a Unix socket to the SIS-IS listener.
+ *
+ * Returns the socket or -1 on error.
+ */
+static int sisis_unix_connect()
+{
+	struct sockaddr_un addr;
+	if (strlen(sisis_listener_unix_path) >= sizeof(addr.sun_path))
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, sisis_listener_unix_path);
+	
+	int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (sock < 0)
+		return -1;
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+/**
+ * Sets up socket to SIS-IS listener.  The Unix socket is used if one is set
+ * and sisisd is listening on it, otherwise UDP.
  */
 int sisis_socket_open()
 {
@@ -75,7 +143,9 @@ int sisis_socket_open()
 		return 0;
 	
 	// Open socket
-	if ((sisis_socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+	if (sisis_listener_unix_path != NULL && (sisis_socket = sisis_unix_connect()) >= 0)
+		sisis_socket_unix = 1;
+	else if ((sisis_socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
 		return 1;
 
 	// Set up address info
@@ -86,9 +156,13 @@ int sisis_socket_open()
 	addr.sin_port = htons(0);	// Any port
 
 	// Bind client socket
-	if (bind(sisis_socket, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+	if (!sisis_socket_unix && bind(sisis_socket, (struct sockaddr *) &addr, sizeof (addr)) < 0)
 		return 1;
 	
+	// Wake up the receive thread periodically to time out asynchronous requests
+	struct timeval tv = { 1, 0 };
+	setsockopt(sisis_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	
 	// Set up SIS-IS listener address structure
 	memset(&sisis_listener_addr, 0, sizeof(sisis_listener_addr));
 	sisis_listener_addr.sin_family = AF_INET;
@@ -109,11 +183,239 @@ int sisis_socket_open()
 int sisis_send(char * buf, unsigned int buf_len)
 {
 	unsigned int rtn = -1;
-	if (sisis_socket)
+	if (sisis_socket_unix)
+		rtn = send(sisis_socket, buf, buf_len, MSG_NOSIGNAL);
+	else if (sisis_socket)
 		rtn = sendto(sisis_socket, buf, buf_len, 0, (struct sockaddr *) &sisis_listener_addr, sizeof (sisis_listener_addr));
 	return rtn;
 }
 
+/** Allocates a request id.  Zero is never used. */
+static unsigned int sisis_request_id()
+{
+	unsigned int request_id;
+	while ((request_id = __sync_fetch_and_add(&next_request_id, 1)) == 0);
+	return request_id;
+}
+
+/** Slot a request id is tried in on the given probe. */
+#define SISIS_REQUEST_SLOT(request_id, probe) (&sisis_requests[((request_id) + (probe)) & (SISIS_REQUEST_TABLE_SIZE - 1)])
+
+/** Slot key for a request id and state. */
+#define SISIS_REQUEST_KEY(request_id, state) (((uint64_t)(request_id) << 32) | (state))
+#define SISIS_REQUEST_KEY_ID(key) ((unsigned int)((key) >> 32))
+#define SISIS_REQUEST_KEY_STATE(key) ((unsigned int)((key) & 0xffffffff))
+
+/**
+ * Adds a request to the table.  Its ACK can be matched once this returns.
+ *
+ * Returns zero on success or -1 if there is no free slot near its id.
+ */
+static int sisis_request_insert(struct sisis_request_ack_info * info)
+{
+	int i;
+	for (i = 0; i < SISIS_REQUEST_MAX_PROBES; i++)
+	{
+		struct sisis_request_slot * slot = SISIS_REQUEST_SLOT(info->request_id, i);
+		if (slot->key == SISIS_REQUEST_SLOT_EMPTY && __sync_bool_compare_and_swap(&slot->key, SISIS_REQUEST_SLOT_EMPTY, SISIS_REQUEST_KEY(info->request_id, SISIS_REQUEST_SLOT_RESERVED)))
+		{
+			slot->info = info;
+			slot->deadline = (uint64_t)info->deadline.tv_sec * 1000 + info->deadline.tv_nsec / 1000000;
+			__sync_synchronize();
+			slot->key = SISIS_REQUEST_KEY(info->request_id, info->callback ? SISIS_REQUEST_SLOT_PENDING : SISIS_REQUEST_SLOT_WAITING);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/** Empties a slot its caller has claimed and returns its request. */
+static struct sisis_request_ack_info * sisis_request_slot_empty(struct sisis_request_slot * slot)
+{
+	struct sisis_request_ack_info * info = slot->info;
+	slot->info = NULL;
+	__sync_synchronize();
+	slot->key = SISIS_REQUEST_SLOT_EMPTY;
+	return info;
+}
+
+/**
+ * Takes a request out of the table if it is still waiting.  Of the receive
+ * thread and the caller giving up, only one gets it.
+ *
+ * Returns the request or NULL if it is not waiting.
+ */
+static struct sisis_request_ack_info * sisis_request_remove(unsigned int request_id)
+{
+	int i;
+	for (i = 0; i < SISIS_REQUEST_MAX_PROBES; i++)
+	{
+		struct sisis_request_slot * slot = SISIS_REQUEST_SLOT(request_id, i);
+		uint64_t key = slot->key;
+		unsigned int state = SISIS_REQUEST_KEY_STATE(key);
+		if (SISIS_REQUEST_KEY_ID(key) == request_id && (state == SISIS_REQUEST_SLOT_WAITING || state == SISIS_REQUEST_SLOT_PENDING))
+		{
+			if (__sync_bool_compare_and_swap(&slot->key, key, SISIS_REQUEST_KEY(request_id, SISIS_REQUEST_SLOT_CLAIMED)))
+				return sisis_request_slot_empty(slot);
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+/** Gets a zeroed asynchronous request, reusing a freed one if possible. */
+static struct sisis_request_ack_info * sisis_request_alloc()
+{
+	pthread_mutex_lock(&request_pool_mutex);
+	struct sisis_request_ack_info * info = request_pool;
+	if (info != NULL)
+	{
+		request_pool = info->next;
+		request_pool_size--;
+	}
+	pthread_mutex_unlock(&request_pool_mutex);
+	
+	if (info == NULL && (info = malloc(SISIS_REQUEST_ASYNC_SIZE)) == NULL)
+		return NULL;
+	memset(info, 0, SISIS_REQUEST_ASYNC_SIZE);
+	return info;
+}
+
+/** Frees an asynchronous request, keeping it for reuse while the pool is small. */
+static void sisis_request_free(struct sisis_request_ack_info * info)
+{
+	pthread_mutex_lock(&request_pool_mutex);
+	if (request_pool_size < SISIS_REQUEST_POOL_MAX)
+	{
+		info->next = request_pool;
+		request_pool = info;
+		request_pool_size++;
+		info = NULL;
+	}
+	pthread_mutex_unlock(&request_pool_mutex);
+	free(info);
+}
+
+/** Callback status for a finished request. */
+static int sisis_request_status(struct sisis_request_ack_info * info)
+{
+	if (info->flags & SISIS_REQUEST_ACK_INFO_ACKED)
+		return SISIS_REQUEST_ACKED;
+	if (info->flags & SISIS_REQUEST_ACK_INFO_NACKED)
+		return SISIS_REQUEST_NACKED;
+	return SISIS_REQUEST_TIMED_OUT;
+}
+
+/**
+ * Finishes an asynchronous request that has been removed from the hash.  The
+ * callback runs now unless a completion fd is in use, in which case it is
+ * queued for sisis_dispatch_completions().
+ */
+static void sisis_request_complete(struct sisis_request_ack_info * info)
+{
+	pthread_mutex_lock(&completed_requests_mutex);
+	if (completion_pipe[1] != -1 && !(info->flags & SISIS_REQUEST_ACK_INFO_INTERNAL))
+	{
+		if (completed_requests_tail)
+			completed_requests_tail->next = info;
+		else
+			completed_requests_head = info;
+		completed_requests_tail = info;
+		pthread_mutex_unlock(&completed_requests_mutex);
+		
+		char c = 0;
+		write(completion_pipe[1], &c, 1);
+		return;
+	}
+	pthread_mutex_unlock(&completed_requests_mutex);
+	
+	info->callback(info->request_id, sisis_request_status(info), info->bitmap, info->bitmap_bits, info->data);
+	sisis_request_free(info);
+}
+
+/** Times out asynchronous requests that are past their deadline. */
+static void sisis_expire_requests()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t now_ms = (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+	
+	// At most every SISIS_REQUEST_EXPIRY_CHECK_MS
+	uint64_t next_check = next_request_expiry_check;
+	if (now_ms < next_check || !__sync_bool_compare_and_swap(&next_request_expiry_check, next_check, now_ms + SISIS_REQUEST_EXPIRY_CHECK_MS))
+		return;
+	
+	int i;
+	for (i = 0; i < SISIS_REQUEST_TABLE_SIZE; i++)
+	{
+		struct sisis_request_slot * slot = &sisis_requests[i];
+		uint64_t key = slot->key;
+		if (SISIS_REQUEST_KEY_STATE(key) != SISIS_REQUEST_SLOT_PENDING)
+			continue;
+		
+		// The deadline belongs to the request if the key is unchanged
+		__sync_synchronize();
+		uint64_t deadline = slot->deadline;
+		if (deadline <= now_ms && __sync_bool_compare_and_swap(&slot->key, key, SISIS_REQUEST_KEY(SISIS_REQUEST_KEY_ID(key), SISIS_REQUEST_SLOT_CLAIMED)))
+			sisis_request_complete(sisis_request_slot_empty(slot));
+	}
+}
+
+/**
+ * Gets a file descriptor that becomes readable when asynchronous requests
+ * finish.  Once this is called, callbacks are no longer run from the receive
+ * thread; call sisis_dispatch_completions() when the fd is readable to run
+ * them on the caller's thread.
+ *
+ * Returns the fd or -1 on error.
+ */
+int sisis_completion_fd(void)
+{
+	pthread_mutex_lock(&completed_requests_mutex);
+	if (completion_pipe[0] == -1)
+	{
+		if (pipe(completion_pipe) == 0)
+		{
+			fcntl(completion_pipe[0], F_SETFL, O_NONBLOCK);
+			fcntl(completion_pipe[1], F_SETFL, O_NONBLOCK);
+		}
+		else
+			completion_pipe[0] = completion_pipe[1] = -1;
+	}
+	int fd = completion_pipe[0];
+	pthread_mutex_unlock(&completed_requests_mutex);
+	return fd;
+}
+
+/**
+ * Runs the callbacks of finished asynchronous requests.
+ *
+ * Returns the number of callbacks run.
+ */
+int sisis_dispatch_completions(void)
+{
+	// Drain the pipe
+	char buf[64];
+	if (completion_pipe[0] != -1)
+		while (read(completion_pipe[0], buf, sizeof(buf)) > 0);
+	
+	pthread_mutex_lock(&completed_requests_mutex);
+	struct sisis_request_ack_info * info = completed_requests_head;
+	completed_requests_head = completed_requests_tail = NULL;
+	pthread_mutex_unlock(&completed_requests_mutex);
+	
+	int cnt = 0;
+	while (info != NULL)
+	{
+		struct sisis_request_ack_info * next = info->next;
+		info->callback(info->request_id, sisis_request_status(info), info->bitmap, info->bitmap_bits, info->data);
+		sisis_request_free(info);
+		info = next;
+		cnt++;
+	}
+	return cnt;
+}
+
 /**
  * Receive messages from the SIS-IS listener.
  */
@@ -124,7 +426,9 @@ void * sisis_recv_loop(void * null)
 	while (1)
 	{
 		buf_len = sisis_recv(buf, 1024);
-		sisis_process_message(buf, buf_len);
+		if (buf_len > 0)
+			sisis_process_message(buf, buf_len);
+		sisis_expire_requests();
 	}
 }
 
@@ -147,36 +451,43 @@ void sisis_process_message(char * msg, int msg_len)
 		if (msg_len >= 8)
 			command = ntohs(*(unsigned short *)(msg+6));
 		
-		int i;
+		struct sisis_request_ack_info * info;
 		switch (command)
 		{
 			case SISIS_ACK:
-				// Find associated info
-				pthread_mutex_lock(&awaiting_acks_pool_mutex);
-				for (i =  0; i < AWAITING_ACK_POOL_SIZE && (!awaiting_acks_pool[i].valid || awaiting_acks_pool[i].request_id != request_id); i++);
-				if (i < AWAITING_ACK_POOL_SIZE)
-				{
-					awaiting_acks_pool[i].flags |= SISIS_REQUEST_ACK_INFO_ACKED;
-				
-					// Free mutex
-					pthread_mutex_unlock(&awaiting_acks_pool[i].mutex);
-				}
-				pthread_mutex_unlock(&awaiting_acks_pool_mutex);
-				break;
 			case SISIS_NACK:
-				// Find associated info
-				pthread_mutex_lock(&awaiting_acks_pool_mutex);
-				for (i =  0; i < AWAITING_ACK_POOL_SIZE && (!awaiting_acks_pool[i].valid || awaiting_acks_pool[i].request_id != request_id); i++);
-				if (i < AWAITING_ACK_POOL_SIZE)
+				// Find associated info.  Nothing else touches it once it is ours.
+				if ((info = sisis_request_remove(request_id)) != NULL)
 				{
-					awaiting_acks_pool[i].flags |= SISIS_REQUEST_ACK_INFO_NACKED;
-				
-					// Free mutex
-					pthread_mutex_unlock(&awaiting_acks_pool[i].mutex);
+					// Batch replies carry a count and one bit per address
+					if (command == SISIS_ACK && info->bitmap != NULL && msg_len >= 10)
+					{
+						int bits = MIN(ntohs(*(unsigned short *)(msg+8)), info->bitmap_bits);
+						int bytes = MIN((bits + 7) / 8, msg_len - 10);
+						memcpy(info->bitmap, msg+10, bytes);
+					}
+					
+					short flag = (command == SISIS_ACK) ? SISIS_REQUEST_ACK_INFO_ACKED : SISIS_REQUEST_ACK_INFO_NACKED;
+					if (info->callback == NULL)
+					{
+						// Wake up synchronous caller.  Its info is gone once the mutex is released.
+						pthread_mutex_lock(&info->mutex);
+						info->flags |= flag;
+						pthread_cond_signal(&info->cond);
+						pthread_mutex_unlock(&info->mutex);
+					}
+					else
+					{
+						info->flags |= flag;
+						sisis_request_complete(info);
+					}
 				}
-				pthread_mutex_unlock(&awaiting_acks_pool_mutex);
-				
 				break;
+#ifdef USE_IPV6
+			case SISIS_NOTIFY_ADDRESSES:
+				sisis_notify_subscription(request_id, msg, msg_len);
+				break;
+#endif /* USE_IPV6 */
 		}
 	}
 }
@@ -191,36 +502,59 @@ int sisis_recv(char * buf, unsigned int buf_len)
 	memset(&addr, 0, sizeof(addr));	// Clear structure
 	int addr_len = sizeof(addr);
 	
-	unsigned int rtn = -1;
-	if (sisis_socket)
+	int rtn = -1;
+	if (sisis_socket_unix)
+	{
+		rtn = recv(sisis_socket, buf, buf_len, 0);
+		if (rtn == 0)
+		{
+			// sisisd went away.  Reconnect on the same descriptor so senders
+			// are unaffected; requests in flight time out.
+			int sock = sisis_unix_connect();
+			if (sock >= 0)
+			{
+				struct timeval tv = { 1, 0 };
+				setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+				dup2(sock, sisis_socket);
+				close(sock);
+#ifdef USE_IPV6
+				sisis_resubscribe();
+#endif /* USE_IPV6 */
+			}
+			else
+				sleep(1);
+			rtn = -1;
+		}
+	}
+	else if (sisis_socket)
 	{
 		do
 		{
 			rtn = -1;
 			rtn = recvfrom(sisis_socket, buf, buf_len, 0, (struct sockaddr *) &addr, &addr_len);
-		}while (addr.sin_family != sisis_listener_addr.sin_family || addr.sin_addr.s_addr != sisis_listener_addr.sin_addr.s_addr || addr.sin_port != sisis_listener_addr.sin_port);
+		}while (rtn >= 0 && (addr.sin_family != sisis_listener_addr.sin_family || addr.sin_addr.s_addr != sisis_listener_addr.sin_addr.s_addr || addr.sin_port != sisis_listener_addr.sin_port));
 	}
 	return rtn;
 }
 
 /**
- * Constructs SIS-IS message.  Remember to free memory when done.
- * Duplicated in sisisd.c
- * Returns length of message.
+ * Constructs SIS-IS message in buf, which must hold SISIS_MAX_MESSAGE_SIZE
+ * bytes.  Duplicated in sisisd.c
+ * Returns length of message, or 0 if the data does not fit.
  */
-int sisis_construct_message(char ** buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len)
+int sisis_construct_message(char * buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len)
 {
 	unsigned int buf_len = data_len + 8;
-	*buf = malloc(sizeof(char) * buf_len);
-	if (*buf == NULL)
+	if (buf_len > SISIS_MAX_MESSAGE_SIZE)
 		return 0;
 	version = htons(version);
 	request_id = htonl(request_id);
 	cmd = htons(cmd);
-	memcpy(*buf, &version, 2);
-	memcpy(*buf+2, &request_id, 4);
-	memcpy(*buf+6, &cmd, 2);
-	memcpy(*buf+8, data, data_len);
+	memcpy(buf, &version, 2);
+	memcpy(buf+2, &request_id, 4);
+	memcpy(buf+6, &cmd, 2);
+	if (data_len)
+		memcpy(buf+8, data, data_len);
 	return buf_len;
 }
 
@@ -228,64 +562,65 @@ int sisis_construct_message(char ** buf, unsigned short version, unsigned int re
 /**
  * Construct SIS-IS address.
  *
- * sisis_addr String to store resulting SIS-IS/IP address in.
+ * sisis_addr Address to store resulting SIS-IS/IP address in.
  *
  * Returns zero on success.
  */
-int sisis_create_addr_from_va_list(char * sisis_addr, va_list args)
+static int sisis_create_in6_addr_from_va_list(struct in6_addr * sisis_addr, va_list args)
 {
 	// Check that the components were set up
 	if (components == NULL)
 		return 1;
 	
-	int comp = 0, bit = 0, consumed_bits = 0, comp_bits = components[comp].bits;
-	unsigned short part = 0;
-	uint64_t arg = (components[comp].flags & SISIS_COMPONENT_FIXED) ? components[comp].fixed_val : va_arg(args, uint64_t);
-	for (; bit < 128; bit+=consumed_bits)
+	memset(sisis_addr, 0, sizeof(*sisis_addr));
+	int comp = 0, bit = 0;
+	for (; comp < num_components && bit < 128; bit += components[comp].bits, comp++)
 	{
-		// Find next component with available bits
-		while (comp_bits == 0 && comp + 1 < num_components)
-		{
-			comp++;
-			comp_bits = components[comp].bits;
-			if (components[comp].flags & SISIS_COMPONENT_FIXED)
-				arg = components[comp].fixed_val;
-			else
-				arg = va_arg(args, uint64_t);
-		}
-		// Fill remainder with zeros if there are no more components
-		if (comp_bits == 0)
-		{
-			consumed_bits = 16 - (bit % 16);
-			part <<= consumed_bits;
-		}
-		// Otherwise, copy from arg
-		else
-		{
-			consumed_bits = MIN(16 - (bit % 16), comp_bits);
-			//printf("Consumed: %d\n", consumed_bits);
-			//printf("Arg: %llu\n", arg);
-			int i = 0;
-			for (; i < consumed_bits; i++)
-			{
-				part <<= 1;
-				comp_bits--;
-				part |= (arg >> comp_bits) & 0x1;
-			}
-			//printf("%hu\n", part);
-		}
-		
-		// Print now?
-		if ((bit + consumed_bits) % 16 == 0)
-		{
-			sprintf(sisis_addr+(bit/16)*5, "%04hx%s", part, bit + consumed_bits == 128 ? "" : ":");
-			part = 0;
-		}
+		uint64_t arg = (components[comp].flags & SISIS_COMPONENT_FIXED) ? components[comp].fixed_val : va_arg(args, uint64_t);
+		sisis_addr_set_bits(sisis_addr, bit, components[comp].bits, arg);
 	}
 	
 	return 0;
 }
 
+/**
+ * Construct SIS-IS address.
+ *
+ * sisis_addr Address to store resulting SIS-IS/IP address in.
+ * 
+ * Returns zero on success.
+ */
+int sisis_create_in6_addr(struct in6_addr * sisis_addr, ...)
+{
+	va_list args;
+	va_start(args, sisis_addr);
+	int rtn = sisis_create_in6_addr_from_va_list(sisis_addr, args);
+	va_end(args);
+	
+	return rtn;
+}
+
+/**
+ * Construct SIS-IS address.
+ *
+ * sisis_addr String to store resulting SIS-IS/IP address in.
+ *
+ * Returns zero on success.
+ */
+int sisis_create_addr_from_va_list(char * sisis_addr, va_list args)
+{
+	struct in6_addr addr;
+	if (sisis_create_in6_addr_from_va_list(&addr, args))
+		return 1;
+	
+	// Print each 16 bit part
+	int part = 0;
+	for (; part < 8; part++)
+		sprintf(sisis_addr+part*5, "%02x%02x%s", addr.s6_addr[part*2], addr.s6_addr[part*2+1], part == 7 ? "" : ":");
+	
+	return 0;
+}
+
 /**
  * Construct SIS-IS address.
  *
@@ -310,89 +645,53 @@ int sisis_create_addr(char * sisis_addr, ...)
  *
  * Returns zero on success.
  */
-int get_sisis_addr_components_from_va_list(char * sisis_addr, va_list args)
+static int get_sisis_in6_addr_components_from_va_list(const struct in6_addr * sisis_addr, va_list args)
 {
 	// Check that the components were set up
 	if (components == NULL)
 		return 1;
 	
-	// Remove :: and ensure 4 numbers per 16 bits
-	int idx, idx2, len = strlen(sisis_addr);
-	char before[INET6_ADDRSTRLEN], after[INET6_ADDRSTRLEN], full[INET6_ADDRSTRLEN+1];
-	full[0] = 0;
-	// Count colons
-	int colons = 0;
-	for (idx = 0; idx < len; idx++)
-		if (sisis_addr[idx] == ':')
-			colons++;
-	for (idx = 0, idx2 = 0; idx < len; idx++)
+	int comp = 0, bit = 0;
+	for (; comp < num_components && bit < 128; bit += components[comp].bits, comp++)
 	{
-		if (idx > 1 && sisis_addr[idx-1] == ':' && sisis_addr[idx] == ':')
-		{
-			for (colons--; colons < 7; colons++)
-			{
-				full[idx2++] = '0';
-				full[idx2++] = ':';
-			}
-			if (idx + 1 == len)
-				full[idx2++] = '0';
-			full[idx2] = 0;
-		}
-		else
-		{
-			full[idx2] = sisis_addr[idx];
-			idx2++;
-			full[idx2] = 0;
-		}
+		uint64_t * arg = va_arg(args, uint64_t *);
+		if (arg != NULL)
+			*arg = sisis_addr_get_bits(sisis_addr, bit, components[comp].bits);
 	}
-	char * full_ptr = full;
 	
+	return 0;
+}
+
+/**
+ * Split an SIS-IS address into components.
+ *
+ * sisis_addr SIS-IS/IP address
+ */
+int get_sisis_in6_addr_components(const struct in6_addr * sisis_addr, ...)
+{
 	// Parse into args
-	int comp = 0, bit = 0, consumed_bits = 0, comp_bits = components[comp].bits;
-	unsigned short part = 0;
-	uint64_t * arg = va_arg(args, uint64_t *);
-	if (arg != NULL)
-		memset(arg, 0, sizeof(*arg));
-	for (; bit < 128; bit+=consumed_bits)
-	{
-		// Next part?
-		if (bit % 16 == 0)
-		{
-			sscanf(full_ptr, "%4hx", &part);
-			while (*full_ptr != '\0' && *full_ptr != ':')
-				full_ptr++;
-			if (*full_ptr == ':')
-				full_ptr++;
-		}
-		
-		consumed_bits = 16;
-		// Find next component with available bits
-		while (comp_bits == 0 && comp + 1 < num_components)
-		{
-			comp++;
-			comp_bits = components[comp].bits;
-			arg = va_arg(args, uint64_t *);
-			if (arg != NULL)
-				memset(arg, 0, sizeof(*arg));
-		}
-		// Make sure there are no more components
-		if (comp_bits > 0)
-		{
-			consumed_bits = MIN(16 - (bit % 16), comp_bits);
-			int i = 0;
-			for (; i < consumed_bits; i++)
-			{
-				comp_bits--;
-				if (arg != NULL)
-				{
-					*arg <<= 1;
-					*arg |= (part >> (15-((bit+i)%16))) & 0x1;
-				}
-			}
-		}
-	}
+	va_list args;
+	va_start(args, sisis_addr);
+	int rtn = get_sisis_in6_addr_components_from_va_list(sisis_addr, args);
+	va_end(args);
 	
-	return 0;
+	return rtn;
+}
+
+/**
+ * Split an SIS-IS address into components.
+ *
+ * sisis_addr SIS-IS/IP address.
+ *
+ * Returns zero on success.
+ */
+int get_sisis_addr_components_from_va_list(char * sisis_addr, va_list args)
+{
+	struct in6_addr addr;
+	if (inet_pton(AF_INET6, sisis_addr, &addr) != 1)
+		return 1;
+	
+	return get_sisis_in6_addr_components_from_va_list(&addr, args);
 }
 
 /**
@@ -446,115 +745,574 @@ struct sisis_addr_components get_sisis_addr_components(char * sisis_addr)
 #endif /* USE_IPV6 */
 
 /**
- * Does actual registration of SIS-IS address.
+ * Sends a request to the SIS-IS listener and waits for the ACK or NACK.  If
+ * bitmap is not NULL, the per address bitmap from a batch ACK is copied into
+ * it.
+ *
+ * Returns zero if the request was ACKed.
+ */
+static int sisis_send_request(unsigned short cmd, void * data, unsigned int data_len, unsigned char * bitmap, int bitmap_bits)
+{
+	// Setup socket
+	sisis_socket_open();
+	
+	// Set up request info.  The receive thread signals the condition once
+	// the ACK or NACK arrives.
+	struct sisis_request_ack_info info;
+	memset(&info, 0, sizeof(info));
+	pthread_mutex_init(&info.mutex, NULL);
+	pthread_cond_init(&info.cond, NULL);
+	info.bitmap = bitmap;
+	info.bitmap_bits = bitmap_bits;
+	
+	// Get request id and wait for ACK
+	unsigned int request_id = info.request_id = sisis_request_id();
+	if (sisis_request_insert(&info) != 0)
+	{
+		pthread_cond_destroy(&info.cond);
+		pthread_mutex_destroy(&info.mutex);
+		return 1;
+	}
+	
+	// Send message
+	char buf[SISIS_MAX_MESSAGE_SIZE];
+	unsigned int buf_len = sisis_construct_message(buf, SISIS_VERSION, request_id, cmd, data, data_len);
+	
+#ifdef TIME_DEBUG
+	char * ts1, * ts2;
+	// Get time
+	struct timespec time;
+  clock_gettime(CLOCK_REALTIME, &time);
+	asprintf(&ts1, "[%ld.%09ld] Sending SIS-IS request to zebra.\n", time.tv_sec, time.tv_nsec);
+#endif
+	sisis_send(buf, buf_len);
+	
+	// Wait for ack, nack, or timeout
+	struct timespec timeout;
+  clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += SISIS_REQUEST_TIMEOUT;
+	int status = 0;
+	pthread_mutex_lock(&info.mutex);
+	while (!(info.flags & (SISIS_REQUEST_ACK_INFO_ACKED | SISIS_REQUEST_ACK_INFO_NACKED)) && status == 0)
+		status = pthread_cond_timedwait(&info.cond, &info.mutex, &timeout);
+	
+	// Stop the receive thread from touching the request.  If it already has
+	// it, the reply arrived just as we timed out; wait for it to finish.
+	if (status != 0 && sisis_request_remove(request_id) == NULL)
+		while (!(info.flags & (SISIS_REQUEST_ACK_INFO_ACKED | SISIS_REQUEST_ACK_INFO_NACKED)))
+			pthread_cond_wait(&info.cond, &info.mutex);
+	pthread_mutex_unlock(&info.mutex);
+	pthread_cond_destroy(&info.cond);
+	pthread_mutex_destroy(&info.mutex);
+	if (!(info.flags & (SISIS_REQUEST_ACK_INFO_ACKED | SISIS_REQUEST_ACK_INFO_NACKED)))
+		return 1;
+
+#ifdef TIME_DEBUG
+	// Get time
+	clock_gettime(CLOCK_REALTIME, &time);
+	asprintf(&ts2, "[%ld.%09ld] Received SIS-IS response from zebra.\n", time.tv_sec, time.tv_nsec);
+	
+	printf("%s%s", ts1, ts2);
+	free(ts1);
+	free(ts2);
+#endif
+	
+	// Check if it was an ack of nack
+	return (info.flags & SISIS_REQUEST_ACK_INFO_ACKED) ? 0 : 1;
+}
+
+/**
+ * Sends a request to the SIS-IS listener without waiting.  The callback is
+ * run once the ACK or NACK arrives or after timeout_ms milliseconds.  If
+ * num_addrs is not zero, the callback receives the per address bitmap from a
+ * batch ACK.  flags may hold SISIS_REQUEST_ACK_INFO_INTERNAL.
+ *
+ * Returns zero if the request was sent.
+ */
+static int sisis_send_request_async(unsigned short cmd, void * data, unsigned int data_len, int num_addrs, unsigned int timeout_ms, short flags, sisis_request_callback_t callback, void * cb_data)
+{
+	// Setup socket
+	sisis_socket_open();
+	
+	// Set up request info
+	if (num_addrs > SISIS_MAX_BATCH_ADDRESSES)
+		return 1;
+	struct sisis_request_ack_info * info = sisis_request_alloc();
+	if (info == NULL)
+		return 1;
+	if (num_addrs > 0)
+		info->bitmap = info->bitmap_buf;
+	info->bitmap_bits = num_addrs;
+	info->flags = flags;
+	info->callback = callback;
+	info->data = cb_data;
+	clock_gettime(CLOCK_MONOTONIC, &info->deadline);
+	info->deadline.tv_sec += timeout_ms / 1000;
+	info->deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (info->deadline.tv_nsec >= 1000000000)
+	{
+		info->deadline.tv_sec++;
+		info->deadline.tv_nsec -= 1000000000;
+	}
+	
+	// Get request id and wait for ACK
+	unsigned int request_id = info->request_id = sisis_request_id();
+	if (sisis_request_insert(info) != 0)
+	{
+		sisis_request_free(info);
+		return 1;
+	}
+	
+	// Send message
+	char buf[SISIS_MAX_MESSAGE_SIZE];
+	unsigned int buf_len = sisis_construct_message(buf, SISIS_VERSION, request_id, cmd, data, data_len);
+	int sent = buf_len ? sisis_send(buf, buf_len) : -1;
+	if (sent < 0)
+	{
+		info = sisis_request_remove(request_id);
+		if (info != NULL)
+		{
+			sisis_request_free(info);
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+#ifdef USE_IPV6
+/**
+ * Builds the payload of a register or unregister message for one address.
+ * Register messages also carry the lifetime in milliseconds.
+ *
+ * Returns the length of the payload.
+ */
+static unsigned int sisis_build_address_payload(char * msg, char * sisis_addr, unsigned int ttl)
+{
+	unsigned short tmp = htons(AF_INET6);
+	memcpy(msg, &tmp, 2);
+	tmp = htons(strlen(sisis_addr));
+	memcpy(msg+2, &tmp, 2);
+	memcpy(msg+4, sisis_addr, strlen(sisis_addr));
+	if (ttl == 0)
+		return strlen(sisis_addr)+4;
+	
+	uint32_t ttl_n = htonl(ttl);
+	memcpy(msg+4+strlen(sisis_addr), &ttl_n, 4);
+	return strlen(sisis_addr)+8;
+}
+
+/**
+ * Builds the payload of a batch message: the count and then the family, raw
+ * address and lifetime in milliseconds of each address.  If ttls is NULL,
+ * every address gets ttl.
+ *
+ * Returns the length of the payload.
+ */
+static unsigned int sisis_build_batch_payload(char * msg, struct in6_addr * addrs, unsigned int * ttls, unsigned int ttl, int count)
+{
+	int i;
+	unsigned short tmp = htons(count);
+	memcpy(msg, &tmp, 2);
+	for (i = 0; i < count; i++)
+	{
+		char * entry = msg+2+i*SISIS_BATCH_ADDRESS_SIZE;
+		tmp = htons(AF_INET6);
+		memcpy(entry, &tmp, 2);
+		memcpy(entry+2, &addrs[i], sizeof(struct in6_addr));
+		uint32_t ttl_n = htonl(ttls ? ttls[i] : ttl);
+		memcpy(entry+18, &ttl_n, 4);
+	}
+	return 2 + count * SISIS_BATCH_ADDRESS_SIZE;
+}
+#endif /* USE_IPV6 */
+
+/**
+ * Does actual registration of SIS-IS address.
+ *
+ * sisis_addr String to store resulting SIS-IS/IP address in.
+ * ttl Lifetime of the address in milliseconds.
+ * 
+ * Returns zero on success.
+ */
+int sisis_do_register(char * sisis_addr, unsigned int ttl)
+{
+#ifdef USE_IPV6
+	// Setup message
+	char msg[128];
+	unsigned int msg_len = sisis_build_address_payload(msg, sisis_addr, ttl);
+	
+	return sisis_send_request(SISIS_CMD_REGISTER_ADDRESS, msg, msg_len, NULL, 0);
+#else /* IPv4 Version */
+	return sisis_send_request(SISIS_CMD_REGISTER_ADDRESS, sisis_addr, strlen(sisis_addr), NULL, 0);
+#endif /* USE_IPV6 */
+}
+
+#ifdef USE_IPV6
+/**
+ * Sends a batch of addresses with a single register or unregister command.
+ * Addresses are split into messages of at most SISIS_MAX_BATCH_ADDRESSES.
+ * ttls holds the lifetime of each address for register commands, or is
+ * NULL if they all get ttl.  If acked is not NULL, bit i is set if address i
+ * was ACKed.
+ *
+ * Returns zero if every address was ACKed.
+ */
+static int sisis_do_batch(unsigned short cmd, struct in6_addr * addrs, unsigned int * ttls, unsigned int ttl, int count, unsigned char * acked)
+{
+	int rtn = 0, start;
+	if (acked != NULL)
+		memset(acked, 0, (count + 7) / 8);
+	for (start = 0; start < count; start += SISIS_MAX_BATCH_ADDRESSES)
+	{
+		int n = MIN(count - start, SISIS_MAX_BATCH_ADDRESSES), i;
+		
+		// Setup message
+		char msg[2 + SISIS_MAX_BATCH_ADDRESSES * SISIS_BATCH_ADDRESS_SIZE];
+		unsigned int msg_len = sisis_build_batch_payload(msg, &addrs[start], ttls ? &ttls[start] : NULL, ttl, n);
+		
+		unsigned char bitmap[(SISIS_MAX_BATCH_ADDRESSES + 7) / 8];
+		memset(bitmap, 0, sizeof(bitmap));
+		if (sisis_send_request(cmd, msg, msg_len, bitmap, n) != 0)
+		{
+			rtn = 1;
+			continue;
+		}
+		
+		// Copy results
+		for (i = 0; i < n; i++)
+		{
+			if (bitmap[i / 8] & (1 << (i % 8)))
+			{
+				if (acked != NULL)
+					acked[(start + i) / 8] |= 1 << ((start + i) % 8);
+			}
+			else
+				rtn = 1;
+		}
+	}
+	return rtn;
+}
+#endif /* USE_IPV6 */
+
+/** Adds an address to the wheel delay ticks from now.  Caller must hold reregistration_mutex. */
+static void sisis_reregistration_schedule(reregistration_info_t * info, int delay)
+{
+	if (delay < 1)
+		delay = 1;
+	info->slot = (reregistration_wheel_pos + delay) % SISIS_REREGISTRATION_WHEEL_SLOTS;
+	info->rounds = (delay - 1) / SISIS_REREGISTRATION_WHEEL_SLOTS;
+	info->prev = NULL;
+	info->next = reregistration_wheel[info->slot];
+	if (info->next)
+		info->next->prev = info;
+	reregistration_wheel[info->slot] = info;
+}
+
+/** Removes an address from the wheel.  Caller must hold reregistration_mutex. */
+static void sisis_reregistration_unlink(reregistration_info_t * info)
+{
+	if (info->prev)
+		info->prev->next = info->next;
+	else
+		reregistration_wheel[info->slot] = info->next;
+	if (info->next)
+		info->next->prev = info->prev;
+	info->next = info->prev = NULL;
+}
+
+/**
+ * Jittered number of ticks until the next refresh of an address.  Addresses
+ * are refreshed after two thirds of their lifetime, pulled in by up to one
+ * sixth of it.  Caller must hold reregistration_mutex.
+ */
+static int sisis_reregistration_delay(reregistration_info_t * info)
+{
+	unsigned int jitter = rand_r(&reregistration_seed) % (info->ttl / 6 + 1);
+	return (info->ttl * 2 / 3 - jitter) / SISIS_REREGISTRATION_TICK_MS;
+}
+
+/**
+ * Moves the addresses due in a slot to their next refresh time and appends
+ * them to the due list.  Addresses with rounds left, or that cannot be
+ * refreshed ahead ticks early, are skipped.  When collecting the current
+ * slot (ahead is zero), skipped addresses have a round taken off, so an
+ * address is due once its rounds were already used up when the slot came
+ * around.  Caller must hold reregistration_mutex.
+ *
+ * Returns the new number of due addresses.
+ */
+#ifdef USE_IPV6
+static int sisis_reregistration_collect(unsigned int slot, int ahead, struct in6_addr ** due, unsigned int ** due_ttls, int num_due, int * due_size)
+#else /* IPv4 Version */
+static int sisis_reregistration_collect(unsigned int slot, int ahead, char *** due, unsigned int ** due_ttls, int num_due, int * due_size)
+#endif /* USE_IPV6 */
+{
+	reregistration_info_t * info = reregistration_wheel[slot], * next;
+	for (; info != NULL; info = next)
+	{
+		next = info->next;
+		if (info->rounds > 0)
+		{
+			if (ahead == 0)
+				info->rounds--;
+			continue;
+		}
+		if ((unsigned int)ahead * SISIS_REREGISTRATION_TICK_MS > info->ttl / 6)
+			continue;
+		
+		// Grow due list
+		if (num_due == *due_size)
+		{
+			int new_size = *due_size ? *due_size * 2 : 16;
+			void * tmp = realloc(*due, sizeof(**due) * new_size);
+			if (tmp == NULL)
+				continue;
+			*due = tmp;
+			if ((tmp = realloc(*due_ttls, sizeof(**due_ttls) * new_size)) == NULL)
+				continue;
+			*due_ttls = tmp;
+			*due_size = new_size;
+		}
+#ifdef USE_IPV6
+		(*due)[num_due] = info->addr;
+#else /* IPv4 Version */
+		(*due)[num_due] = strdup(info->addr);
+#endif /* USE_IPV6 */
+		(*due_ttls)[num_due++] = info->ttl;
+		
+		sisis_reregistration_unlink(info);
+		sisis_reregistration_schedule(info, sisis_reregistration_delay(info));
+	}
+	return num_due;
+}
+
+#ifdef USE_IPV6
+/**
+ * Moves the addresses of a refresh that were not ACKed up to be tried again
+ * soon.  acked may be NULL if none were.  Caller must hold
+ * reregistration_mutex.
+ */
+static void sisis_reregistration_retry(reregistration_batch_t * batch, unsigned char * acked)
+{
+	int slot, i;
+	for (slot = 0; slot < SISIS_REREGISTRATION_WHEEL_SLOTS; slot++)
+	{
+		reregistration_info_t * info = reregistration_wheel[slot], * next;
+		for (; info != NULL; info = next)
+		{
+			next = info->next;
+			for (i = 0; i < batch->count; i++)
+				if ((acked == NULL || !(acked[i / 8] & (1 << (i % 8)))) && memcmp(&info->addr, &batch->addrs[i], sizeof(struct in6_addr)) == 0)
+					break;
+			if (i == batch->count)
+				continue;
+			sisis_reregistration_unlink(info);
+			sisis_reregistration_schedule(info, SISIS_REREGISTRATION_RETRY_TICKS);
+		}
+	}
+}
+
+/** Called when a refresh is ACKed, NACKed or times out. */
+static void sisis_reregistration_done(unsigned int request_id, int status, unsigned char * acked, int num_addrs, void * data)
+{
+	reregistration_batch_t * batch = data;
+	int i;
+	(void)request_id;
+	(void)num_addrs;
+	pthread_mutex_lock(&reregistration_mutex);
+	for (i = 0; i < batch->count && status == SISIS_REQUEST_ACKED && acked != NULL && (acked[i / 8] & (1 << (i % 8))); i++);
+	if (i < batch->count)
+		sisis_reregistration_retry(batch, (status == SISIS_REQUEST_ACKED) ? acked : NULL);
+	batch->next = reregistration_batch_pool;
+	reregistration_batch_pool = batch;
+	pthread_mutex_unlock(&reregistration_mutex);
+}
+
+/** Sends refreshes for due addresses without waiting for their ACKs. */
+static void sisis_reregistration_send(struct in6_addr * due, unsigned int * due_ttls, int num_due)
+{
+	int start, i;
+	for (start = 0; start < num_due; start += SISIS_MAX_BATCH_ADDRESSES)
+	{
+		int n = MIN(num_due - start, SISIS_MAX_BATCH_ADDRESSES);
+		
+		// Get a batch to remember the addresses by
+		pthread_mutex_lock(&reregistration_mutex);
+		reregistration_batch_t * batch = reregistration_batch_pool;
+		if (batch != NULL)
+			reregistration_batch_pool = batch->next;
+		pthread_mutex_unlock(&reregistration_mutex);
+		if (batch == NULL && (batch = malloc(sizeof(*batch))) == NULL)
+			continue;
+		batch->count = n;
+		memcpy(batch->addrs, &due[start], sizeof(struct in6_addr) * n);
+		
+		// Wait for the ACK for a sixth of the shortest lifetime
+		unsigned int timeout_ms = SISIS_REQUEST_TIMEOUT * 1000;
+		for (i = 0; i < n; i++)
+			timeout_ms = MIN(timeout_ms, due_ttls[start + i] / 6);
+		timeout_ms = MAX(timeout_ms, SISIS_REREGISTRATION_TICK_MS);
+		
+		// Setup message
+		char msg[2 + SISIS_MAX_BATCH_ADDRESSES * SISIS_BATCH_ADDRESS_SIZE];
+		unsigned int msg_len = sisis_build_batch_payload(msg, &due[start], &due_ttls[start], 0, n);
+		if (sisis_send_request_async(SISIS_CMD_REGISTER_ADDRESSES, msg, msg_len, n, timeout_ms, SISIS_REQUEST_ACK_INFO_INTERNAL, sisis_reregistration_done, batch) != 0)
+			sisis_reregistration_done(0, SISIS_REQUEST_TIMED_OUT, NULL, n, batch);
+	}
+}
+#endif /* USE_IPV6 */
+
+/**
+ * Refresh engine.  Every tick, the addresses due in the current slot are
+ * refreshed along with any that are due within their jitter window, all in
+ * one batch.  Refreshes are not waited for, so the engine also times out
+ * those that are not answered.
+ */
+static void * sisis_reregistration_loop(void * null)
+{
+#ifdef USE_IPV6
+	struct in6_addr * due = NULL;
+#else /* IPv4 Version */
+	char ** due = NULL;
+#endif /* USE_IPV6 */
+	unsigned int * due_ttls = NULL;
+	int due_size = 0;
+	struct timespec tick = { SISIS_REREGISTRATION_TICK_MS / 1000, (SISIS_REREGISTRATION_TICK_MS % 1000) * 1000000 };
+	while (1)
+	{
+		nanosleep(&tick, NULL);
+#ifdef USE_IPV6
+		sisis_expire_requests();
+#endif /* USE_IPV6 */
+		
+		pthread_mutex_lock(&reregistration_mutex);
+		reregistration_wheel_pos = (reregistration_wheel_pos + 1) % SISIS_REREGISTRATION_WHEEL_SLOTS;
+		
+		int num_due = 0, k;
+		num_due = sisis_reregistration_collect(reregistration_wheel_pos, 0, &due, &due_ttls, num_due, &due_size);
+		
+		// Refresh anything due soon in the same message
+		if (num_due > 0)
+			for (k = 1; k <= SISIS_REREGISTRATION_MAX_AHEAD; k++)
+				num_due = sisis_reregistration_collect((reregistration_wheel_pos + k) % SISIS_REREGISTRATION_WHEEL_SLOTS, k, &due, &due_ttls, num_due, &due_size);
+		pthread_mutex_unlock(&reregistration_mutex);
+		
+		// Register
+		if (num_due > 0)
+		{
+#ifdef USE_IPV6
+			sisis_reregistration_send(due, due_ttls, num_due);
+#else /* IPv4 Version */
+			for (k = 0; k < num_due; k++)
+			{
+				sisis_do_register(due[k], due_ttls[k]);
+				free(due[k]);
+			}
+#endif /* USE_IPV6 */
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Starts reregistering an address, or a batch of addresses if addrs is not
+ * NULL.
  *
- * sisis_addr String to store resulting SIS-IS/IP address in.
- * 
  * Returns zero on success.
  */
-int sisis_do_register(char * sisis_addr)
+static int sisis_add_reregistration(char * sisis_addr, struct in6_addr * addrs, int count, unsigned int ttl)
 {
-	// Setup socket
-	sisis_socket_open();
+	int i, rtn = 0;
+	pthread_mutex_lock(&reregistration_mutex);
 	
-	// Get request id
-	unsigned int request_id = next_request_id++;
-	
-	// Find empty awaiting ack info from pool
-	int idx;
-	pthread_mutex_lock(&awaiting_acks_pool_mutex);
-	for (idx =  0; idx < AWAITING_ACK_POOL_SIZE && awaiting_acks_pool[idx].valid; idx++);
-	awaiting_acks_pool[idx].valid = 1;
-	awaiting_acks_pool[idx].request_id = request_id;
-	awaiting_acks_pool[idx].flags = 0;
-	// Be sure that mutex is locked
-	pthread_mutex_unlock(&awaiting_acks_pool[idx].mutex);
-	pthread_mutex_lock(&awaiting_acks_pool[idx].mutex);
-	// Release lock on pool
-	pthread_mutex_unlock(&awaiting_acks_pool_mutex);
+	// Start refresh engine
+	if (!reregistration_thread_started)
+	{
+		reregistration_seed = getpid() ^ time(NULL);
+		if (pthread_create(&reregistration_thread, NULL, sisis_reregistration_loop, NULL) != 0)
+		{
+			pthread_mutex_unlock(&reregistration_mutex);
+			return 2;
+		}
+		pthread_detach(reregistration_thread);
+		reregistration_thread_started = 1;
+	}
 	
+	for (i = 0; i < (addrs ? count : 1); i++)
+	{
+		reregistration_info_t * info = malloc(sizeof(*info));
+		if (info == NULL)
+		{
+			rtn = 3;
+			break;
+		}
+		memset(info, 0, sizeof(*info));
+		info->ttl = ttl;
 #ifdef USE_IPV6
-	// Setup message
-	char msg[128];
-	unsigned short tmp = htons(AF_INET6);
-	memcpy(msg, &tmp, 2);
-	tmp = htons(strlen(sisis_addr));
-	memcpy(msg+2, &tmp, 2);
-	memcpy(msg+4, sisis_addr, strlen(sisis_addr));
-	
-	// Send message
-	char * buf;
-	unsigned int buf_len = sisis_construct_message(&buf, SISIS_VERSION, request_id, SISIS_CMD_REGISTER_ADDRESS, msg, strlen(sisis_addr)+4);
+		if (addrs != NULL)
+			info->addr = addrs[i];
+		else if (inet_pton(AF_INET6, sisis_addr, &info->addr) != 1)
+		{
+			free(info);
+			rtn = 4;
+			break;
+		}
 #else /* IPv4 Version */
-	// Send message
-	char * buf;
-	unsigned int buf_len = sisis_construct_message(&buf, SISIS_VERSION, request_id, SISIS_CMD_REGISTER_ADDRESS, sisis_addr, strlen(sisis_addr));
+		if ((info->addr = malloc(sizeof(char) * (strlen(sisis_addr)+1))) == NULL)
+		{
+			free(info);
+			rtn = 4;
+			break;
+		}
+		strcpy(info->addr, sisis_addr);
 #endif /* USE_IPV6 */
+		sisis_reregistration_schedule(info, sisis_reregistration_delay(info));
+	}
 	
-#ifdef TIME_DEBUG
-	char * ts1, * ts2;
-	// Get time
-	struct timespec time;
-  clock_gettime(CLOCK_REALTIME, &time);
-	asprintf(&ts1, "[%ld.%09ld] Sending SIS-IS request to zebra.\n", time.tv_sec, time.tv_nsec);
-#endif
-	sisis_send(buf, buf_len);
-	free(buf);
-	
-	// Wait for ack, nack, or timeout
-	struct timespec timeout;
-  clock_gettime(CLOCK_REALTIME, &timeout);
-	timeout.tv_sec += 5;
-  int status = pthread_mutex_timedlock(&awaiting_acks_pool[idx].mutex, &timeout);
-	if (status != 0)
-		return 1;
-
-#ifdef TIME_DEBUG
-	// Get time
-	clock_gettime(CLOCK_REALTIME, &time);
-	asprintf(&ts2, "[%ld.%09ld] Received SIS-IS response from zebra.\n", time.tv_sec, time.tv_nsec);
-	
-	printf("%s%s", ts1, ts2);
-	free(ts1);
-	free(ts2);
-#endif
-	
-	// Check if it was an ack of nack and return to pool
-	pthread_mutex_lock(&awaiting_acks_pool_mutex);
-	int rtn = (awaiting_acks_pool[idx].request_id == request_id && (awaiting_acks_pool[idx].flags & SISIS_REQUEST_ACK_INFO_ACKED)) ? 0 : 1;
-	awaiting_acks_pool[idx].valid = 0;
-	pthread_mutex_unlock(&awaiting_acks_pool_mutex);
-	
+	pthread_mutex_unlock(&reregistration_mutex);
 	return rtn;
 }
 
-void * sisis_reregister(void * arg)
+/**
+ * Stops reregistering an address, or a batch of addresses if addrs is not
+ * NULL.
+ */
+static void sisis_remove_reregistration(char * sisis_addr, struct in6_addr * addrs, int count)
 {
-	reregistration_info_t * info = (reregistration_info_t *)arg;
-	int active = 1;
-	while (active)
+#ifdef USE_IPV6
+	struct in6_addr addr;
+	if (addrs == NULL)
 	{
-		// Sleep
-		sleep(SISIS_REREGISTRATION_TIMEOUT);
-		
-		// Check if this is still active
-		pthread_mutex_lock(&reregistration_array_mutex);
-		active = info->active;
-		pthread_mutex_unlock(&reregistration_array_mutex);
-		
-		// Register
-		if (active)
-			sisis_do_register(info->addr);
+		if (inet_pton(AF_INET6, sisis_addr, &addr) != 1)
+			return;
+		addrs = &addr;
+		count = 1;
 	}
+#endif /* USE_IPV6 */
 	
-	// Delete info
-	pthread_mutex_lock(&reregistration_array_mutex);
-	reregistrations[info->idx] = NULL;
-	pthread_mutex_unlock(&reregistration_array_mutex);
-	
-	// Free struct
-	free(info->addr);
-	free(info);
+	pthread_mutex_lock(&reregistration_mutex);
+	int slot, i;
+	for (slot = 0; slot < SISIS_REREGISTRATION_WHEEL_SLOTS; slot++)
+	{
+		reregistration_info_t * info = reregistration_wheel[slot], * next;
+		for (; info != NULL; info = next)
+		{
+			next = info->next;
+#ifdef USE_IPV6
+			for (i = 0; i < count && memcmp(&info->addr, &addrs[i], sizeof(struct in6_addr)) != 0; i++);
+			if (i == count)
+				continue;
+#else /* IPv4 Version */
+			if (strcmp(info->addr, sisis_addr) != 0)
+				continue;
+			free(info->addr);
+#endif /* USE_IPV6 */
+			sisis_reregistration_unlink(info);
+			free(info);
+		}
+	}
+	pthread_mutex_unlock(&reregistration_mutex);
 }
 
 #ifdef USE_IPV6
@@ -576,27 +1334,44 @@ int sisis_register(char * sisis_addr, ...)
 		return 1;
 	
 	// Register
-	rtn = sisis_do_register(sisis_addr);
+	unsigned int ttl = sisis_address_ttl;
+	rtn = sisis_do_register(sisis_addr, ttl);
 	
 	// Set up reregistration
-	pthread_mutex_lock(&reregistration_array_mutex);
-	int idx;
-	for (idx = 0; idx < MAX_REREGISTRATION_THREADS && reregistrations[idx] != NULL; idx++);
-	pthread_mutex_unlock(&reregistration_array_mutex);
-	
-	// Check if there is an empty spot
-	if (idx == MAX_REREGISTRATION_THREADS)
-		return 2;
-	if ((reregistrations[idx] = malloc(sizeof(*reregistrations[idx]))) == NULL)
-		return 3;
-	if ((reregistrations[idx]->addr = malloc(sizeof(char) * (strlen(sisis_addr)+1))) == NULL)
-		return 4;
-	strcpy(reregistrations[idx]->addr, sisis_addr);
-	reregistrations[idx]->active = 1;
-	reregistrations[idx]->idx = idx;
-	pthread_create(&reregistrations[idx]->thread, NULL, sisis_reregister, (void *)reregistrations[idx]);
+	int rereg_rtn = sisis_add_reregistration(sisis_addr, NULL, 0, ttl);
 	
-	return rtn;
+	return rereg_rtn ? rereg_rtn : rtn;
+}
+
+/**
+ * Registers SIS-IS process without waiting for the reply.  The callback is
+ * run with the outcome once the ACK or NACK arrives or the request times
+ * out.  See sisis_completion_fd() for where the callback runs.
+ *
+ * sisis_addr String to store resulting SIS-IS/IP address in.
+ * 
+ * Returns zero if the request was sent.
+ */
+int sisis_register_async(sisis_request_callback_t callback, void * data, char * sisis_addr, ...)
+{
+	// Construct SIS-IS addresss
+	va_list args;
+	va_start(args, sisis_addr);
+	int rtn = sisis_create_addr_from_va_list(sisis_addr, args);
+	va_end(args);
+	if (rtn)
+		return 1;
+	
+	// Set up reregistration
+	unsigned int ttl = sisis_address_ttl;
+	if ((rtn = sisis_add_reregistration(sisis_addr, NULL, 0, ttl)) != 0)
+		return rtn;
+	
+	// Setup message
+	char msg[128];
+	unsigned int msg_len = sisis_build_address_payload(msg, sisis_addr, ttl);
+	
+	return sisis_send_request_async(SISIS_CMD_REGISTER_ADDRESS, msg, msg_len, 0, SISIS_REQUEST_TIMEOUT * 1000, 0, callback, data);
 }
 
 void sisis_register_host(uint64_t host_num, uint64_t ptype, uint64_t ptype_version)
@@ -638,19 +1413,14 @@ int sisis_unregister(void * nil, ...)
 	if (rtn)
 		return 1;
 
-	// Find and stop deregistration thread	
-	pthread_mutex_lock(&reregistration_array_mutex);
-	int idx;
-	for (idx = 0; idx < MAX_REREGISTRATION_THREADS && (reregistrations[idx] == NULL || strcmp(reregistrations[idx]->addr, sisis_addr) != 0); idx++);
-	if (idx < MAX_REREGISTRATION_THREADS)
-		reregistrations[idx]->active = 0;
-	pthread_mutex_unlock(&reregistration_array_mutex);
+	// Stop reregistering
+	sisis_remove_reregistration(sisis_addr, NULL, 0);
 	
 	// Setup socket
 	sisis_socket_open();
 	
 	// Get request id
-	unsigned int request_id = next_request_id++;
+	unsigned int request_id = sisis_request_id();
 	
 	// Setup message
 	char msg[128];
@@ -661,13 +1431,254 @@ int sisis_unregister(void * nil, ...)
 	memcpy(msg+4, sisis_addr, strlen(sisis_addr));
 	
 	// Send message
-	char * buf;
-	unsigned int buf_len = sisis_construct_message(&buf, SISIS_VERSION, request_id, SISIS_CMD_UNREGISTER_ADDRESS, msg, strlen(sisis_addr)+4);
-	sisis_send(buf, buf_len);
-	free(buf);
+	char buf[SISIS_MAX_MESSAGE_SIZE];
+	unsigned int buf_len = sisis_construct_message(buf, SISIS_VERSION, request_id, SISIS_CMD_UNREGISTER_ADDRESS, msg, strlen(sisis_addr)+4);
+	if (buf_len)
+		sisis_send(buf, buf_len);
 	
 	return 0;
 }
+
+/**
+ * Registers a batch of SIS-IS addresses with one message per
+ * SISIS_MAX_BATCH_ADDRESSES addresses.  The addresses are reregistered
+ * together.
+ *
+ * acked If not NULL, bit i is set if address i was ACKed.  Must hold at
+ *       least (count+7)/8 bytes.
+ * 
+ * Returns zero if every address was registered.
+ */
+int sisis_register_addrs(struct in6_addr * addrs, int count, unsigned char * acked)
+{
+	if (count <= 0)
+		return 1;
+	
+	// Register
+	unsigned int ttl = sisis_address_ttl;
+	int rtn = sisis_do_batch(SISIS_CMD_REGISTER_ADDRESSES, addrs, NULL, ttl, count, acked);
+	
+	// Set up reregistration
+	int rereg_rtn = sisis_add_reregistration(NULL, addrs, count, ttl);
+	
+	return rereg_rtn ? rereg_rtn : rtn;
+}
+
+/**
+ * Registers a batch of at most SISIS_MAX_BATCH_ADDRESSES SIS-IS addresses
+ * without waiting for the reply.  The callback receives the bitmap of
+ * ACKed addresses.  See sisis_completion_fd() for where the callback runs.
+ * 
+ * Returns zero if the request was sent.
+ */
+int sisis_register_addrs_async(struct in6_addr * addrs, int count, sisis_request_callback_t callback, void * data)
+{
+	if (count <= 0 || count > SISIS_MAX_BATCH_ADDRESSES)
+		return 1;
+	
+	// Set up reregistration
+	unsigned int ttl = sisis_address_ttl;
+	int rtn = sisis_add_reregistration(NULL, addrs, count, ttl);
+	if (rtn)
+		return rtn;
+	
+	// Setup message
+	char msg[2 + SISIS_MAX_BATCH_ADDRESSES * SISIS_BATCH_ADDRESS_SIZE];
+	unsigned int msg_len = sisis_build_batch_payload(msg, addrs, NULL, ttl, count);
+	
+	return sisis_send_request_async(SISIS_CMD_REGISTER_ADDRESSES, msg, msg_len, count, SISIS_REQUEST_TIMEOUT * 1000, 0, callback, data);
+}
+
+/**
+ * Unregisters a batch of SIS-IS addresses with one message per
+ * SISIS_MAX_BATCH_ADDRESSES addresses.
+ *
+ * acked If not NULL, bit i is set if address i was ACKed.  Must hold at
+ *       least (count+7)/8 bytes.
+ * 
+ * Returns zero if every address was unregistered.
+ */
+int sisis_unregister_addrs(struct in6_addr * addrs, int count, unsigned char * acked)
+{
+	if (count <= 0)
+		return 1;
+	
+	// Stop reregistering these addresses
+	sisis_remove_reregistration(NULL, addrs, count);
+	
+	return sisis_do_batch(SISIS_CMD_UNREGISTER_ADDRESSES, addrs, NULL, 0, count, acked);
+}
+
+/** Builds a SUBSCRIBE payload. */
+static void sisis_build_subscribe_payload(char * msg, struct sisis_subscription_info * sub)
+{
+	*(unsigned int *)msg = htonl(sub->id);
+	*(unsigned short *)(msg+4) = htons(AF_INET6);
+	*(unsigned short *)(msg+6) = htons(sub->p.prefixlen);
+	memcpy(msg+8, &sub->p.prefix, sizeof(struct in6_addr));
+}
+
+/**
+ * Finds a subscription and keeps it from being freed until
+ * sisis_subscription_release().
+ */
+static struct sisis_subscription_info * sisis_subscription_hold(unsigned int id)
+{
+	struct sisis_subscription_info * sub;
+	pthread_mutex_lock(&subscriptions_mutex);
+	for (sub = subscriptions; sub != NULL && sub->id != id; sub = sub->next);
+	if (sub != NULL)
+		sub->calling = 1;
+	pthread_mutex_unlock(&subscriptions_mutex);
+	return sub;
+}
+
+/** Lets a subscription be freed again. */
+static void sisis_subscription_release(struct sisis_subscription_info * sub)
+{
+	pthread_mutex_lock(&subscriptions_mutex);
+	
+	// Unsubscribed by its own callback
+	if (sub->removed)
+		free(sub);
+	else
+	{
+		sub->calling = 0;
+		pthread_cond_broadcast(&subscriptions_cond);
+	}
+	pthread_mutex_unlock(&subscriptions_mutex);
+}
+
+/**
+ * Runs a subscription's callback for each change in a notification.  Called
+ * on the receive thread.
+ */
+static void sisis_notify_subscription(unsigned int id, char * msg, int msg_len)
+{
+	struct sisis_subscription_info * sub;
+	if (msg_len < SISIS_NOTIFY_HEADER_SIZE || (sub = sisis_subscription_hold(id)) == NULL)
+		return;
+	
+	unsigned short flags = ntohs(*(unsigned short *)(msg+8));
+	int i, count = ntohs(*(unsigned short *)(msg+10));
+	if (flags & SISIS_NOTIFY_FLAG_LOST)
+		sub->callback(NULL, SISIS_ADDRESSES_LOST, sub->data);
+	for (i = 0; i < count && SISIS_NOTIFY_HEADER_SIZE + (i+1) * SISIS_NOTIFY_ENTRY_SIZE <= msg_len && !sub->removed; i++)
+	{
+		char * entry = msg + SISIS_NOTIFY_HEADER_SIZE + i * SISIS_NOTIFY_ENTRY_SIZE;
+		struct in6_addr addr;
+		memcpy(&addr, entry+1, sizeof(addr));
+		sub->callback(&addr, entry[0] ? SISIS_ADDRESS_ADDED : SISIS_ADDRESS_REMOVED, sub->data);
+	}
+	sisis_subscription_release(sub);
+}
+
+/**
+ * Subscribes again after reconnecting to sisisd.  Called on the receive
+ * thread, so the ACKs are not waited for.  Changes made while disconnected
+ * are unknown, so every subscriber is told some were lost.
+ */
+static void sisis_resubscribe(void)
+{
+	unsigned int ids[64];
+	int i, num_ids = 0;
+	
+	pthread_mutex_lock(&subscriptions_mutex);
+	struct sisis_subscription_info * sub;
+	for (sub = subscriptions; sub != NULL; sub = sub->next)
+	{
+		char payload[SISIS_SUBSCRIBE_SIZE], buf[SISIS_MAX_MESSAGE_SIZE];
+		sisis_build_subscribe_payload(payload, sub);
+		unsigned int request_id = sisis_request_id();
+		unsigned int buf_len = sisis_construct_message(buf, SISIS_VERSION, request_id, SISIS_CMD_SUBSCRIBE, payload, SISIS_SUBSCRIBE_SIZE);
+		if (buf_len)
+			sisis_send(buf, buf_len);
+		if (num_ids < 64)
+			ids[num_ids++] = sub->id;
+	}
+	pthread_mutex_unlock(&subscriptions_mutex);
+	
+	for (i = 0; i < num_ids; i++)
+		if ((sub = sisis_subscription_hold(ids[i])) != NULL)
+		{
+			sub->callback(NULL, SISIS_ADDRESSES_LOST, sub->data);
+			sisis_subscription_release(sub);
+		}
+}
+
+/**
+ * Subscribe to SIS-IS addresses being added or removed under a prefix.
+ *
+ * Returns the subscription id or -1 on error.
+ */
+int sisis_subscribe_addresses(struct prefix_ipv6 * p, sisis_address_callback_t callback, void * data)
+{
+	if (p == NULL || callback == NULL || p->prefixlen > 128)
+		return -1;
+	
+	// Notifications need a connection
+	sisis_socket_open();
+	if (!sisis_socket_unix)
+		return -1;
+	
+	struct sisis_subscription_info * sub = malloc(sizeof(struct sisis_subscription_info));
+	if (sub == NULL)
+		return -1;
+	memset(sub, 0, sizeof(struct sisis_subscription_info));
+	sub->p = *p;
+	sub->callback = callback;
+	sub->data = data;
+	
+	// Added first since changes may arrive right after the ACK
+	pthread_mutex_lock(&subscriptions_mutex);
+	sub->id = next_subscription_id++;
+	sub->next = subscriptions;
+	subscriptions = sub;
+	pthread_mutex_unlock(&subscriptions_mutex);
+	
+	char payload[SISIS_SUBSCRIBE_SIZE];
+	sisis_build_subscribe_payload(payload, sub);
+	int id = sub->id;
+	if (sisis_send_request(SISIS_CMD_SUBSCRIBE, payload, SISIS_SUBSCRIBE_SIZE, NULL, 0) != 0)
+	{
+		sisis_unsubscribe_addresses(id);
+		return -1;
+	}
+	return id;
+}
+
+/**
+ * Ends a subscription.
+ *
+ * Returns zero on success.
+ */
+int sisis_unsubscribe_addresses(int id)
+{
+	struct sisis_subscription_info ** prev, * sub;
+	pthread_mutex_lock(&subscriptions_mutex);
+	for (prev = &subscriptions; (sub = *prev) != NULL && sub->id != (unsigned int)id; prev = &sub->next);
+	if (sub == NULL)
+	{
+		pthread_mutex_unlock(&subscriptions_mutex);
+		return 1;
+	}
+	*prev = sub->next;
+	
+	// Wait out a callback in progress, unless this is it
+	if (sub->calling && pthread_equal(pthread_self(), sisis_recv_from_thread))
+		sub->removed = 1;
+	else
+	{
+		while (sub->calling)
+			pthread_cond_wait(&subscriptions_cond, &subscriptions_mutex);
+		free(sub);
+	}
+	pthread_mutex_unlock(&subscriptions_mutex);
+	
+	// Tell sisisd
+	unsigned int nid = htonl(id);
+	return sisis_send_request(SISIS_CMD_UNSUBSCRIBE, &nid, sizeof(nid), NULL, 0);
+}
 #else /* IPv4 Version */
 /**
  * Registers SIS-IS process.
@@ -683,27 +1694,13 @@ int sisis_register(unsigned int ptype, unsigned int host_num, unsigned int pid,
 		return 1;
 	
 	// Register
-	int rtn = sisis_do_register(sisis_addr);
+	unsigned int ttl = sisis_address_ttl;
+	int rtn = sisis_do_register(sisis_addr, ttl);
 	
 	// Set up reregistration
-	pthread_mutex_lock(&reregistration_array_mutex);
-	int idx;
-	for (idx = 0; idx < MAX_REREGISTRATION_THREADS && reregistrations[idx] != NULL; idx++);
-	pthread_mutex_unlock(&reregistration_array_mutex);
-	
-	// Check if there is an empty spot
-	if (idx == MAX_REREGISTRATION_THREADS)
-		return 2;
-	if ((reregistrations[idx] = malloc(sizeof(*reregistrations[idx]))) == NULL)
-		return 3;
-	if ((reregistrations[idx]->addr = malloc(sizeof(char) * (strlen(sisis_addr)+1))) == NULL)
-		return 4;
-	strcpy(reregistrations[idx]->addr, sisis_addr);
-	reregistrations[idx]->active = 1;
-	reregistrations[idx]->idx = idx;
-	pthread_create(&reregistrations[idx]->thread, NULL, sisis_reregister, (void *)reregistrations[idx]);
+	int rereg_rtn = sisis_add_reregistration(sisis_addr, NULL, 0, ttl);
 	
-	return rtn;
+	return rereg_rtn ? rereg_rtn : rtn;
 }
 
 void sisis_register_host(uint64_t host_num, uint64_t ptype, uint64_t ptype_version)
@@ -738,25 +1735,20 @@ int sisis_unregister(unsigned int ptype, unsigned int host_num, unsigned int pid
 	if (sisis_create_addr(ptype, host_num, pid, sisis_addr))
 		return 1;
 	
-	// Find and stop deregistration thread	
-	pthread_mutex_lock(&reregistration_array_mutex);
-	int idx;
-	for (idx = 0; idx < MAX_REREGISTRATION_THREADS && (reregistrations[idx] == NULL || strcmp(reregistrations[idx]->addr, sisis_addr) != 0); idx++);
-	if (idx < MAX_REREGISTRATION_THREADS)
-		reregistrations[idx]->active = 0;
-	pthread_mutex_unlock(&reregistration_array_mutex);
+	// Stop reregistering
+	sisis_remove_reregistration(sisis_addr, NULL, 0);
 	
 	// Setup socket
 	sisis_socket_open();
 	
 	// Get request id
-	unsigned int request_id = next_request_id++;
+	unsigned int request_id = sisis_request_id();
 	
 	// Send message
-	char * buf;
-	unsigned int buf_len = sisis_construct_message(&buf, SISIS_VERSION, request_id, SISIS_CMD_UNREGISTER_ADDRESS, sisis_addr, strlen(sisis_addr));
-	sisis_send(buf, buf_len);
-	free(buf);
+	char buf[SISIS_MAX_MESSAGE_SIZE];
+	unsigned int buf_len = sisis_construct_message(buf, SISIS_VERSION, request_id, SISIS_CMD_UNREGISTER_ADDRESS, sisis_addr, strlen(sisis_addr));
+	if (buf_len)
+		sisis_send(buf, buf_len);
 	
 	return 0;
 }
@@ -872,8 +1864,8 @@ int sisis_rib_add_ipv6 (struct route_ipv6 * route, void * data)
 }
 #endif /* HAVE_IPV6 */
 
-/** Subscribe to route add/remove messages */
-int subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
+/** Subscribe to route add/remove messages passing the given netlink filter */
+static int sisis_subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info, int filter, unsigned int ptype)
 {
 	int rtn = 0;
 	
@@ -889,6 +1881,8 @@ int subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
 	subscribe_info->rib_remove_ipv6_route = info->rib_remove_ipv6_route;
 	#endif /* HAVE_IPV6 */
 	subscribe_info->data = info->data;
+	subscribe_info->filter = filter;
+	subscribe_info->filter_ptype = ptype;
 	
 	// Subscribe to changes
 	sisis_netlink_subscribe_to_rib_changes(subscribe_info);
@@ -897,6 +1891,22 @@ int subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
 	return rtn;
 }
 
+/** Subscribe to route add/remove messages */
+int subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
+{
+	return sisis_subscribe_to_rib_changes(info, 0, 0);
+}
+
+#ifdef HAVE_IPV6
+/** Subscribe to SIS-IS host route add/remove messages */
+int subscribe_to_sisis_rib_changes(struct subscribe_to_rib_changes_info * info, int ptype)
+{
+	if (ptype < 0)
+		return sisis_subscribe_to_rib_changes(info, SISIS_NETLINK_FILTER_SISIS, 0);
+	return sisis_subscribe_to_rib_changes(info, SISIS_NETLINK_FILTER_SISIS | SISIS_NETLINK_FILTER_PTYPE, ptype);
+}
+#endif /* HAVE_IPV6 */
+
 /** Unsubscribe to route add/remove messages */
 int unsubscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
 {
@@ -907,12 +1917,46 @@ int unsubscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info)
 }
 
 #ifdef USE_IPV6
+/** Builds a list of copies of addresses and frees the array. */
+static struct list_sis * sisis_addr_list_from_array(struct in6_addr * addrs, int count)
+{
+	struct list_sis * rtn = malloc(sizeof(struct list_sis));
+	if (rtn != NULL)
+	{
+		memset(rtn, 0, sizeof(*rtn));
+		int i;
+		for (i = 0; i < count; i++)
+		{
+			struct listnode_sis * new_node = malloc(sizeof(struct listnode_sis));
+			if (new_node == NULL)
+				break;
+			if ((new_node->data = malloc(sizeof(struct in6_addr))) == NULL)
+			{
+				free(new_node);
+				break;
+			}
+			memcpy(new_node->data, &addrs[i], sizeof(struct in6_addr));
+			LIST_APPEND(rtn, new_node);
+		}
+	}
+	free(addrs);
+	return rtn;
+}
+
 /**
  * Get SIS-IS addresses that match a given IP prefix.  It is the receiver's
  * responsibility to free the list when done with it.
  */
 struct list_sis * get_sisis_addrs_for_prefix(struct prefix_ipv6 * p)
 {
+	// Answer from sisisd's registry, or else the address index, when available
+	struct in6_addr * addrs;
+	int cnt = sisis_registry_get(&p->prefix, p->prefixlen, &addrs);
+	if (cnt >= 0)
+		return sisis_addr_list_from_array(addrs, cnt);
+	if (sisis_addr_index_init() == 0)
+		return sisis_addr_index_get(p);
+	
 	// Update kernel routes
 	struct list_sis * rib = malloc(sizeof(*rib));
 	memset(rib, 0, sizeof(*rib));
@@ -994,23 +2038,97 @@ struct list_sis * get_processes_by_type_version(uint64_t process_type, uint64_t
 /** Count number of processes of a given type/version*/
 int get_process_type_version_count(uint64_t process_type, uint64_t process_version)
 {
-        int cnt = 0;
-    
         char addr[INET6_ADDRSTRLEN+1];
         sisis_create_addr(addr, process_type, process_version, 0LLU, 0LLU, 0LLU);
         struct prefix_ipv6 prefix = sisis_make_ipv6_prefix(addr, 42);
-        struct list_sis * addrs = get_sisis_addrs_for_prefix(&prefix);
-        if (addrs != NULL)
-        {   
-          cnt = addrs->size;
-    
-          // Free memory
-          FREE_LINKED_LIST(addrs);
-        }   
-                       
-        return cnt;
+        return get_sisis_addr_count_for_prefix(&prefix);
 }
                 
+/**
+ * Count SIS-IS addresses that match a given IP prefix.
+ */
+int get_sisis_addr_count_for_prefix(struct prefix_ipv6 * p)
+{
+	// Answer from sisisd's registry, or else the address index, when available
+	int cnt = sisis_registry_count(&p->prefix, p->prefixlen);
+	if (cnt >= 0)
+		return cnt;
+	if (sisis_addr_index_init() == 0)
+		return sisis_addr_index_count(p);
+	
+	cnt = 0;
+	struct list_sis * addrs = get_sisis_addrs_for_prefix(p);
+	if (addrs != NULL)
+	{
+		cnt = addrs->size;
+		FREE_LINKED_LIST(addrs);
+	}
+	return cnt;
+}
+
+/**
+ * Get SIS-IS addresses on a given host.  It is the receiver's responsibility
+ * to free the list when done with it.
+ */
+struct list_sis * get_sisis_addrs_for_host(uint64_t sys_id)
+{
+	// Answer from the address index's host trie when available.  The registry
+	// is ordered by prefix, so it would have to be scanned.
+	if (sisis_addr_index_init() == 0)
+		return sisis_addr_index_get_host((u_int32_t)sys_id);
+	
+	// Otherwise filter every SIS-IS address
+	char addr[INET6_ADDRSTRLEN+1];
+	sisis_create_addr(addr, 0LLU, 0LLU, 0LLU, 0LLU, 0LLU);
+	struct prefix_ipv6 prefix = sisis_make_ipv6_prefix(addr, SISIS_ADDR_PREFIX_LEN(prefix));
+	struct list_sis * addrs = get_sisis_addrs_for_prefix(&prefix);
+	if (addrs != NULL)
+	{
+		struct listnode_sis * node = addrs->head, * next;
+		while (node != NULL)
+		{
+			next = node->next;
+			
+			if (sisis_addr_get_sys_id((struct in6_addr *)node->data) != sys_id)
+			{
+				// Remove from list
+				if (node->prev)
+					node->prev->next = node->next;
+				else
+					addrs->head = node->next;
+				if (node->next)
+					node->next->prev = node->prev;
+				else
+					addrs->tail = node->prev;
+				addrs->size--;
+				free(node->data);
+				free(node);
+			}
+			node = next;
+		}
+	}
+	return addrs;
+}
+
+/**
+ * Count SIS-IS addresses on a given host.
+ */
+int get_sisis_addr_count_for_host(uint64_t sys_id)
+{
+	// Answer from the address index's host trie when available
+	if (sisis_addr_index_init() == 0)
+		return sisis_addr_index_count_host((u_int32_t)sys_id);
+	
+	int cnt = 0;
+	struct list_sis * addrs = get_sisis_addrs_for_host(sys_id);
+	if (addrs != NULL)
+	{
+		cnt = addrs->size;
+		FREE_LINKED_LIST(addrs);
+	}
+	return cnt;
+}
+
 /**
  * Creates an IPv6 prefix
  */
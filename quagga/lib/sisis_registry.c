@@ -0,0 +1,218 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+
+#include <zebra.h>
+#include "prefix.h"
+
+#include "sisis_structs.h"
+#include "sisis_api.h"
+#include "sisis_registry.h"
+
+// Registry mapping.  Once mapped it stays mapped; sisisd reuses the segment
+// when it restarts.
+pthread_mutex_t sisis_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+const struct sisis_registry * volatile sisis_registry = NULL;
+time_t sisis_registry_next_attempt = 0;
+
+/** Checks that sisisd has stamped the heartbeat recently. */
+static int sisis_registry_alive(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)now.tv_sec - sisis_registry->heartbeat <= SISIS_REGISTRY_STALE_SECS;
+}
+
+/**
+ * Maps the registry.  Safe to call more than once.
+ *
+ * Returns zero if the registry is mapped and being kept current.
+ */
+int sisis_registry_open(void)
+{
+	if (sisis_registry == NULL)
+	{
+		pthread_mutex_lock(&sisis_registry_mutex);
+
+		// Do not look for a missing registry on every lookup
+		time_t now = time(NULL);
+		if (sisis_registry == NULL && now >= sisis_registry_next_attempt)
+		{
+			sisis_registry_next_attempt = now + 1;
+			int fd = shm_open(SISIS_REGISTRY_NAME, O_RDONLY, 0);
+			if (fd >= 0)
+			{
+				struct stat st;
+				if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct sisis_registry))
+				{
+					void * map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+					if (map != MAP_FAILED)
+					{
+						const struct sisis_registry * reg = map;
+						if (reg->magic == SISIS_REGISTRY_MAGIC && reg->version == SISIS_REGISTRY_VERSION && SISIS_REGISTRY_SIZE(reg->max_addrs) <= (size_t)st.st_size)
+							sisis_registry = reg;
+						else
+							munmap(map, st.st_size);
+					}
+				}
+				close(fd);
+			}
+		}
+		pthread_mutex_unlock(&sisis_registry_mutex);
+
+		if (sisis_registry == NULL)
+			return -1;
+	}
+	return (sisis_registry->state == SISIS_REGISTRY_STATE_LIVE && sisis_registry_alive()) ? 0 : -1;
+}
+
+/**
+ * Waits for sisisd to finish a change and starts reading.  Gives up if the
+ * change does not finish, as when sisisd died while writing.
+ *
+ * Returns -1 if the registry could not be read.
+ */
+static int sisis_registry_read_begin(uint32_t * seq)
+{
+	int spins = 0;
+	while ((*seq = sisis_registry->seq) & 1)
+	{
+		if (++spins >= SISIS_REGISTRY_MAX_SPINS)
+			return -1;
+		if (spins % 64 == 0)
+			sched_yield();
+	}
+	__sync_synchronize();
+	return 0;
+}
+
+/** Checks whether sisisd changed the registry while it was being read. */
+static int sisis_registry_read_retry(uint32_t seq)
+{
+	__sync_synchronize();
+	return sisis_registry->seq != seq;
+}
+
+/** Number of addresses, which may be torn while sisisd is writing. */
+static uint32_t sisis_registry_read_count()
+{
+	uint32_t count = sisis_registry->count;
+	return (count > sisis_registry->max_addrs) ? sisis_registry->max_addrs : count;
+}
+
+/**
+ * Finds the first address at or above (or above, if upper is set) a key.
+ */
+static uint32_t sisis_registry_search(const struct in6_addr * key, uint32_t count, int upper)
+{
+	uint32_t lo = 0, hi = count;
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		int cmp = memcmp(&sisis_registry->addrs[mid], key, sizeof(struct in6_addr));
+		if (cmp < 0 || (upper && cmp == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/** Gets the first and last addresses under a prefix. */
+static void sisis_registry_range(const struct in6_addr * prefix, int prefixlen, struct in6_addr * first, struct in6_addr * last)
+{
+	int i;
+	for (i = 0; i < 16; i++)
+	{
+		int bits = prefixlen - i * 8;
+		uint8_t mask = (bits >= 8) ? 0xff : (bits <= 0) ? 0 : (uint8_t)(0xff << (8 - bits));
+		first->s6_addr[i] = prefix->s6_addr[i] & mask;
+		last->s6_addr[i] = prefix->s6_addr[i] | ~mask;
+	}
+}
+
+/**
+ * Get registered addresses under a prefix.  The prefix must lie within the
+ * SIS-IS prefix.  *addrs is set to an array the caller must free.
+ *
+ * Returns the number of addresses or -1 if the registry is unavailable.
+ */
+int sisis_registry_get(const struct in6_addr * prefix, int prefixlen, struct in6_addr ** addrs)
+{
+	*addrs = NULL;
+	if (!sisis_registry_covers(prefix, prefixlen) || sisis_registry_open() != 0)
+		return -1;
+
+	struct in6_addr first, last;
+	sisis_registry_range(prefix, prefixlen, &first, &last);
+
+	struct in6_addr * buf = NULL;
+	uint32_t seq, buf_size = 0, num;
+	do
+	{
+		if (sisis_registry_read_begin(&seq) != 0 || sisis_registry->state != SISIS_REGISTRY_STATE_LIVE)
+		{
+			free(buf);
+			return -1;
+		}
+		uint32_t count = sisis_registry_read_count();
+		uint32_t start = sisis_registry_search(&first, count, 0);
+		uint32_t end = sisis_registry_search(&last, count, 1);
+		num = (end > start) ? end - start : 0;
+		if (num > buf_size)
+		{
+			struct in6_addr * tmp = realloc(buf, num * sizeof(struct in6_addr));
+			if (tmp == NULL)
+			{
+				free(buf);
+				return -1;
+			}
+			buf = tmp;
+			buf_size = num;
+		}
+		memcpy(buf, &sisis_registry->addrs[start], num * sizeof(struct in6_addr));
+	} while (sisis_registry_read_retry(seq));
+
+	*addrs = buf;
+	return num;
+}
+
+/** Count registered addresses under a prefix, or -1 if the registry is unavailable. */
+int sisis_registry_count(const struct in6_addr * prefix, int prefixlen)
+{
+	if (!sisis_registry_covers(prefix, prefixlen) || sisis_registry_open() != 0)
+		return -1;
+
+	struct in6_addr first, last;
+	sisis_registry_range(prefix, prefixlen, &first, &last);
+
+	uint32_t seq, num;
+	do
+	{
+		if (sisis_registry_read_begin(&seq) != 0 || sisis_registry->state != SISIS_REGISTRY_STATE_LIVE)
+			return -1;
+		uint32_t count = sisis_registry_read_count();
+		uint32_t start = sisis_registry_search(&first, count, 0);
+		uint32_t end = sisis_registry_search(&last, count, 1);
+		num = (end > start) ? end - start : 0;
+	} while (sisis_registry_read_retry(seq));
+	return num;
+}
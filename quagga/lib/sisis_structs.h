@@ -46,12 +46,41 @@ struct listnode_sis
 
 struct sisis_request_ack_info
 {
-	short valid;
+	// Next request in the completion queue
+	struct sisis_request_ack_info * next;
 	unsigned long request_id;
+	
+	// Synchronous requests wait on cond until flags are set
 	pthread_mutex_t mutex;
+	pthread_cond_t cond;
 	short flags;
 	#define SISIS_REQUEST_ACK_INFO_ACKED				(1<<0)
 	#define SISIS_REQUEST_ACK_INFO_NACKED				(1<<1)
+	#define SISIS_REQUEST_ACK_INFO_INTERNAL			(1<<2)		// Callback is never queued for sisis_dispatch_completions()
+	// Filled in from batch ACKs if not NULL
+	unsigned char * bitmap;
+	int bitmap_bits;
+	
+	// Asynchronous requests only
+	void (*callback)(unsigned int, int, unsigned char *, int, void *);	// sisis_request_callback_t
+	void * data;
+	struct timespec deadline;
+	
+	// Room for a full batch bitmap in asynchronous requests
+	unsigned char bitmap_buf[];
+};
+
+/* Slot in the table of requests waiting for an ACK */
+struct sisis_request_slot
+{
+	volatile uint64_t key;		// Request id << 32 | state
+	#define SISIS_REQUEST_SLOT_EMPTY				0
+	#define SISIS_REQUEST_SLOT_RESERVED			1		// Being filled in
+	#define SISIS_REQUEST_SLOT_WAITING			2		// Synchronous request
+	#define SISIS_REQUEST_SLOT_PENDING			3		// Asynchronous request
+	#define SISIS_REQUEST_SLOT_CLAIMED			4		// Being emptied
+	struct sisis_request_ack_info * info;
+	uint64_t deadline;		// Monotonic clock in milliseconds
 };
 
 #ifndef USE_IPV6 /* IPv4 Version */
@@ -82,6 +111,22 @@ struct sisis_addr_components
 //};
 //#endif /* HAVE_IPV6 */
 
+#ifdef HAVE_IPV6
+struct sisis_subscription_info
+{
+	struct sisis_subscription_info * next;
+	unsigned int id;
+	struct prefix_ipv6 p;
+	void (*callback)(const struct in6_addr *, int, void *);	// sisis_address_callback_t
+	void * data;
+	
+	// Set while the receive thread calls back
+	int calling;
+	// Freed by the receive thread once its callback returns
+	int removed;
+};
+#endif /* HAVE_IPV6 */
+
 /* IPv4 and IPv6 unified prefix structure. */
 //struct prefix
 //{
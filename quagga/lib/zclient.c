@@ -1024,7 +1024,7 @@ zclient_event (enum event event, struct zclient *zclient)
 }
 
 // Add or delete an IP address from and interface
-int zapi_interface_address (u_char cmd, struct zclient *zclient, struct prefix *p, unsigned int ifindex, time_t * expires)
+int zapi_interface_address (u_char cmd, struct zclient *zclient, struct prefix *p, unsigned int ifindex, u_int32_t * ttl)
 {
   int blen;
   struct stream *s;
@@ -1044,9 +1044,52 @@ int zapi_interface_address (u_char cmd, struct zclient *zclient, struct prefix *
 	stream_put (s, &p->u.prefix, blen);
 	stream_putc (s, p->prefixlen);
 	
-	/* Put Expiration if needed */
-	if (expires)
-		stream_write (s, (u_char *) expires, sizeof(*expires));
+	/* Put lifetime in milliseconds if needed */
+	if (ttl)
+		stream_putl (s, *ttl);
+
+  /* Put length at the first point of the stream. */
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zclient_send_message(zclient);
+}
+
+/*
+ * Send several interface addresses in one ZEBRA_INTERFACE_ADDRESS_ADD_BATCH
+ * or ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH message.  At most
+ * ZAPI_ADDRESS_BATCH_MAX addresses can be sent at once.  ttls, if given,
+ * holds the lifetime of each address in milliseconds, or 0 if it does not
+ * expire.
+ */
+int zapi_interface_address_batch (u_char cmd, struct zclient *zclient, struct prefix *p, u_int32_t *ttls, int count, unsigned int ifindex)
+{
+  int i;
+  struct stream *s;
+
+  if (count < 0 || count > ZAPI_ADDRESS_BATCH_MAX)
+    return -1;
+
+  /* Reset stream. */
+  s = zclient->obuf;
+  stream_reset (s);
+
+  zclient_create_header (s, cmd);
+
+  /* Put ifindex and number of addresses */
+  stream_putl (s, ifindex);
+  stream_putw (s, count);
+
+  /* Prefix information.  Every entry takes the same space. */
+  for (i = 0; i < count; i++)
+    {
+      u_char addr[16];
+      memset (addr, 0, sizeof (addr));
+      memcpy (addr, &p[i].u.prefix, prefix_blen (&p[i]));
+      stream_putc (s, p[i].family);
+      stream_put (s, addr, sizeof (addr));
+      stream_putc (s, p[i].prefixlen);
+      stream_putl (s, ttls ? ttls[i] : 0);
+    }
 
   /* Put length at the first point of the stream. */
   stream_putw_at (s, 0, stream_get_endp (s));
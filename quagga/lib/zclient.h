@@ -183,6 +183,18 @@ extern int zapi_ipv6_route (u_char cmd, struct zclient *zclient,
                      struct prefix_ipv6 *p, struct zapi_ipv6 *api);
 #endif /* HAVE_IPV6 */
 
-extern int zapi_interface_address (u_char cmd, struct zclient *zclient, struct prefix *p, unsigned int ifindex, time_t * expires);
+extern int zapi_interface_address (u_char cmd, struct zclient *zclient, struct prefix *p, unsigned int ifindex, u_int32_t * ttl);
+
+/* Size of one address in a ZEBRA_INTERFACE_ADDRESS_{ADD,DELETE}_BATCH
+   message: family, IPv6 sized prefix, prefix length, lifetime in
+   milliseconds (0 if the address does not expire). */
+#define ZAPI_ADDRESS_BATCH_ENTRY_SIZE (1 + 16 + 1 + 4)
+
+/* Number of addresses that fit into one batch message. */
+#define ZAPI_ADDRESS_BATCH_MAX \
+  ((ZEBRA_MAX_PACKET_SIZ - ZEBRA_HEADER_SIZE - 4 - 2) \
+   / ZAPI_ADDRESS_BATCH_ENTRY_SIZE)
+
+extern int zapi_interface_address_batch (u_char cmd, struct zclient *zclient, struct prefix *p, u_int32_t *ttls, int count, unsigned int ifindex);
 
 #endif /* _ZEBRA_ZCLIENT_H */
@@ -421,7 +421,9 @@ struct in_pktinfo
 #define ZEBRA_ROUTER_ID_ADD               20
 #define ZEBRA_ROUTER_ID_DELETE            21
 #define ZEBRA_ROUTER_ID_UPDATE            22
-#define ZEBRA_MESSAGE_MAX                 23
+#define ZEBRA_INTERFACE_ADDRESS_ADD_BATCH 23
+#define ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH 24
+#define ZEBRA_MESSAGE_MAX                 25
 
 /* Marker value used in new Zserv, in the byte location corresponding
  * the command value in the old zserv header. To allow old and new
@@ -530,9 +532,6 @@ extern const char *zserv_command_string (unsigned int command);
 #define SET_FLAG(V,F)        (V) |= (F)
 #define UNSET_FLAG(V,F)      (V) &= ~(F)
 
-// Timeout to check for expired interface IP addresses
-#define ZEBRA_IF_ADDR_EXPIRATION_THREAD_TIMEOUT			15
-
 /* AFI and SAFI type. */
 typedef u_int16_t afi_t;
 typedef u_int8_t safi_t;
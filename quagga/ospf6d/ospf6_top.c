@@ -140,6 +140,9 @@ ospf6_create (void)
 
   o->external_id_table = route_table_init ();
 
+  o->intra_prefix_hold_init = OSPF6_INTRA_PREFIX_HOLD_INIT_DEFAULT;
+  o->intra_prefix_hold_max = OSPF6_INTRA_PREFIX_HOLD_MAX_DEFAULT;
+
   return o;
 }
 
@@ -309,6 +312,53 @@ DEFUN (ospf6_router_id,
   return CMD_SUCCESS;
 }
 
+static void
+ospf6_intra_prefix_hold_set (struct ospf6 *o, u_int32_t init, u_int32_t max)
+{
+  struct listnode *node;
+  struct ospf6_area *oa;
+
+  o->intra_prefix_hold_init = init;
+  o->intra_prefix_hold_max = max;
+  for (ALL_LIST_ELEMENTS_RO (o->area_list, node, oa))
+    oa->intra_prefix_hold = init;
+}
+
+DEFUN (ospf6_timers_intra_prefix_lsa,
+       ospf6_timers_intra_prefix_lsa_cmd,
+       "timers intra-prefix-lsa <0-60000> <0-60000>",
+       "Adjust routing timers\n"
+       "Hold-down between Intra-Area-Prefix-LSAs for local prefixes\n"
+       "Initial hold-down in milliseconds\n"
+       "Maximum hold-down in milliseconds\n")
+{
+  u_int32_t init, max;
+
+  VTY_GET_INTEGER_RANGE ("initial hold-down", init, argv[0], 0, 60000);
+  VTY_GET_INTEGER_RANGE ("maximum hold-down", max, argv[1], 0, 60000);
+  if (max < init)
+    {
+      vty_out (vty, "Maximum hold-down is less than the initial one%s", VNL);
+      return CMD_WARNING;
+    }
+
+  ospf6_intra_prefix_hold_set ((struct ospf6 *) vty->index, init, max);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf6_timers_intra_prefix_lsa,
+       no_ospf6_timers_intra_prefix_lsa_cmd,
+       "no timers intra-prefix-lsa",
+       NO_STR
+       "Adjust routing timers\n"
+       "Hold-down between Intra-Area-Prefix-LSAs for local prefixes\n")
+{
+  ospf6_intra_prefix_hold_set ((struct ospf6 *) vty->index,
+                               OSPF6_INTRA_PREFIX_HOLD_INIT_DEFAULT,
+                               OSPF6_INTRA_PREFIX_HOLD_MAX_DEFAULT);
+  return CMD_SUCCESS;
+}
+
 DEFUN (ospf6_interface_area,
        ospf6_interface_area_cmd,
        "interface IFNAME area A.B.C.D",
@@ -454,6 +504,9 @@ ospf6_show (struct vty *vty, struct ospf6 *o)
   timerstring (&running, duration, sizeof (duration));
   vty_out (vty, " Running %s%s", duration, VNL);
 
+  vty_out (vty, " Intra-Area-Prefix-LSA hold-down %u to %u msec%s",
+           o->intra_prefix_hold_init, o->intra_prefix_hold_max, VNL);
+
   /* Redistribute configuration */
   /* XXX */
 
@@ -644,6 +697,10 @@ config_write_ospf6 (struct vty *vty)
   vty_out (vty, "router ospf6%s", VNL);
   if (ospf6->router_id_static != 0)
     vty_out (vty, " router-id %s%s", router_id, VNL);
+  if (ospf6->intra_prefix_hold_init != OSPF6_INTRA_PREFIX_HOLD_INIT_DEFAULT
+      || ospf6->intra_prefix_hold_max != OSPF6_INTRA_PREFIX_HOLD_MAX_DEFAULT)
+    vty_out (vty, " timers intra-prefix-lsa %u %u%s",
+             ospf6->intra_prefix_hold_init, ospf6->intra_prefix_hold_max, VNL);
 
   ospf6_redistribute_config_write (vty);
   ospf6_area_config_write (vty);
@@ -699,6 +756,8 @@ ospf6_top_init (void)
   install_element (OSPF6_NODE, &ospf6_router_id_cmd);
   install_element (OSPF6_NODE, &ospf6_interface_area_cmd);
   install_element (OSPF6_NODE, &no_ospf6_interface_area_cmd);
+  install_element (OSPF6_NODE, &ospf6_timers_intra_prefix_lsa_cmd);
+  install_element (OSPF6_NODE, &no_ospf6_timers_intra_prefix_lsa_cmd);
 }
 
 
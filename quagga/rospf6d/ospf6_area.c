@@ -169,6 +169,7 @@ ospf6_area_create (u_int32_t area_id, struct ospf6 *o)
   OSPF6_OPT_SET (oa->options, OSPF6_OPT_R);
 
   oa->ospf6 = o;
+  oa->intra_prefix_hold = o->intra_prefix_hold_init;
   listnode_add_sort (o->area_list, oa);
 
   /* import athoer area's routes as inter-area routes */
@@ -62,6 +62,10 @@ struct ospf6_area
   struct thread *thread_intra_prefix_lsa;
   u_int32_t router_lsa_size_limit;
 
+  /* Last stub Intra-Area-Prefix-LSA origination and current hold-down */
+  struct timeval intra_prefix_originated;
+  u_int32_t intra_prefix_hold;
+
   /* Area announce list */
   struct
   {
@@ -30,6 +30,7 @@
 #include "table.h"
 #include "vty.h"
 #include "command.h"
+#include "jhash.h"
 
 #include "ospf6_proto.h"
 #include "ospf6_message.h"
@@ -672,56 +673,192 @@ ospf6_intra_prefix_lsa_show (struct vty *vty, struct ospf6_lsa *lsa)
   return 0;
 }
 
-int
-ospf6_intra_prefix_lsa_originate_stub (struct thread *thread)
+/* Milliseconds since the stub Intra-Area-Prefix-LSA was last originated */
+static unsigned long
+ospf6_intra_prefix_lsa_since (struct ospf6_area *oa)
 {
-  struct ospf6_area *oa;
+  struct timeval now, res;
 
-  char buffer[OSPF6_MAX_LSASIZE];
-  struct ospf6_lsa_header *lsa_header;
-  struct ospf6_lsa *old, *lsa;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  timersub (&now, &oa->intra_prefix_originated, &res);
+  /* Long enough ago for any hold-down, and not to overflow */
+  if (res.tv_sec > 1000000)
+    return ULONG_MAX;
+  return res.tv_sec * 1000 + res.tv_usec / 1000;
+}
+
+/* Schedules origination of the stub Intra-Area-Prefix-LSA.  A change
+   after a quiet spell goes out at once; later ones wait out the area's
+   hold-down, so a burst of address changes becomes a few LSAs. */
+void
+ospf6_intra_prefix_lsa_schedule_stub (struct ospf6_area *oa)
+{
+  unsigned long since;
+
+  if (oa->thread_intra_prefix_lsa)
+    return;
+
+  since = ospf6_intra_prefix_lsa_since (oa);
+  if (since >= oa->intra_prefix_hold)
+    oa->thread_intra_prefix_lsa =
+      thread_add_event (master, ospf6_intra_prefix_lsa_originate_stub, oa, 0);
+  else
+    oa->thread_intra_prefix_lsa =
+      thread_add_timer_msec (master, ospf6_intra_prefix_lsa_originate_stub,
+                             oa, oa->intra_prefix_hold - since);
+}
+
+/* Group of the stub Intra-Area-Prefix-LSAs a prefix goes in */
+static int
+ospf6_intra_prefix_stub_group (struct prefix *p)
+{
+  if (p->prefixlen != IPV6_MAX_BITLEN
+      || ((p->u.prefix6.s6_addr[0] << 8) | p->u.prefix6.s6_addr[1])
+         != OSPF6_SISIS_PREFIX)
+    return 0;
+  return 1 + jhash (&p->u.prefix6, sizeof (struct in6_addr), 0)
+             % OSPF6_INTRA_PREFIX_SISIS_SHARDS;
+}
 
+/* Originates one part of a group of stub Intra-Area-Prefix-LSAs.  An
+   unchanged LSA is suppressed by ospf6_lsa_originate(). */
+static void
+ospf6_intra_prefix_lsa_originate_stub_part (struct ospf6_area *oa,
+                                            char *buffer, caddr_t end,
+                                            unsigned short prefix_num,
+                                            u_int32_t id)
+{
+  struct ospf6_lsa_header *lsa_header;
   struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
+  struct ospf6_lsa *lsa;
+
+  lsa_header = (struct ospf6_lsa_header *) buffer;
+  intra_prefix_lsa = (struct ospf6_intra_prefix_lsa *)
+    ((caddr_t) lsa_header + sizeof (struct ospf6_lsa_header));
+
+  /* Fill Intra-Area-Prefix-LSA */
+  intra_prefix_lsa->ref_type = htons (OSPF6_LSTYPE_ROUTER);
+  intra_prefix_lsa->ref_id = htonl (0);
+  intra_prefix_lsa->ref_adv_router = oa->ospf6->router_id;
+  intra_prefix_lsa->prefix_num = htons (prefix_num);
+
+  /* Fill LSA Header */
+  lsa_header->age = 0;
+  lsa_header->type = htons (OSPF6_LSTYPE_INTRA_PREFIX);
+  lsa_header->id = htonl (id);
+  lsa_header->adv_router = oa->ospf6->router_id;
+  lsa_header->seqnum =
+    ospf6_new_ls_seqnum (lsa_header->type, lsa_header->id,
+                         lsa_header->adv_router, oa->lsdb);
+  lsa_header->length = htons (end - (caddr_t) lsa_header);
+
+  /* LSA checksum */
+  ospf6_lsa_checksum (lsa_header);
+
+  /* create LSA */
+  lsa = ospf6_lsa_create (lsa_header);
+
+  /* Originate */
+  ospf6_lsa_originate_area (lsa, oa);
+}
+
+/* Originates the parts of a group of stub Intra-Area-Prefix-LSAs.
+   Returns the number of parts. */
+static int
+ospf6_intra_prefix_lsa_originate_stub_group (struct ospf6_area *oa,
+                                             struct ospf6_route_table *table,
+                                             int group)
+{
+  char buffer[OSPF6_MAX_LSASIZE];
+  struct ospf6_route *route;
+  struct ospf6_prefix *op;
+  caddr_t first;
+  unsigned short prefix_num = 0;
+  int part = 0;
+
+  memset (buffer, 0, sizeof (buffer));
+  first = buffer + sizeof (struct ospf6_lsa_header)
+          + sizeof (struct ospf6_intra_prefix_lsa);
+  op = (struct ospf6_prefix *) first;
+  for (route = ospf6_route_head (table); route;
+       route = ospf6_route_best_next (route))
+    {
+      /* Start the next part once this one is full */
+      if ((caddr_t) op + sizeof (struct ospf6_prefix)
+          + OSPF6_PREFIX_SPACE (route->prefix.prefixlen)
+          > buffer + sizeof (buffer))
+        {
+          if (part + 1 == OSPF6_INTRA_PREFIX_STUB_PARTS)
+            {
+              zlog_warn ("Too many prefixes for Intra-Area-Prefix-LSAs of "
+                         "area %s", oa->name);
+              break;
+            }
+          ospf6_intra_prefix_lsa_originate_stub_part
+            (oa, buffer, (caddr_t) op, prefix_num,
+             OSPF6_INTRA_PREFIX_STUB_ID (group, part));
+          part++;
+          memset (buffer, 0, sizeof (buffer));
+          op = (struct ospf6_prefix *) first;
+          prefix_num = 0;
+        }
+
+      op->prefix_length = route->prefix.prefixlen;
+      op->prefix_options = route->path.prefix_options;
+      op->prefix_metric = htons (route->path.cost);
+      memcpy (OSPF6_PREFIX_BODY (op), &route->prefix.u.prefix6,
+              OSPF6_PREFIX_SPACE (op->prefix_length));
+      op = OSPF6_PREFIX_NEXT (op);
+      prefix_num++;
+    }
+
+  if (prefix_num == 0)
+    return part;
+
+  ospf6_intra_prefix_lsa_originate_stub_part
+    (oa, buffer, (caddr_t) op, prefix_num,
+     OSPF6_INTRA_PREFIX_STUB_ID (group, part));
+  return part + 1;
+}
+
+int
+ospf6_intra_prefix_lsa_originate_stub (struct thread *thread)
+{
+  struct ospf6_area *oa;
+  struct ospf6_lsa *old;
   struct ospf6_interface *oi;
   struct ospf6_neighbor *on;
   struct ospf6_route *route;
-  struct ospf6_prefix *op;
   struct listnode *i, *j;
   int full_count = 0;
-  unsigned short prefix_num = 0;
+  int group, part, parts[OSPF6_INTRA_PREFIX_STUB_GROUPS];
   char buf[BUFSIZ];
-  struct ospf6_route_table *route_advertise;
+  struct ospf6_route_table *route_advertise[OSPF6_INTRA_PREFIX_STUB_GROUPS];
 
   oa = (struct ospf6_area *) THREAD_ARG (thread);
   oa->thread_intra_prefix_lsa = NULL;
 
-  /* find previous LSA */
-  old = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_INTRA_PREFIX),
-                           htonl (0), oa->ospf6->router_id, oa->lsdb);
-
-  if (! IS_AREA_ENABLED (oa))
+  /* Back off while changes keep coming, otherwise start over */
+  if (ospf6_intra_prefix_lsa_since (oa) < 2 * (unsigned long) oa->intra_prefix_hold)
     {
-      if (old)
-        ospf6_lsa_purge (old);
-      return 0;
+      oa->intra_prefix_hold *= 2;
+      if (oa->intra_prefix_hold > oa->ospf6->intra_prefix_hold_max)
+        oa->intra_prefix_hold = oa->ospf6->intra_prefix_hold_max;
     }
+  else
+    oa->intra_prefix_hold = oa->ospf6->intra_prefix_hold_init;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &oa->intra_prefix_originated);
+
+  memset (parts, 0, sizeof (parts));
+  if (! IS_AREA_ENABLED (oa))
+    goto purge;
 
   if (IS_OSPF6_DEBUG_ORIGINATE (INTRA_PREFIX))
     zlog_debug ("Originate Intra-Area-Prefix-LSA for area %s's stub prefix",
                oa->name);
 
-  /* prepare buffer */
-  memset (buffer, 0, sizeof (buffer));
-  lsa_header = (struct ospf6_lsa_header *) buffer;
-  intra_prefix_lsa = (struct ospf6_intra_prefix_lsa *)
-    ((caddr_t) lsa_header + sizeof (struct ospf6_lsa_header));
-
-  /* Fill Intra-Area-Prefix-LSA */
-  intra_prefix_lsa->ref_type = htons (OSPF6_LSTYPE_ROUTER);
-  intra_prefix_lsa->ref_id = htonl (0);
-  intra_prefix_lsa->ref_adv_router = oa->ospf6->router_id;
-
-  route_advertise = ospf6_route_table_create (0, 0);
+  for (group = 0; group < OSPF6_INTRA_PREFIX_STUB_GROUPS; group++)
+    route_advertise[group] = ospf6_route_table_create (0, 0);
 
   for (ALL_LIST_ELEMENTS_RO (oa->if_list, i, oi))
     {
@@ -760,63 +897,32 @@ ospf6_intra_prefix_lsa_originate_stub (struct thread *thread)
               prefix2str (&route->prefix, buf, sizeof (buf));
               zlog_debug ("    include %s", buf);
             }
-          ospf6_route_add (ospf6_route_copy (route), route_advertise);
+          group = ospf6_intra_prefix_stub_group (&route->prefix);
+          ospf6_route_add (ospf6_route_copy (route), route_advertise[group]);
         }
     }
 
-  if (route_advertise->count == 0)
-    {
-      if (old)
-        ospf6_lsa_purge (old);
-      ospf6_route_table_delete (route_advertise);
-      return 0;
-    }
-
   /* put prefixes to advertise */
-  prefix_num = 0;
-  op = (struct ospf6_prefix *)
-    ((caddr_t) intra_prefix_lsa + sizeof (struct ospf6_intra_prefix_lsa));
-  for (route = ospf6_route_head (route_advertise); route;
-       route = ospf6_route_best_next (route))
-    {
-      op->prefix_length = route->prefix.prefixlen;
-      op->prefix_options = route->path.prefix_options;
-      op->prefix_metric = htons (route->path.cost);
-      memcpy (OSPF6_PREFIX_BODY (op), &route->prefix.u.prefix6,
-              OSPF6_PREFIX_SPACE (op->prefix_length));
-      op = OSPF6_PREFIX_NEXT (op);
-      prefix_num++;
-    }
-
-  ospf6_route_table_delete (route_advertise);
-
-  if (prefix_num == 0)
+  for (group = 0; group < OSPF6_INTRA_PREFIX_STUB_GROUPS; group++)
     {
-      if (IS_OSPF6_DEBUG_ORIGINATE (INTRA_PREFIX))
-        zlog_debug ("Quit to Advertise Intra-Prefix: no route to advertise");
-      return 0;
+      parts[group] = ospf6_intra_prefix_lsa_originate_stub_group
+                       (oa, route_advertise[group], group);
+      ospf6_route_table_delete (route_advertise[group]);
     }
 
-  intra_prefix_lsa->prefix_num = htons (prefix_num);
-
-  /* Fill LSA Header */
-  lsa_header->age = 0;
-  lsa_header->type = htons (OSPF6_LSTYPE_INTRA_PREFIX);
-  lsa_header->id = htonl (0);
-  lsa_header->adv_router = oa->ospf6->router_id;
-  lsa_header->seqnum =
-    ospf6_new_ls_seqnum (lsa_header->type, lsa_header->id,
-                         lsa_header->adv_router, oa->lsdb);
-  lsa_header->length = htons ((caddr_t) op - (caddr_t) lsa_header);
-
-  /* LSA checksum */
-  ospf6_lsa_checksum (lsa_header);
-
-  /* create LSA */
-  lsa = ospf6_lsa_create (lsa_header);
-
-  /* Originate */
-  ospf6_lsa_originate_area (lsa, oa);
+purge:
+  /* Flush the parts no longer needed */
+  for (group = 0; group < OSPF6_INTRA_PREFIX_STUB_GROUPS; group++)
+    for (part = parts[group]; part < OSPF6_INTRA_PREFIX_STUB_PARTS; part++)
+      {
+        old = ospf6_lsdb_lookup (htons (OSPF6_LSTYPE_INTRA_PREFIX),
+                                 htonl (OSPF6_INTRA_PREFIX_STUB_ID (group, part)),
+                                 oa->ospf6->router_id, oa->lsdb);
+        if (old == NULL)
+          break;
+        if (! OSPF6_LSA_IS_MAXAGE (old))
+          ospf6_lsa_purge (old);
+      }
 
   return 0;
 }
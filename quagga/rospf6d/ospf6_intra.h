@@ -159,13 +159,24 @@ struct ospf6_intra_prefix_lsa
       (oi)->thread_link_lsa = \
         thread_add_event (master, ospf6_link_lsa_originate, oi, 0); \
   } while (0)
+/* Prefixes other than SIS-IS addresses go in group 0 of the stub
+   Intra-Area-Prefix-LSAs, which starts at Link State ID 0 as before.
+   SIS-IS addresses are spread over the other groups by hash, so a change
+   to one address re-originates only its group's LSA.  A group that
+   outgrows one LSA continues in further parts.  The top bit keeps these
+   IDs clear of transit LSAs, which use the interface index. */
+#define OSPF6_INTRA_PREFIX_SISIS_SHARDS 32
+#define OSPF6_INTRA_PREFIX_STUB_GROUPS  (1 + OSPF6_INTRA_PREFIX_SISIS_SHARDS)
+#define OSPF6_INTRA_PREFIX_STUB_PARTS   0x8000
+#define OSPF6_INTRA_PREFIX_STUB_ID(group, part) \
+  (((group) == 0 && (part) == 0) ? 0 : \
+   (0x80000000 | ((u_int32_t) (part) << 16) | (group)))
+
+/* SIS-IS addresses are the /128s under this /16.  From sisis_addr_format.h */
+#define OSPF6_SISIS_PREFIX 0xfcff
+
 #define OSPF6_INTRA_PREFIX_LSA_SCHEDULE_STUB(oa) \
-  do { \
-    if (! (oa)->thread_intra_prefix_lsa) \
-      (oa)->thread_intra_prefix_lsa = \
-        thread_add_event (master, ospf6_intra_prefix_lsa_originate_stub, \
-                          oa, 0); \
-  } while (0)
+  ospf6_intra_prefix_lsa_schedule_stub (oa)
 #define OSPF6_INTRA_PREFIX_LSA_SCHEDULE_TRANSIT(oi) \
   do { \
     if (! (oi)->thread_intra_prefix_lsa) \
@@ -199,6 +210,7 @@ extern int ospf6_network_lsa_originate (struct thread *);
 extern int ospf6_link_lsa_originate (struct thread *);
 extern int ospf6_intra_prefix_lsa_originate_transit (struct thread *);
 extern int ospf6_intra_prefix_lsa_originate_stub (struct thread *);
+extern void ospf6_intra_prefix_lsa_schedule_stub (struct ospf6_area *oa);
 extern void ospf6_intra_prefix_lsa_add (struct ospf6_lsa *lsa);
 extern void ospf6_intra_prefix_lsa_remove (struct ospf6_lsa *lsa);
 
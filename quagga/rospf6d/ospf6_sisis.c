@@ -76,28 +76,16 @@ int sisis_add_ipv6_route(struct route_ipv6 * route, void * data)
   // Make sure it is a host address
   if (route->p->prefixlen == 128) 
   {    
-    char addr[INET6_ADDRSTRLEN];
-    if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), addr, INET6_ADDRSTRLEN) != NULL)
-    {    
-      // Parse components
-      uint64_t prefix, sisis_version, process_type, process_version, sys_id, pid, ts;
-      if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &pid, &ts) == 0)
-      {    
-        // Check that this is an SIS-IS address
-        if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
-        {    
-          // Check if this is the current process type
-          if (process_type == ptype && ptype_version == ptype_version)
-          {
-            pthread_mutex_lock(&num_processes_mutex);
-              if(num_processes == -1)
-                num_processes = get_process_type_version_count(ptype, ptype_version);
-              else
-                num_processes++;
-            pthread_mutex_unlock(&num_processes_mutex);
-          }
-        }
-      }
+    // Check that this is an SIS-IS address of the current process type
+    struct in6_addr * addr = &route->p->prefix;
+    if (sisis_addr_is_sisis(addr) && sisis_addr_get_process_type(addr) == ptype)
+    {
+      pthread_mutex_lock(&num_processes_mutex);
+        if(num_processes == -1)
+          num_processes = get_process_type_version_count(ptype, ptype_version);
+        else
+          num_processes++;
+      pthread_mutex_unlock(&num_processes_mutex);
     }
   }
 
@@ -112,31 +100,19 @@ int sisis_remove_ipv6_route(struct route_ipv6 * route, void * data)
   // Make sure it is a host address
   if (route->p->prefixlen == 128) 
   {    
-    char addr[INET6_ADDRSTRLEN];
-    if (inet_ntop(AF_INET6, &(route->p->prefix.s6_addr), addr, INET6_ADDRSTRLEN) != NULL)
-    {    
-      // Parse components
-      uint64_t prefix, sisis_version, process_type, process_version, sys_id, pid, ts;
-      if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &pid, &ts) == 0)
-      {    
-        // Check that this is an SIS-IS address
-        if (prefix == components[0].fixed_val && sisis_version == components[1].fixed_val)
-        {    
-          // Check if this is the current process type
-          if (process_type == ptype && ptype_version == ptype_version)
-          {
-            pthread_mutex_lock(&num_processes_mutex);
-              // this is where we need to have another process try to bring itself back up
-              if(num_processes == -1)
-                num_processes = get_process_type_version_count(ptype, ptype_version);
-              else
-                num_processes--;
-            pthread_mutex_unlock(&num_processes_mutex);
-
-            check_redundancy();
-          }
-        }
-      }
+    // Check that this is an SIS-IS address of the current process type
+    struct in6_addr * addr = &route->p->prefix;
+    if (sisis_addr_is_sisis(addr) && sisis_addr_get_process_type(addr) == ptype)
+    {
+      pthread_mutex_lock(&num_processes_mutex);
+        // this is where we need to have another process try to bring itself back up
+        if(num_processes == -1)
+          num_processes = get_process_type_version_count(ptype, ptype_version);
+        else
+          num_processes--;
+      pthread_mutex_unlock(&num_processes_mutex);
+
+      check_redundancy();
     }
   }
 
@@ -178,7 +154,7 @@ void ospf6_sisis_changes_subscribe()
   info.rib_add_ipv6_route = sisis_add_ipv6_route;
   info.rib_remove_ipv6_route = sisis_remove_ipv6_route;
   info.data = NULL;
-  subscribe_to_rib_changes(&info); 
+  subscribe_to_sisis_rib_changes(&info, SISIS_PTYPE_RIBCOMP_OSPF6);
 }
 
 int num_of_processes()
@@ -216,15 +192,13 @@ void check_redundancy(void)
       {
         struct in6_addr * remote_addr = (struct in6_addr *)node->data;
         
-        char addr[INET6_ADDRSTRLEN];
         uint64_t prefix, sisis_version, process_type, process_version, sys_id, other_pid, ts;
-        if (inet_ntop(AF_INET6, remote_addr, addr, INET6_ADDRSTRLEN) != NULL)
-          if (get_sisis_addr_components(addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
-            if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
-            {
-              do_startup = 0;
-              break;
-            }
+        if (get_sisis_in6_addr_components(remote_addr, &prefix, &sisis_version, &process_type, &process_version, &sys_id, &other_pid, &ts) == 0)
+          if (ts < timestamp || (ts == timestamp && (sys_id < host_num || other_pid < pid))) // Use System ID and PID as tie breakers
+          {
+            do_startup = 0;
+            break;
+          }
       } 
     }
     
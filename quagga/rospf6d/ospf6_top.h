@@ -60,10 +60,19 @@ struct ospf6
   u_char flag;
 
   struct thread *maxage_remover;
+
+  /* Hold-down between originations of an area's stub
+     Intra-Area-Prefix-LSA, in msec.  It starts at the initial value and
+     doubles while changes keep coming, up to the maximum. */
+  u_int32_t intra_prefix_hold_init;
+  u_int32_t intra_prefix_hold_max;
 };
 
 #define OSPF6_DISABLED    0x01
 
+#define OSPF6_INTRA_PREFIX_HOLD_INIT_DEFAULT  200
+#define OSPF6_INTRA_PREFIX_HOLD_MAX_DEFAULT   5000
+
 /* global pointer for OSPF top data structure */
 extern struct ospf6 *ospf6;
 
@@ -0,0 +1,450 @@
+/*
+ * SIS-IS Rout(e)ing protocol - sisis_admission.c
+ *
+ * Copyright (C) 2010,2011   Stephen Sigwart
+ *                           University of Delaware
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public Licenseas published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/* Admission control for addresses registered on this host.  Every new
+   address ends up in an intra-area-prefix LSA on every router, so new
+   addresses spend tokens from a host-wide bucket and from one bucket per
+   process type.  Refreshes of addresses already in zebra are free.  New
+   addresses may also be held for a short window, and an address that is
+   unregistered within it never reaches zebra at all.  */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "log.h"
+#include "prefix.h"
+#include "table.h"
+#include "zclient.h"
+#include "buffer.h"
+
+#include "sisisd/sisisd.h"
+#define SISIS_ADDR_FORMAT_CODEC_ONLY
+#include "sisis_addr_format.h"
+
+extern struct zclient *zclient;
+
+/* Token bucket.  Tokens are kept in thousandths. */
+struct sisis_bucket
+{
+  struct sisis_bucket *next;
+  u_int32_t ptype;
+  u_int64_t tokens;
+  u_int64_t last;
+
+  /* Refusing, so the next refusal is not logged again */
+  int limited;
+};
+
+/* Address registered through this host. */
+struct sisis_admission
+{
+  struct route_node *rn;
+  int state;
+  u_int32_t ptype;
+  u_int32_t ttl;
+
+  /* When zebra drops a forwarded address, or a held one is forwarded */
+  u_int64_t expires;
+
+  /* Held addresses, oldest first */
+  struct sisis_admission *prev;
+  struct sisis_admission *next;
+};
+
+#define SISIS_ADMISSION_HELD		0
+#define SISIS_ADMISSION_NEW		1
+#define SISIS_ADMISSION_FORWARDED	2
+
+static struct
+{
+  int enabled;
+  struct route_table *table;
+  struct sisis_bucket host;
+  struct sisis_bucket *ptypes[SISIS_PTYPE_BUCKET_HASH_SIZE];
+
+  struct sisis_admission *held_head;
+  struct sisis_admission *held_tail;
+  struct thread *t_held;
+  struct thread *t_sweep;
+
+  /* Counted since the last sweep */
+  unsigned long refused;
+  unsigned long coalesced;
+} admission;
+
+/* Monotonic milliseconds. */
+static u_int64_t
+sisis_admission_msec (void)
+{
+  struct timeval tv;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &tv);
+  return (u_int64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Takes a token if one is left.  A zero rate means no limit. */
+static int
+sisis_bucket_take (struct sisis_bucket *bucket, u_int32_t rate,
+		   u_int32_t burst, u_int64_t now)
+{
+  u_int64_t max = (u_int64_t) burst * 1000;
+
+  if (rate == 0)
+    return 1;
+
+  bucket->tokens += (now - bucket->last) * rate;
+  bucket->last = now;
+  if (bucket->tokens > max)
+    bucket->tokens = max;
+
+  if (bucket->tokens < 1000)
+    return 0;
+  bucket->tokens -= 1000;
+  return 1;
+}
+
+/* Gives back a token for an address that never reached zebra. */
+static void
+sisis_bucket_refund (struct sisis_bucket *bucket, u_int32_t rate,
+		     u_int32_t burst)
+{
+  if (rate == 0)
+    return;
+
+  bucket->tokens += 1000;
+  if (bucket->tokens > (u_int64_t) burst * 1000)
+    bucket->tokens = (u_int64_t) burst * 1000;
+}
+
+/* Finds the bucket of a process type, starting it full. */
+static struct sisis_bucket *
+sisis_bucket_get (u_int32_t ptype, u_int64_t now)
+{
+  struct sisis_bucket **head, *bucket;
+
+  head = &admission.ptypes[ptype % SISIS_PTYPE_BUCKET_HASH_SIZE];
+  for (bucket = *head; bucket; bucket = bucket->next)
+    if (bucket->ptype == ptype)
+      return bucket;
+
+  bucket = XCALLOC (MTYPE_SISIS_BUCKET, sizeof (struct sisis_bucket));
+  bucket->ptype = ptype;
+  bucket->tokens = (u_int64_t) sisis_info->ptype_burst * 1000;
+  bucket->last = now;
+  bucket->next = *head;
+  *head = bucket;
+  return bucket;
+}
+
+/* Takes a token from the host and process type buckets, or neither. */
+static int
+sisis_admission_take (u_int32_t ptype, u_int64_t now)
+{
+  struct sisis_bucket *bucket = sisis_bucket_get (ptype, now);
+
+  if (!sisis_bucket_take (bucket, sisis_info->ptype_rate,
+			  sisis_info->ptype_burst, now))
+    {
+      if (!bucket->limited)
+	zlog_warn ("sisis_admission: process type %u is registering more than "
+		   "%u addresses per second", ptype, sisis_info->ptype_rate);
+      bucket->limited = 1;
+      return 0;
+    }
+  bucket->limited = 0;
+
+  if (!sisis_bucket_take (&admission.host, sisis_info->host_rate,
+			  sisis_info->host_burst, now))
+    {
+      sisis_bucket_refund (bucket, sisis_info->ptype_rate,
+			   sisis_info->ptype_burst);
+      if (!admission.host.limited)
+	zlog_warn ("sisis_admission: host is registering more than "
+		   "%u addresses per second", sisis_info->host_rate);
+      admission.host.limited = 1;
+      return 0;
+    }
+  admission.host.limited = 0;
+  return 1;
+}
+
+/* Gives back the tokens of an address that never reached zebra. */
+static void
+sisis_admission_refund (u_int32_t ptype)
+{
+  struct sisis_bucket *bucket = sisis_bucket_get (ptype, sisis_admission_msec ());
+
+  sisis_bucket_refund (bucket, sisis_info->ptype_rate, sisis_info->ptype_burst);
+  sisis_bucket_refund (&admission.host, sisis_info->host_rate,
+		       sisis_info->host_burst);
+}
+
+static void
+sisis_admission_held_unlink (struct sisis_admission *adm)
+{
+  if (adm->prev)
+    adm->prev->next = adm->next;
+  else
+    admission.held_head = adm->next;
+  if (adm->next)
+    adm->next->prev = adm->prev;
+  else
+    admission.held_tail = adm->prev;
+  adm->prev = adm->next = NULL;
+}
+
+static void
+sisis_admission_free (struct sisis_admission *adm)
+{
+  struct route_node *rn = adm->rn;
+
+  if (adm->state == SISIS_ADMISSION_HELD)
+    sisis_admission_held_unlink (adm);
+  rn->info = NULL;
+  route_unlock_node (rn);
+  XFREE (MTYPE_SISIS_ADMISSION, adm);
+}
+
+static struct sisis_admission *
+sisis_admission_lookup (struct in6_addr *addr)
+{
+  struct prefix_ipv6 p;
+  struct route_node *rn;
+
+  memset (&p, 0, sizeof (p));
+  p.family = AF_INET6;
+  p.prefixlen = IPV6_MAX_BITLEN;
+  p.prefix = *addr;
+
+  rn = route_node_lookup (admission.table, (struct prefix *) &p);
+  if (rn == NULL)
+    return NULL;
+  route_unlock_node (rn);
+  return rn->info;
+}
+
+/* Forwards held addresses once their window has passed. */
+static int
+sisis_admission_flush (struct thread *thread)
+{
+  struct prefix p[ZAPI_ADDRESS_BATCH_MAX];
+  u_int32_t ttls[ZAPI_ADDRESS_BATCH_MAX];
+  struct sisis_admission *adm;
+  u_int64_t now = sisis_admission_msec ();
+  int ifindex = if_nametoindex ("lo");
+  int i, n, ok;
+
+  admission.t_held = NULL;
+  while (admission.held_head && admission.held_head->expires <= now)
+    {
+      /* Wait for zebra to catch up */
+      if (zclient->sock >= 0 && !buffer_empty (zclient->wb))
+	{
+	  admission.t_held =
+	    thread_add_timer_msec (sisis_info->master, sisis_admission_flush,
+				   NULL, SISIS_ZEBRA_BACKOFF_MSEC);
+	  return 0;
+	}
+
+      for (n = 0; n < ZAPI_ADDRESS_BATCH_MAX && admission.held_head
+		  && admission.held_head->expires <= now; n++)
+	{
+	  adm = admission.held_head;
+	  sisis_admission_held_unlink (adm);
+	  adm->state = SISIS_ADMISSION_NEW;
+	  prefix_copy (&p[n], &adm->rn->p);
+	  ttls[n] = adm->ttl;
+	}
+
+      ok = (zapi_interface_address_batch (ZEBRA_INTERFACE_ADDRESS_ADD_BATCH,
+					  zclient, p, ttls, n, ifindex) == 0);
+      if (!ok)
+	zlog_warn ("sisis_admission_flush: could not forward %d addresses", n);
+      for (i = 0; i < n; i++)
+	sisis_admission_forwarded (&p[i].u.prefix6, ttls[i], ok);
+    }
+
+  if (admission.held_head)
+    admission.t_held =
+      thread_add_timer_msec (sisis_info->master, sisis_admission_flush, NULL,
+			     admission.held_head->expires - now);
+  return 0;
+}
+
+/* Drops addresses zebra has expired, and reports what was limited. */
+static int
+sisis_admission_sweep (struct thread *thread)
+{
+  struct route_node *rn;
+  struct sisis_admission *adm;
+  u_int64_t now = sisis_admission_msec ();
+
+  for (rn = route_top (admission.table); rn; rn = route_next (rn))
+    if ((adm = rn->info) != NULL && adm->state == SISIS_ADMISSION_FORWARDED
+	&& adm->expires <= now)
+      sisis_admission_free (adm);
+
+  if (admission.refused || admission.coalesced)
+    zlog_info ("sisis_admission: refused %lu and coalesced %lu addresses",
+	       admission.refused, admission.coalesced);
+  admission.refused = admission.coalesced = 0;
+
+  admission.t_sweep =
+    thread_add_timer (sisis_info->master, sisis_admission_sweep, NULL,
+		      SISIS_ADMISSION_SWEEP_INTERVAL);
+  return 0;
+}
+
+/* Starts admission control if any limit or window is configured. */
+void
+sisis_admission_init (void)
+{
+  memset (&admission, 0, sizeof (admission));
+  if (sisis_info->host_rate == 0 && sisis_info->ptype_rate == 0
+      && sisis_info->coalesce_msec == 0)
+    return;
+
+  admission.enabled = 1;
+  admission.table = route_table_init ();
+  admission.host.last = sisis_admission_msec ();
+  admission.host.tokens = (u_int64_t) sisis_info->host_burst * 1000;
+  admission.t_sweep =
+    thread_add_timer (sisis_info->master, sisis_admission_sweep, NULL,
+		      SISIS_ADMISSION_SWEEP_INTERVAL);
+
+  zlog_info ("sisis_admission: host limit %u/%u, process type limit %u/%u, "
+	     "coalesce %u ms", sisis_info->host_rate, sisis_info->host_burst,
+	     sisis_info->ptype_rate, sisis_info->ptype_burst,
+	     sisis_info->coalesce_msec);
+}
+
+/* Decides what to do with a registration.  New addresses need tokens,
+   and are held if a coalesce window is set.  Returns SISIS_ADMIT_*. */
+int
+sisis_admission_register (struct in6_addr *addr, u_int32_t ttl)
+{
+  struct prefix_ipv6 p;
+  struct route_node *rn;
+  struct sisis_admission *adm;
+  u_int32_t ptype;
+  u_int64_t now;
+
+  if (!admission.enabled)
+    return SISIS_ADMIT_FORWARD;
+
+  now = sisis_admission_msec ();
+  adm = sisis_admission_lookup (addr);
+  if (adm)
+    {
+      adm->ttl = ttl;
+      if (adm->state == SISIS_ADMISSION_HELD)
+	return SISIS_ADMIT_HELD;
+      if (adm->expires > now)
+	return SISIS_ADMIT_FORWARD;
+
+      /* Zebra has let it go, so it is new again */
+      sisis_admission_free (adm);
+    }
+
+  ptype = sisis_addr_get_process_type (addr);
+  if (!sisis_admission_take (ptype, now))
+    {
+      admission.refused++;
+      return SISIS_ADMIT_REFUSED;
+    }
+
+  memset (&p, 0, sizeof (p));
+  p.family = AF_INET6;
+  p.prefixlen = IPV6_MAX_BITLEN;
+  p.prefix = *addr;
+  rn = route_node_get (admission.table, (struct prefix *) &p);
+
+  adm = XCALLOC (MTYPE_SISIS_ADMISSION, sizeof (struct sisis_admission));
+  adm->rn = rn;
+  adm->ptype = ptype;
+  adm->ttl = ttl;
+  rn->info = adm;
+
+  if (sisis_info->coalesce_msec == 0)
+    {
+      adm->state = SISIS_ADMISSION_NEW;
+      return SISIS_ADMIT_FORWARD;
+    }
+
+  adm->state = SISIS_ADMISSION_HELD;
+  adm->expires = now + sisis_info->coalesce_msec;
+  adm->prev = admission.held_tail;
+  if (admission.held_tail)
+    admission.held_tail->next = adm;
+  else
+    admission.held_head = adm;
+  admission.held_tail = adm;
+  if (admission.t_held == NULL)
+    admission.t_held =
+      thread_add_timer_msec (sisis_info->master, sisis_admission_flush, NULL,
+			     sisis_info->coalesce_msec);
+  return SISIS_ADMIT_HELD;
+}
+
+/* Records whether zebra took a registration that was forwarded.  A new
+   address zebra did not take gets its tokens back. */
+void
+sisis_admission_forwarded (struct in6_addr *addr, u_int32_t ttl, int ok)
+{
+  struct sisis_admission *adm;
+
+  if (!admission.enabled || (adm = sisis_admission_lookup (addr)) == NULL)
+    return;
+
+  if (ok)
+    {
+      adm->state = SISIS_ADMISSION_FORWARDED;
+      adm->expires = sisis_admission_msec () + ttl;
+    }
+  else if (adm->state == SISIS_ADMISSION_NEW)
+    {
+      sisis_admission_refund (adm->ptype);
+      sisis_admission_free (adm);
+    }
+}
+
+/* Decides what to do with an unregistration.  One that catches its
+   address still held cancels both.  Returns SISIS_ADMIT_FORWARD or
+   SISIS_ADMIT_COALESCED. */
+int
+sisis_admission_unregister (struct in6_addr *addr)
+{
+  struct sisis_admission *adm;
+  int held;
+
+  if (!admission.enabled || (adm = sisis_admission_lookup (addr)) == NULL)
+    return SISIS_ADMIT_FORWARD;
+
+  held = (adm->state == SISIS_ADMISSION_HELD);
+  if (held)
+    {
+      sisis_admission_refund (adm->ptype);
+      admission.coalesced++;
+    }
+  sisis_admission_free (adm);
+  return held ? SISIS_ADMIT_COALESCED : SISIS_ADMIT_FORWARD;
+}
@@ -47,6 +47,10 @@ static const struct option longopts[] =
   { "pid_file",    required_argument, NULL, 'i'},
   { "sisis_port",  required_argument, NULL, 'p'},
   { "listenon",    required_argument, NULL, 'l'},
+  { "unix_socket", required_argument, NULL, 'U'},
+  { "host_limit",  required_argument, NULL, 'L'},
+  { "ptype_limit", required_argument, NULL, 'T'},
+  { "coalesce",    required_argument, NULL, 'W'},
   { "retain",      no_argument,       NULL, 'r'},
   { "user",        required_argument, NULL, 'u'},
   { "group",       required_argument, NULL, 'g'},
@@ -133,6 +137,10 @@ redistribution between different routing protocols.\n\n\
 -i, --pid_file     Set process identifier file name\n\
 -p, --sisis_port   Set sisis protocol's port number\n\
 -l, --listenon     Listen on specified address (implies -n)\n\
+-U, --unix_socket  Also accept clients on the specified Unix socket\n\
+-L, --host_limit   Limit new addresses on this host to RATE[/BURST] per second\n\
+-T, --ptype_limit  Limit new addresses of each process type to RATE[/BURST]\n\
+-W, --coalesce     Hold new addresses for MSEC, dropping any unregistered meanwhile\n\
 -r, --retain       When program terminates, retain added route by sisisd.\n\
 -n, --no_kernel    Do not install route to kernel.\n\
 -u, --user         User to run as\n\
@@ -146,6 +154,28 @@ Report bugs to %s\n", progname, ZEBRA_BUG_ADDRESS);
   exit (status);
 }
 
+/* Parses a rate limit of RATE[/BURST].  The burst defaults to the rate. */
+static int sisis_parse_limit (const char *arg, u_int32_t *rate,
+                              u_int32_t *burst)
+{
+  char *end;
+  unsigned long val;
+
+  val = strtoul (arg, &end, 10);
+  if (end == arg || val > 0xffffff)
+    return -1;
+  *rate = *burst = val;
+  if (*end == '/')
+    {
+      arg = end + 1;
+      val = strtoul (arg, &end, 10);
+      if (end == arg || val == 0 || val > 0xffffff)
+        return -1;
+      *burst = val;
+    }
+  return (*end == '\0') ? 0 : -1;
+}
+
 /* SIGHUP handler. */
 void sighup (void)
 {
@@ -200,10 +230,14 @@ static void sisis_exit (int status)
       zlog_err ("close (%d): %s", *(int *)(long *)socket, safe_strerror (errno));
   }
   list_delete (sisis_info->listen_sockets);
+  if (sisis_info->unix_path)
+    unlink (sisis_info->unix_path);
   
   if (zclient)
     zclient_free (zclient);
 
+  sisis_registry_finish ();
+
   /* reverse sisis_master_init */
   if (master)
     thread_master_free (master);
@@ -238,7 +272,7 @@ int main (int argc, char **argv)
   /* Command line argument treatment. */
   while (1) 
   {
-    opt = getopt_long (argc, argv, "df:i:hp:l:ru:g:v", longopts, 0);
+    opt = getopt_long (argc, argv, "df:i:hp:l:U:L:T:W:ru:g:v", longopts, 0);
     
     if (opt == EOF)
       break;
@@ -263,6 +297,22 @@ int main (int argc, char **argv)
         else
           sisis_info->port = tmp_port;
         break;
+      case 'U':
+        sisis_info->unix_path = optarg;
+        break;
+      case 'L':
+        if (sisis_parse_limit (optarg, &sisis_info->host_rate,
+                               &sisis_info->host_burst) < 0)
+          usage (progname, 1);
+        break;
+      case 'T':
+        if (sisis_parse_limit (optarg, &sisis_info->ptype_rate,
+                               &sisis_info->ptype_burst) < 0)
+          usage (progname, 1);
+        break;
+      case 'W':
+        sisis_info->coalesce_msec = atoi (optarg);
+        break;
       case 'r':
         retain_mode = 1;
         break;
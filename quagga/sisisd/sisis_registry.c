@@ -0,0 +1,263 @@
+/*
+ * SIS-IS Rout(e)ing protocol - sisis_registry.c
+ *
+ * Copyright (C) 2010,2011   Stephen Sigwart
+ *                           University of Delaware
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public Licenseas published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "prefix.h"
+
+#include "sisisd/sisisd.h"
+#include "sisis_registry.h"
+
+/* Shared memory registry of SIS-IS addresses.  sisisd is the only writer. */
+static struct sisis_registry *registry = NULL;
+
+/* Starts a change.  Readers retry until it ends. */
+static void
+sisis_registry_write_begin (void)
+{
+  registry->seq++;
+  __sync_synchronize ();
+}
+
+/* Ends a change. */
+static void
+sisis_registry_write_end (void)
+{
+  __sync_synchronize ();
+  registry->seq++;
+}
+
+/* Finds where an address is, or would go. */
+static u_int32_t
+sisis_registry_search (struct in6_addr *addr, int *found)
+{
+  u_int32_t lo = 0, hi = registry->count, mid;
+  int cmp;
+
+  *found = 0;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      cmp = memcmp (&registry->addrs[mid], addr, sizeof (struct in6_addr));
+      if (cmp == 0)
+	{
+	  *found = 1;
+	  return mid;
+	}
+      if (cmp < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Maps the registry, reusing the segment of an earlier run since clients
+   may still have it mapped.  The registry starts empty and down. */
+int
+sisis_registry_init (void)
+{
+  int fd;
+  struct stat st;
+  size_t size = SISIS_REGISTRY_SIZE (SISIS_REGISTRY_MAX_ADDRS);
+  void *map;
+
+  fd = shm_open (SISIS_REGISTRY_NAME, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    {
+      zlog_err ("sisis_registry_init: shm_open: %s", safe_strerror (errno));
+      return -1;
+    }
+
+  /* Clients only need to read it, whatever our umask */
+  fchmod (fd, 0644);
+  if (fstat (fd, &st) < 0 || (st.st_size < size && ftruncate (fd, size) < 0))
+    {
+      zlog_err ("sisis_registry_init: %s", safe_strerror (errno));
+      close (fd);
+      return -1;
+    }
+
+  map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      zlog_err ("sisis_registry_init: mmap: %s", safe_strerror (errno));
+      return -1;
+    }
+  registry = map;
+
+  /* An earlier run may have stopped in the middle of a change */
+  if (registry->seq & 1)
+    registry->seq++;
+
+  sisis_registry_write_begin ();
+  registry->version = SISIS_REGISTRY_VERSION;
+  registry->max_addrs = SISIS_REGISTRY_MAX_ADDRS;
+  registry->state = SISIS_REGISTRY_STATE_DOWN;
+  registry->count = 0;
+  registry->magic = SISIS_REGISTRY_MAGIC;
+  sisis_registry_write_end ();
+  sisis_registry_heartbeat ();
+
+  return 0;
+}
+
+/* Tells clients sisisd is still keeping the registry current.  Called
+   every SISIS_REGISTRY_HEARTBEAT_SECS. */
+void
+sisis_registry_heartbeat (void)
+{
+  struct timespec now;
+
+  if (registry == NULL)
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  registry->heartbeat = now.tv_sec;
+}
+
+/* Empties the registry and takes it down until sisis_registry_set_live(). */
+void
+sisis_registry_clear (void)
+{
+  if (registry == NULL)
+    return;
+
+  sisis_registry_write_begin ();
+  registry->state = SISIS_REGISTRY_STATE_DOWN;
+  registry->count = 0;
+  sisis_registry_write_end ();
+}
+
+/* Lets clients use the registry once it holds every address. */
+void
+sisis_registry_set_live (void)
+{
+  if (registry == NULL || registry->state != SISIS_REGISTRY_STATE_DOWN)
+    return;
+
+  sisis_registry_write_begin ();
+  registry->state = SISIS_REGISTRY_STATE_LIVE;
+  sisis_registry_write_end ();
+}
+
+/* Takes the registry down when sisisd stops keeping it current. */
+void
+sisis_registry_finish (void)
+{
+  if (registry == NULL)
+    return;
+
+  sisis_registry_write_begin ();
+  registry->state = SISIS_REGISTRY_STATE_DOWN;
+  sisis_registry_write_end ();
+
+  munmap (registry, SISIS_REGISTRY_SIZE (SISIS_REGISTRY_MAX_ADDRS));
+  registry = NULL;
+}
+
+/* Adds an address.  Once full, clients are sent back to the kernel
+   routing table until the registry is cleared.  Returns 0 if the address
+   was already there, otherwise 1, including when that cannot be told. */
+int
+sisis_registry_add (struct in6_addr *addr)
+{
+  u_int32_t pos;
+  int found;
+
+  if (registry == NULL || registry->state == SISIS_REGISTRY_STATE_OVERFLOW)
+    return 1;
+
+  pos = sisis_registry_search (addr, &found);
+  if (found)
+    return 0;
+
+  sisis_registry_write_begin ();
+  if (registry->count == registry->max_addrs)
+    {
+      zlog_warn ("sisis_registry_add: more than %u addresses, registry disabled",
+		 registry->max_addrs);
+      registry->state = SISIS_REGISTRY_STATE_OVERFLOW;
+    }
+  else
+    {
+      memmove (&registry->addrs[pos + 1], &registry->addrs[pos],
+	       (registry->count - pos) * sizeof (struct in6_addr));
+      registry->addrs[pos] = *addr;
+      registry->count++;
+    }
+  sisis_registry_write_end ();
+  return 1;
+}
+
+/* Removes an address.  Returns 0 if it was not there, otherwise 1,
+   including when that cannot be told. */
+int
+sisis_registry_delete (struct in6_addr *addr)
+{
+  u_int32_t pos;
+  int found;
+
+  if (registry == NULL || registry->state == SISIS_REGISTRY_STATE_OVERFLOW)
+    return 1;
+
+  pos = sisis_registry_search (addr, &found);
+  if (!found)
+    return 0;
+
+  sisis_registry_write_begin ();
+  registry->count--;
+  memmove (&registry->addrs[pos], &registry->addrs[pos + 1],
+	   (registry->count - pos) * sizeof (struct in6_addr));
+  sisis_registry_write_end ();
+  return 1;
+}
+
+/* Calls func for each address under a prefix.  Returns -1 if the registry
+   is not complete, otherwise 0. */
+int
+sisis_registry_walk (struct prefix_ipv6 *p,
+		     void (*func) (struct in6_addr *, void *), void *arg)
+{
+  struct prefix_ipv6 addr;
+  u_int32_t pos;
+  int found;
+
+  if (registry == NULL || registry->state != SISIS_REGISTRY_STATE_LIVE)
+    return -1;
+
+  /* Start at the lowest address under the prefix */
+  addr = *p;
+  apply_mask_ipv6 (&addr);
+  for (pos = sisis_registry_search (&addr.prefix, &found);
+       pos < registry->count; pos++)
+    {
+      addr.prefixlen = IPV6_MAX_BITLEN;
+      addr.prefix = registry->addrs[pos];
+      if (!prefix_match ((struct prefix *) p, (struct prefix *) &addr))
+	break;
+      (*func) (&registry->addrs[pos], arg);
+    }
+  return 0;
+}
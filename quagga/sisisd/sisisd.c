@@ -35,9 +35,17 @@
 #include "command.h"
 #include "privs.h"
 #include "linklist.h"
+#include "buffer.h"
+#include "stream.h"
 
 #include "sisisd/sisisd.h"
 #include "sisisd/sisis_zebra.h"
+#include "sisis_registry.h"
+#define SISIS_ADDR_FORMAT_CODEC_ONLY
+#include "sisis_addr_format.h"
+
+/* For sockaddr_un. */
+#include <sys/un.h>
 
 extern struct zebra_privs_t sisisd_privs;
 
@@ -49,14 +57,26 @@ static struct sisis_info sisis_info_real;
 /* SIS-IS process wide configuration pointer to export.  */
 struct sisis_info *sisis_info;
 
+static int sisis_registry_timer (struct thread *);
+
 void sisis_init ()
 {
+  /* Publish addresses learned from zebra. */
+  sisis_registry_init ();
+  thread_add_timer (sisis_info->master, sisis_registry_timer, NULL,
+                    SISIS_REGISTRY_HEARTBEAT_SECS);
+
   /* Init zebra. */
   sisis_zebra_init ();
+
+  /* Limit and coalesce new addresses if configured. */
+  sisis_admission_init ();
 	
 	// Start listener
 	//zlog_debug("Port: %d; Address:%s\n", sisis_info->port, sisis_info->address);
 	sisis_socket(sisis_info->port, sisis_info->address);
+	if (sisis_info->unix_path)
+		sisis_unix_socket(sisis_info->unix_path);
 }
 
 /* time_t value that is monotonicly increasing
@@ -82,12 +102,100 @@ void sisis_master_init (void)
 	sisis_info->address = "127.0.0.1";
 }
 
+/* Set while waiting for zebra to finish a route dump. */
+static int sisis_zebra_dump_pending = 0;
+
+/* Router id from zebra.  The first after connecting starts a dump of every
+ * route into the registry.  The reply to a second request comes after the
+ * dump, which marks the registry complete. */
+static int sisis_zebra_router_id_update (int command, struct zclient *zclient,
+                                         zebra_size_t length)
+{
+  int type;
+  struct stream *s;
+
+  if (sisis_zebra_dump_pending)
+    {
+      sisis_zebra_dump_pending = 0;
+      sisis_registry_set_live ();
+      return 0;
+    }
+
+  /* Zebra only dumps routes of a type when redistribution starts.
+     Subscribers cannot be told what changes they missed. */
+  sisis_registry_clear ();
+  sisis_notify_lost ();
+  for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+    if (type != zclient->redist_default)
+      {
+        zclient_redistribute (ZEBRA_REDISTRIBUTE_DELETE, zclient, type);
+        zclient_redistribute (ZEBRA_REDISTRIBUTE_ADD, zclient, type);
+      }
+
+  s = zclient->obuf;
+  stream_reset (s);
+  zclient_create_header (s, ZEBRA_ROUTER_ID_ADD);
+  zclient_send_message (zclient);
+  sisis_zebra_dump_pending = 1;
+  return 0;
+}
+
+/* Keeps the registry heartbeat going.  While zebra is disconnected the
+ * registry is taken down; it is dumped again once zebra is back. */
+static int sisis_registry_timer (struct thread *thread)
+{
+  if (zclient && zclient->sock < 0)
+    {
+      sisis_zebra_dump_pending = 0;
+      sisis_registry_clear ();
+    }
+  sisis_registry_heartbeat ();
+
+  thread_add_timer (sisis_info->master, sisis_registry_timer, NULL,
+                    SISIS_REGISTRY_HEARTBEAT_SECS);
+  return 0;
+}
+
+/* IPv6 route added or removed.  SIS-IS host routes go in the registry. */
+static int sisis_zebra_read_ipv6 (int command, struct zclient *zclient,
+                                  zebra_size_t length)
+{
+  struct stream *s = zclient->ibuf;
+  struct prefix_ipv6 p;
+
+  /* Type, flags, message. */
+  stream_getc (s);
+  stream_getc (s);
+  stream_getc (s);
+
+  /* IPv6 prefix. */
+  memset (&p, 0, sizeof (struct prefix_ipv6));
+  p.family = AF_INET6;
+  p.prefixlen = stream_getc (s);
+  if (p.prefixlen > IPV6_MAX_BITLEN)
+    return -1;
+  stream_get (&p.prefix, s, PSIZE (p.prefixlen));
+
+  if (p.prefixlen != IPV6_MAX_BITLEN
+      || !sisis_registry_covers (&p.prefix, p.prefixlen))
+    return 0;
+
+  if (command == ZEBRA_IPV6_ROUTE_ADD)
+    {
+      if (sisis_registry_add (&p.prefix))
+        sisis_notify (&p.prefix, SISIS_NOTIFY_ADDED);
+    }
+  else if (sisis_registry_delete (&p.prefix))
+    sisis_notify (&p.prefix, SISIS_NOTIFY_REMOVED);
+  return 0;
+}
+
 void sisis_zebra_init (void)
 {
   /* Set default values. */
   zclient = zclient_new ();
   zclient_init (zclient, ZEBRA_ROUTE_BGP);
-  zclient->router_id_update = NULL;
+  zclient->router_id_update = sisis_zebra_router_id_update;
   zclient->interface_add = NULL;
   zclient->interface_delete = NULL;
   zclient->interface_address_add = NULL;
@@ -97,8 +205,8 @@ void sisis_zebra_init (void)
   zclient->interface_up = NULL;
   zclient->interface_down = NULL;
 #ifdef HAVE_IPV6
-  zclient->ipv6_route_add = NULL;
-  zclient->ipv6_route_delete = NULL;
+  zclient->ipv6_route_add = sisis_zebra_read_ipv6;
+  zclient->ipv6_route_delete = sisis_zebra_read_ipv6;
 #endif /* HAVE_IPV6 */
 }
 
@@ -107,8 +215,255 @@ void sisis_terminate (void)
   // TODO
 }
 
+/* Lifetime to give an address.  Zero picks the default. */
+static u_int32_t sisis_address_ttl (u_int32_t ttl)
+{
+  if (ttl == 0)
+    return SISIS_ADDRESS_TTL_DEFAULT;
+  if (ttl < SISIS_ADDRESS_TTL_MIN)
+    return SISIS_ADDRESS_TTL_MIN;
+  return ttl;
+}
+
+/* Replies waiting for sisis_flush_replies(). */
+static struct
+{
+	int sock;
+	int count;
+	struct mmsghdr msgs[SISIS_RECV_BATCH];
+	struct iovec iov[SISIS_RECV_BATCH];
+	struct sockaddr_in addrs[SISIS_RECV_BATCH];
+	char bufs[SISIS_RECV_BATCH][SISIS_REPLY_BUFSIZ];
+} sisis_replies;
+
+/* Sends every queued reply.  If the client's socket is full, waits for the
+ * client rather than lose replies it may be waiting for. */
+static void sisis_flush_replies(void)
+{
+	int sent = 0, rtn, flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+	while (sent < sisis_replies.count)
+	{
+		rtn = sendmmsg(sisis_replies.sock, sisis_replies.msgs + sent, sisis_replies.count - sent, flags);
+		if (rtn < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if ((flags & MSG_DONTWAIT) && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+			{
+				flags &= ~MSG_DONTWAIT;
+				continue;
+			}
+			zlog_err ("sisis_flush_replies: dropped %d replies: %s", sisis_replies.count - sent, safe_strerror(errno));
+			break;
+		}
+		sent += rtn;
+	}
+	sisis_replies.count = 0;
+}
+
+/* Queues a reply to a client.  Replies are sent together by sisis_flush_replies(). */
+static void sisis_reply(struct sisis_client * client, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len)
+{
+	// Nobody to tell once a connection has closed
+	if (client->sock < 0)
+		return;
+	
+	if (sisis_replies.count == SISIS_RECV_BATCH || (sisis_replies.count && sisis_replies.sock != client->sock))
+		sisis_flush_replies();
+	
+	int i = sisis_replies.count++;
+	sisis_replies.sock = client->sock;
+	sisis_replies.addrs[i] = client->addr;
+	sisis_replies.iov[i].iov_base = sisis_replies.bufs[i];
+	sisis_replies.iov[i].iov_len = sisis_construct_message(sisis_replies.bufs[i], SISIS_MESSAGE_VERSION, request_id, cmd, data, data_len);
+	memset(&sisis_replies.msgs[i], 0, sizeof(struct mmsghdr));
+	if (!client->connected)
+	{
+		sisis_replies.msgs[i].msg_hdr.msg_name = &sisis_replies.addrs[i];
+		sisis_replies.msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+	sisis_replies.msgs[i].msg_hdr.msg_iov = &sisis_replies.iov[i];
+	sisis_replies.msgs[i].msg_hdr.msg_iovlen = 1;
+}
+
+#ifdef USE_IPV6
+/**
+ * Checks that a client may use an address.  Clients on the Unix socket may
+ * only use addresses carrying their own pid, as reported by the kernel.
+ * UDP clients cannot be identified and are trusted.
+ */
+static int sisis_client_owns(struct sisis_client * client, struct in6_addr * addr)
+{
+	if (!client->connected)
+		return 1;
+	
+	return sisis_addr_get_pid(addr) == ((u_int32_t)client->cred.pid & ((1 << SISIS_ADDR_BITS_pid) - 1));
+}
+
+static int sisis_notify_writable(struct thread * thread);
+
+/* Sends a subscription's pending changes.  Returns -1 if they must wait. */
+static int sisis_subscription_send(struct sisis_subscription * sub)
+{
+	struct sisis_client * client = sub->client;
+	if (client->sock < 0)
+		return -1;
+	
+	sisis_construct_message(sub->buf, SISIS_MESSAGE_VERSION, sub->id, SISIS_NOTIFY_ADDRESSES, NULL, 0);
+	*(unsigned short *)(sub->buf+8) = htons(sub->lost ? SISIS_NOTIFY_FLAG_LOST : 0);
+	*(unsigned short *)(sub->buf+10) = htons(sub->count);
+	if (send(client->sock, sub->buf, SISIS_NOTIFY_HEADER_SIZE + sub->count * SISIS_NOTIFY_ENTRY_SIZE, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ENOBUFS)
+		{
+			// Try again once the client has read some
+			if (client->t_write == NULL)
+				client->t_write = thread_add_write (sisis_info->master, sisis_notify_writable, client, client->sock);
+			return -1;
+		}
+		
+		// The reader will see the connection close
+		zlog_warn ("sisis_subscription_send: pid %d: %s", (int)client->cred.pid, safe_strerror(errno));
+	}
+	sub->count = 0;
+	sub->lost = 0;
+	return 0;
+}
+
+/* Sends every subscription's pending changes. */
+static int sisis_notify_flush(struct thread * thread)
+{
+	struct sisis_subscription * sub;
+	sisis_info->t_notify = NULL;
+	for (sub = sisis_info->subscriptions; sub != NULL; sub = sub->next)
+		if ((sub->count || sub->lost) && sub->client->t_write == NULL)
+			sisis_subscription_send(sub);
+	return 0;
+}
+
+/* A client with notifications waiting can take more. */
+static int sisis_notify_writable(struct thread * thread)
+{
+	struct sisis_client * client = THREAD_ARG(thread);
+	client->t_write = NULL;
+	if (sisis_info->t_notify == NULL)
+		sisis_info->t_notify = thread_add_event (sisis_info->master, sisis_notify_flush, NULL, 0);
+	return 0;
+}
+
+/* Adds a change to a subscription's next notification. */
+static void sisis_subscription_append(struct sisis_subscription * sub, struct in6_addr * addr, int kind)
+{
+	// Make room, or remember that the client fell behind
+	if (sub->count == SISIS_MAX_NOTIFY_ENTRIES && (sub->client->t_write != NULL || sisis_subscription_send(sub) != 0))
+	{
+		sub->lost = 1;
+		return;
+	}
+	
+	char * entry = sub->buf + SISIS_NOTIFY_HEADER_SIZE + sub->count++ * SISIS_NOTIFY_ENTRY_SIZE;
+	entry[0] = kind;
+	memcpy(entry+1, addr, sizeof(struct in6_addr));
+	if (sisis_info->t_notify == NULL)
+		sisis_info->t_notify = thread_add_event (sisis_info->master, sisis_notify_flush, NULL, 0);
+}
+
+/* Tells subscribers about an address added or removed. */
+void sisis_notify(struct in6_addr * addr, int kind)
+{
+	struct sisis_subscription * sub;
+	struct prefix_ipv6 p;
+	p.family = AF_INET6;
+	p.prefixlen = IPV6_MAX_BITLEN;
+	p.prefix = *addr;
+	for (sub = sisis_info->subscriptions; sub != NULL; sub = sub->next)
+		if (prefix_match((struct prefix *)&sub->p, (struct prefix *)&p))
+			sisis_subscription_append(sub, addr, kind);
+}
+
+/* Tells every subscriber that changes were missed. */
+void sisis_notify_lost(void)
+{
+	struct sisis_subscription * sub;
+	for (sub = sisis_info->subscriptions; sub != NULL; sub = sub->next)
+		sub->lost = 1;
+	if (sisis_info->subscriptions && sisis_info->t_notify == NULL)
+		sisis_info->t_notify = thread_add_event (sisis_info->master, sisis_notify_flush, NULL, 0);
+}
+
+/* Adds an address already registered to a new subscription. */
+static void sisis_subscription_dump(struct in6_addr * addr, void * arg)
+{
+	sisis_subscription_append(arg, addr, SISIS_NOTIFY_ADDED);
+}
+
+/**
+ * Subscribes a Unix socket client to changes under a prefix.  Addresses
+ * already registered are sent as added right after the ACK.
+ */
+static void sisis_subscribe(struct sisis_client * client, unsigned int request_id, char * msg, int msg_len)
+{
+	struct sisis_subscription * sub;
+	struct prefix_ipv6 p;
+	
+	// Only connections can be sent notifications
+	if (!client->connected || client->subscriptions >= SISIS_CLIENT_MAX_SUBSCRIPTIONS || msg_len < 8 + SISIS_SUBSCRIBE_SIZE || ntohs(*(unsigned short *)(msg+12)) != AF_INET6 || ntohs(*(unsigned short *)(msg+14)) > IPV6_MAX_BITLEN)
+	{
+		sisis_reply(client, request_id, SISIS_NACK, NULL, 0);
+		return;
+	}
+	
+	memset(&p, 0, sizeof(p));
+	p.family = AF_INET6;
+	p.prefixlen = ntohs(*(unsigned short *)(msg+14));
+	memcpy(&p.prefix, msg+16, sizeof(struct in6_addr));
+	apply_mask_ipv6(&p);
+	
+	sub = XCALLOC (MTYPE_SISIS_SUBSCRIPTION, sizeof(struct sisis_subscription));
+	sub->client = client;
+	sub->id = ntohl(*(u_int32_t *)(msg+8));
+	sub->p = p;
+	sub->next = sisis_info->subscriptions;
+	sisis_info->subscriptions = sub;
+	client->subscriptions++;
+	
+	// The ACK goes out before any notification
+	sisis_reply(client, request_id, SISIS_ACK, NULL, 0);
+	sisis_flush_replies();
+	if (sisis_registry_walk(&p, sisis_subscription_dump, sub) != 0)
+		sub->lost = 1;
+}
+
+/* Drops one subscription, or all of a client's if all is set. */
+static int sisis_unsubscribe_matching(struct sisis_client * client, u_int32_t id, int all)
+{
+	struct sisis_subscription ** prev = &sisis_info->subscriptions, * sub;
+	int found = 0;
+	while ((sub = *prev) != NULL)
+	{
+		if (sub->client == client && (all || sub->id == id))
+		{
+			*prev = sub->next;
+			client->subscriptions--;
+			XFREE (MTYPE_SISIS_SUBSCRIPTION, sub);
+			found = 1;
+		}
+		else
+			prev = &sub->next;
+	}
+	return found;
+}
+
+/* Ends a subscription. */
+static void sisis_unsubscribe(struct sisis_client * client, unsigned int request_id, char * msg, int msg_len)
+{
+	int found = (msg_len >= 12 && sisis_unsubscribe_matching(client, ntohl(*(u_int32_t *)(msg+8)), 0));
+	sisis_reply(client, request_id, found ? SISIS_ACK : SISIS_NACK, NULL, 0);
+}
+#endif /* USE_IPV6 */
+
 // Similar function in sisis_api.c
-void sisis_process_message(char * msg, int msg_len, int sock, struct sockaddr * from, socklen_t from_len)
+void sisis_process_message(char * msg, int msg_len, struct sisis_client * client)
 {
 	// Get message version
 	unsigned short version = 0;
@@ -146,15 +501,18 @@ void sisis_process_message(char * msg, int msg_len, int sock, struct sockaddr *
 						short len = ntohs(*(unsigned short *)(msg+10));
 						char ip_addr[64];
 						memset(ip_addr, 0, 64);
-						if (len >= 64 || msg_len > msg-12)
+						if (len >= 64 || msg_len < 12 + len)
 							printf("Invalid IP address length: %hd\n", len);
 						else
 						{
 							memcpy(ip_addr, msg+12, len);
 							printf("\tIP Address: %s\n", ip_addr);
 							
-							// Set expiration
-							time_t expires = time(NULL) + SISIS_ADDRESS_TIMEOUT;
+							// Lifetime in milliseconds follows the address
+							u_int32_t ttl = 0;
+							if (msg_len >= 12 + len + 4)
+								ttl = ntohl(*(u_int32_t *)(msg+12+len));
+							ttl = sisis_address_ttl(ttl);
 							
 							// Get loopback ifindex
 							int ifindex = if_nametoindex("lo");
@@ -162,35 +520,48 @@ void sisis_process_message(char * msg, int msg_len, int sock, struct sockaddr *
 							// Set up prefix
 							if (inet_pton(p.family, ip_addr, &p.u.prefix) != 1)
 							{
-								// Construct reply
-								char * buf;
-								int buf_len = sisis_construct_message(&buf, SISIS_MESSAGE_VERSION, request_id, SISIS_NACK, NULL, 0);
-								sendto(sock, buf, buf_len, 0, from, from_len);
-								free(buf);
+								sisis_reply(client, request_id, SISIS_NACK, NULL, 0);
 								
 								zlog_err ("sisis_process_message: Invalid SIS-IS address: %s", ip_addr);
 								return;
 							}
+							if (p.family == AF_INET6 && !sisis_client_owns(client, &p.u.prefix6))
+							{
+								sisis_reply(client, request_id, SISIS_NACK, NULL, 0);
+								
+								zlog_warn ("sisis_process_message: pid %d may not use %s", (int)client->cred.pid, ip_addr);
+								return;
+							}
+							
+							// New addresses may be refused or held back, and an unregister may cancel a held one
+							int verdict = SISIS_ADMIT_FORWARD;
+							if (p.family == AF_INET6)
+								verdict = (command == SISIS_CMD_REGISTER_ADDRESS) ? sisis_admission_register(&p.u.prefix6, ttl) : sisis_admission_unregister(&p.u.prefix6);
+							if (verdict != SISIS_ADMIT_FORWARD)
+							{
+								sisis_reply(client, request_id, (verdict == SISIS_ADMIT_REFUSED) ? SISIS_NACK : SISIS_ACK, NULL, 0);
+								return;
+							}
 							
 							int zcmd = (command == SISIS_CMD_REGISTER_ADDRESS) ? ZEBRA_INTERFACE_ADDRESS_ADD : ZEBRA_INTERFACE_ADDRESS_DELETE;
-							int status = zapi_interface_address(zcmd, zclient, &p, ifindex, &expires);
+							int status = zapi_interface_address(zcmd, zclient, &p, ifindex, &ttl);
+							if (p.family == AF_INET6 && command == SISIS_CMD_REGISTER_ADDRESS)
+								sisis_admission_forwarded(&p.u.prefix6, ttl, status == 0);
 							
-							// Construct reply
-							char * buf;
-							int buf_len = sisis_construct_message(&buf, SISIS_MESSAGE_VERSION, request_id, (status == 0) ? SISIS_ACK : SISIS_NACK, NULL, 0);
+							// Reply
 							printf("\tSending %s\n", (status == 0) ? "ACK" : "NACK");
-							sendto(sock, buf, buf_len, 0, from, from_len);
-							free(buf);
+							sisis_reply(client, request_id, (status == 0) ? SISIS_ACK : SISIS_NACK, NULL, 0);
 						}
 					}
 #else /* IPv6 Version */
 					char ip_addr[INET_ADDRSTRLEN+1];
 					memset(ip_addr, 0, INET_ADDRSTRLEN+1);
-					memcpy(ip_addr, msg+8, from_len-8);
+					if (msg_len > 8 && msg_len - 8 <= INET_ADDRSTRLEN)
+						memcpy(ip_addr, msg+8, msg_len-8);
 					printf("\tIP Address: %s\n", ip_addr);
 					
 					// Set expiration
-					time_t expires = time(NULL) + SISIS_ADDRESS_TIMEOUT;
+					u_int32_t ttl = SISIS_ADDRESS_TTL_DEFAULT;
 					
 					// Get loopback ifindex
 					int ifindex = if_nametoindex("lo");
@@ -201,48 +572,124 @@ void sisis_process_message(char * msg, int msg_len, int sock, struct sockaddr *
 					p.prefixlen = 32;
 					if (inet_pton(AF_INET, ip_addr, &p.prefix.s_addr) != 1)
 					{
-						// Construct reply
-						char * buf;
-						int buf_len = sisis_construct_message(&buf, SISIS_MESSAGE_VERSION, request_id, SISIS_NACK, NULL, 0);
-						sendto(sock, buf, buf_len, 0, from, from_len);
-						free(buf);
+						sisis_reply(client, request_id, SISIS_NACK, NULL, 0);
 						
 						zlog_err ("sisis_process_message: Invalid SIS-IS address: %s", ip_addr);
 						return;
 					}
 					
 					int zcmd = (command == SISIS_CMD_REGISTER_ADDRESS) ? ZEBRA_INTERFACE_ADDRESS_ADD : ZEBRA_INTERFACE_ADDRESS_DELETE;
-					int status = zapi_interface_address(zcmd, zclient, &p, ifindex, &expires);
+					int status = zapi_interface_address(zcmd, zclient, &p, ifindex, &ttl);
 					
-					// Construct reply
-					char * buf;
-					int buf_len = sisis_construct_message(&buf, SISIS_MESSAGE_VERSION, request_id, (status == 0) ? SISIS_ACK : SISIS_NACK, NULL, 0);
+					// Reply
 					printf("\tSending %s\n", (status == 0) ? "ACK" : "NACK");
-					sendto(sock, buf, buf_len, 0, from, from_len);
-					free(buf);
+					sisis_reply(client, request_id, (status == 0) ? SISIS_ACK : SISIS_NACK, NULL, 0);
 #endif /* USE_IPV6 */
 				}
 				break;
+#ifdef USE_IPV6
+			case SISIS_CMD_REGISTER_ADDRESSES:
+			case SISIS_CMD_UNREGISTER_ADDRESSES:
+				{
+					unsigned short count = 0;
+					if (msg_len >= 10)
+						count = ntohs(*(unsigned short *)(msg+8));
+					if (count == 0 || count > SISIS_MAX_BATCH_ADDRESSES || msg_len < 10 + count * SISIS_BATCH_ADDRESS_SIZE)
+					{
+						sisis_reply(client, request_id, SISIS_NACK, NULL, 0);
+						
+						zlog_err ("sisis_process_message: Invalid batch of %u addresses", count);
+						return;
+					}
+					
+					// Get loopback ifindex
+					int ifindex = if_nametoindex("lo");
+					
+					// Reply is the count followed by a bitmap of accepted addresses
+					char reply[2 + (SISIS_MAX_BATCH_ADDRESSES + 7) / 8];
+					memset(reply, 0, sizeof(reply));
+					*(unsigned short *)reply = htons(count);
+					unsigned char * bitmap = (unsigned char *)reply + 2;
+					
+					// Collect the valid addresses
+					struct prefix p[SISIS_MAX_BATCH_ADDRESSES];
+					u_int32_t ttls[SISIS_MAX_BATCH_ADDRESSES];
+					int idx[SISIS_MAX_BATCH_ADDRESSES];
+					int i, num_valid = 0;
+					for (i = 0; i < count; i++)
+					{
+						char * entry = msg + 10 + i * SISIS_BATCH_ADDRESS_SIZE;
+						if (ntohs(*(unsigned short *)entry) != AF_INET6)
+							continue;
+						memset(&p[num_valid], 0, sizeof(struct prefix));
+						p[num_valid].family = AF_INET6;
+						p[num_valid].prefixlen = 128;
+						memcpy(&p[num_valid].u.prefix6, entry+2, sizeof(struct in6_addr));
+						if (!sisis_client_owns(client, &p[num_valid].u.prefix6))
+							continue;
+						ttls[num_valid] = (command == SISIS_CMD_REGISTER_ADDRESSES) ? sisis_address_ttl(ntohl(*(u_int32_t *)(entry+18))) : 0;
+						
+						// New addresses may be refused or held back, and an unregister may cancel a held one
+						int verdict = (command == SISIS_CMD_REGISTER_ADDRESSES) ? sisis_admission_register(&p[num_valid].u.prefix6, ttls[num_valid]) : sisis_admission_unregister(&p[num_valid].u.prefix6);
+						if (verdict == SISIS_ADMIT_REFUSED)
+							continue;
+						if (verdict != SISIS_ADMIT_FORWARD)
+						{
+							bitmap[i / 8] |= 1 << (i % 8);
+							continue;
+						}
+						idx[num_valid++] = i;
+					}
+					
+					// Send to zebra in as few messages as possible
+					int zcmd = (command == SISIS_CMD_REGISTER_ADDRESSES) ? ZEBRA_INTERFACE_ADDRESS_ADD_BATCH : ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH;
+					int start;
+					for (start = 0; start < num_valid; start += ZAPI_ADDRESS_BATCH_MAX)
+					{
+						int n = num_valid - start;
+						if (n > ZAPI_ADDRESS_BATCH_MAX)
+							n = ZAPI_ADDRESS_BATCH_MAX;
+						int ok = (zapi_interface_address_batch(zcmd, zclient, &p[start], &ttls[start], n, ifindex) == 0);
+						for (i = start; i < start + n; i++)
+						{
+							if (ok)
+								bitmap[idx[i] / 8] |= 1 << (idx[i] % 8);
+							if (command == SISIS_CMD_REGISTER_ADDRESSES)
+								sisis_admission_forwarded(&p[i].u.prefix6, ttls[i], ok);
+						}
+					}
+					
+					// Reply
+					sisis_reply(client, request_id, SISIS_ACK, reply, 2 + (count + 7) / 8);
+				}
+				break;
+			case SISIS_CMD_SUBSCRIBE:
+				sisis_subscribe(client, request_id, msg, msg_len);
+				break;
+			case SISIS_CMD_UNSUBSCRIBE:
+				sisis_unsubscribe(client, request_id, msg, msg_len);
+				break;
+#endif /* USE_IPV6 */
 		}
 	}
 }
 
 /**
- * Constructs SIS-IS message.  Remember to free memory when done.
+ * Constructs SIS-IS message in buf, which must hold data_len + 8 bytes.
  * Duplicated in sisis_api.c
  * Returns length of message.
  */
-int sisis_construct_message(char ** buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len)
+int sisis_construct_message(char * buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len)
 {
 	unsigned int buf_len = data_len + 8;
-	*buf = malloc(sizeof(char) * buf_len);
 	version = htons(version);
 	request_id = htonl(request_id);
 	cmd = htons(cmd);
-	memcpy(*buf, &version, 2);
-	memcpy(*buf+2, &request_id, 4);
-	memcpy(*buf+6, &cmd, 2);
-	memcpy(*buf+8, data, data_len);
+	memcpy(buf, &version, 2);
+	memcpy(buf+2, &request_id, 4);
+	memcpy(buf+6, &cmd, 2);
+	if (data_len)
+		memcpy(buf+8, data, data_len);
 	return buf_len;
 }
 
@@ -254,7 +701,173 @@ struct sisis_listener
   struct thread *thread;
 };
 
-/* Receive a message */
+/* Gets a request buffer, reusing a freed one if possible. */
+static struct sisis_request * sisis_request_new(void)
+{
+	struct sisis_request * req = sisis_info->free_requests;
+	if (req == NULL)
+		return XMALLOC (MTYPE_SISIS_REQUEST, sizeof(struct sisis_request));
+	sisis_info->free_requests = req->next;
+	sisis_info->num_free_requests--;
+	return req;
+}
+
+/* Frees a request buffer, keeping it for reuse while the pool is small. */
+static void sisis_request_free(struct sisis_request * req)
+{
+	if (sisis_info->num_free_requests >= SISIS_REQUEST_POOL_MAX)
+	{
+		XFREE (MTYPE_SISIS_REQUEST, req);
+		return;
+	}
+	req->next = sisis_info->free_requests;
+	sisis_info->free_requests = req;
+	sisis_info->num_free_requests++;
+}
+
+/* Gets a zeroed client record, reusing a freed one if possible. */
+static struct sisis_client * sisis_client_new(void)
+{
+	struct sisis_client * client = sisis_info->free_clients;
+	if (client == NULL)
+		return XCALLOC (MTYPE_SISIS_CLIENT, sizeof(struct sisis_client));
+	sisis_info->free_clients = client->next;
+	sisis_info->num_free_clients--;
+	memset(client, 0, sizeof(struct sisis_client));
+	return client;
+}
+
+static unsigned int sisis_client_hash(struct sockaddr_in * addr)
+{
+	return (ntohl(addr->sin_addr.s_addr) ^ ntohs(addr->sin_port)) % SISIS_CLIENT_HASH_SIZE;
+}
+
+/* Finds the client for an address, creating it if needed. */
+static struct sisis_client * sisis_client_get(struct sockaddr_in * addr, int sock)
+{
+	unsigned int hash = sisis_client_hash(addr);
+	struct sisis_client * client;
+	for (client = sisis_info->clients[hash]; client != NULL; client = client->next)
+		if (client->addr.sin_addr.s_addr == addr->sin_addr.s_addr && client->addr.sin_port == addr->sin_port && client->sock == sock)
+			return client;
+	
+	client = sisis_client_new();
+	client->addr = *addr;
+	client->sock = sock;
+	client->next = sisis_info->clients[hash];
+	sisis_info->clients[hash] = client;
+	return client;
+}
+
+/* Frees a client once it has nothing queued.  Unix socket clients are
+ * only freed once they have also disconnected. */
+static void sisis_client_free(struct sisis_client * client)
+{
+	if (client->connected)
+	{
+		if (client->sock >= 0)
+			return;
+	}
+	else
+	{
+		struct sisis_client ** prev = &sisis_info->clients[sisis_client_hash(&client->addr)];
+		while (*prev != client)
+			prev = &(*prev)->next;
+		*prev = client->next;
+	}
+	
+	// UDP clients come and go with each burst of requests
+	if (sisis_info->num_free_clients >= SISIS_CLIENT_POOL_MAX)
+	{
+		XFREE (MTYPE_SISIS_CLIENT, client);
+		return;
+	}
+	client->next = sisis_info->free_clients;
+	sisis_info->free_clients = client;
+	sisis_info->num_free_clients++;
+}
+
+/* Adds a client to the end of the round robin. */
+static void sisis_client_activate(struct sisis_client * client)
+{
+	client->active_next = NULL;
+	if (sisis_info->active_tail)
+		sisis_info->active_tail->active_next = client;
+	else
+		sisis_info->active_head = client;
+	sisis_info->active_tail = client;
+}
+
+/* Processes queued requests, one per client in turn, so a busy client
+ * cannot hold up the others.  Stops while zebra is not keeping up. */
+static int sisis_process_queues(struct thread * thread)
+{
+	int processed = 0;
+	sisis_info->t_process = NULL;
+	while (sisis_info->active_head && processed < SISIS_PROCESS_QUANTUM)
+	{
+		if (zclient->sock >= 0 && !buffer_empty(zclient->wb))
+		{
+			sisis_flush_replies();
+			sisis_info->t_process = thread_add_timer_msec (sisis_info->master, sisis_process_queues, NULL, SISIS_ZEBRA_BACKOFF_MSEC);
+			return 0;
+		}
+		
+		// Take next client
+		struct sisis_client * client = sisis_info->active_head;
+		sisis_info->active_head = client->active_next;
+		if (sisis_info->active_head == NULL)
+			sisis_info->active_tail = NULL;
+		
+		// Take its oldest request
+		struct sisis_request * req = client->head;
+		client->head = req->next;
+		if (client->head == NULL)
+			client->tail = NULL;
+		client->queued--;
+		
+		sisis_process_message(req->msg, req->len, client);
+		sisis_request_free(req);
+		processed++;
+		
+		if (client->head)
+			sisis_client_activate(client);
+		else
+			sisis_client_free(client);
+	}
+	sisis_flush_replies();
+	
+	// Let the reader run before continuing
+	if (sisis_info->active_head)
+		sisis_info->t_process = thread_add_event (sisis_info->master, sisis_process_queues, NULL, 0);
+	return 0;
+}
+
+/* Queues a request for its client. */
+static void sisis_request_enqueue(struct sisis_client * client, struct sisis_request * req)
+{
+	if (client->queued >= SISIS_CLIENT_QUEUE_MAX)
+	{
+		// Refuse rather than let one client grow without bound
+		if (req->len >= 6)
+			sisis_reply(client, ntohl(*(unsigned int *)(req->msg+2)), SISIS_NACK, NULL, 0);
+		sisis_request_free(req);
+		if (client->head == NULL)
+			sisis_client_free(client);
+		return;
+	}
+	
+	req->next = NULL;
+	if (client->tail)
+		client->tail->next = req;
+	else
+		client->head = req;
+	client->tail = req;
+	if (client->queued++ == 0)
+		sisis_client_activate(client);
+}
+
+/* Receive messages */
 static int sisis_recvfrom(struct thread *thread)
 {
 	int sisis_sock;
@@ -270,26 +883,141 @@ static int sisis_recvfrom(struct thread *thread)
 	// Add thread again
 	listener->thread = thread_add_read (sisis_info->master, sisis_recvfrom, listener, sisis_sock);
 	
-	// Get message
-	struct sockaddr from;
-	memset (&from, 0, sizeof (struct sockaddr));
-	char buf[1024];
-	memset (buf, 0, 1024);
-	int recv_len;
-	unsigned int from_len = sizeof from;
-	recv_len = recvfrom(sisis_sock, buf, 1024, 0, &from, &from_len);
-	if (recv_len < 0)
+	// Drain the socket, a bounded number of messages at a time
+	static struct sisis_request * reqs[SISIS_RECV_BATCH];
+	struct mmsghdr msgs[SISIS_RECV_BATCH];
+	struct iovec iov[SISIS_RECV_BATCH];
+	struct sockaddr_in from[SISIS_RECV_BATCH];
+	int i, num, total = 0;
+	do
 	{
-		zlog_err ("Receive length is negative value %d.  Error #%d: %s", recv_len, errno, safe_strerror(errno));
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < SISIS_RECV_BATCH; i++)
+		{
+			if (reqs[i] == NULL)
+				reqs[i] = sisis_request_new();
+			iov[i].iov_base = reqs[i]->msg;
+			iov[i].iov_len = SISIS_RECV_BUFSIZ;
+			msgs[i].msg_hdr.msg_name = &from[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		num = recvmmsg(sisis_sock, msgs, SISIS_RECV_BATCH, MSG_DONTWAIT, NULL);
+		if (num < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				zlog_err ("sisis_recvfrom: recvmmsg error: %s", safe_strerror(errno));
+			break;
+		}
+		
+		// Queue each request.  Its buffer is replaced on the next pass.
+		for (i = 0; i < num; i++)
+		{
+			reqs[i]->len = msgs[i].msg_len;
+			sisis_request_enqueue(sisis_client_get(&from[i], sisis_sock), reqs[i]);
+			reqs[i] = NULL;
+		}
+		total += num;
+	} while (num == SISIS_RECV_BATCH && total < SISIS_RECV_MAX_PER_READ);
+	
+	// Refusals are sent right away
+	sisis_flush_replies();
+	
+	if (sisis_info->active_head && sisis_info->t_process == NULL)
+		sisis_info->t_process = thread_add_event (sisis_info->master, sisis_process_queues, NULL, 0);
+	return 0;
+}
+
+/* Closes a Unix socket connection.  Requests already queued are still
+ * processed, without replies. */
+static void sisis_unix_close(struct sisis_client * client)
+{
+	// Replies may still be waiting for this socket
+	sisis_flush_replies();
+	
+	THREAD_READ_OFF (client->t_read);
+	THREAD_WRITE_OFF (client->t_write);
+#ifdef USE_IPV6
+	sisis_unsubscribe_matching(client, 0, 1);
+#endif /* USE_IPV6 */
+	close (client->sock);
+	client->sock = -1;
+	if (client->head == NULL)
+		sisis_client_free(client);
+}
+
+/* Receive messages from a Unix socket connection */
+static int sisis_unix_read(struct thread *thread)
+{
+	struct sisis_client * client = THREAD_ARG(thread);
+	int sock = THREAD_FD(thread);
+	client->t_read = NULL;
+	
+	// Each read returns one whole request
+	int num;
+	for (num = 0; num < SISIS_RECV_BATCH; num++)
+	{
+		struct sisis_request * req = sisis_request_new();
+		int len = recv(sock, req->msg, SISIS_RECV_BUFSIZ, MSG_DONTWAIT);
+		if (len > 0)
+		{
+			req->len = len;
+			sisis_request_enqueue(client, req);
+			continue;
+		}
+		sisis_request_free(req);
+		if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			break;
+		
+		// Client went away
+		if (len < 0)
+			zlog_warn ("sisis_unix_read: pid %d: %s", (int)client->cred.pid, safe_strerror(errno));
+		sisis_unix_close(client);
+		return 0;
+	}
+	client->t_read = thread_add_read (sisis_info->master, sisis_unix_read, client, sock);
+	
+	// Refusals are sent right away
+	sisis_flush_replies();
+	
+	if (sisis_info->active_head && sisis_info->t_process == NULL)
+		sisis_info->t_process = thread_add_event (sisis_info->master, sisis_process_queues, NULL, 0);
+	return 0;
+}
+
+/* Accept a connection on the Unix socket */
+static int sisis_unix_accept(struct thread *thread)
+{
+	struct sisis_listener *listener = THREAD_ARG(thread);
+	int accept_sock = THREAD_FD(thread);
+	int sock;
+	struct ucred cred;
+	socklen_t cred_len = sizeof(cred);
+	
+	listener->thread = thread_add_read (sisis_info->master, sisis_unix_accept, listener, accept_sock);
+	
+	sock = accept (accept_sock, NULL, NULL);
+	if (sock < 0)
+	{
+		zlog_warn ("sisis_unix_accept: accept: %s", safe_strerror (errno));
 		return -1;
 	}
 	
-	char fromStr[256];
-	inet_ntop(from.sa_family, &(from.sa_data), fromStr, sizeof fromStr);
-	//printf("Message from %s[%d]: %s\n", fromStr, recv_len, buf);
+	// The kernel vouches for the peer, unlike anything in its messages
+	if (getsockopt (sock, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0)
+	{
+		zlog_warn ("sisis_unix_accept: SO_PEERCRED: %s", safe_strerror (errno));
+		close (sock);
+		return -1;
+	}
 	
-	// Process message
-	sisis_process_message(buf, recv_len, sisis_sock, &from, recv_len);
+	struct sisis_client * client = sisis_client_new();
+	client->sock = sock;
+	client->connected = 1;
+	client->cred = cred;
+	client->t_read = thread_add_read (sisis_info->master, sisis_unix_read, client, sock);
+	return 0;
 }
 
 // Create SIS-IS listener from existing socket
@@ -381,4 +1109,57 @@ int sisis_socket (unsigned short port, const char *address)
 	}
 	
   return sock;
-}
\ No newline at end of file
+}
+
+// Open SIS-IS Unix socket
+int sisis_unix_socket (const char *path)
+{
+  int sock, len;
+  struct sockaddr_un serv;
+  mode_t old_mask;
+  struct sisis_listener *listener;
+
+  if (strlen (path) >= sizeof (serv.sun_path))
+	{
+		zlog_err ("sisis_unix_socket: path too long: %s", path);
+		return -1;
+	}
+
+	// Remove a socket left behind by an earlier run
+  unlink (path);
+
+  sock = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+  if (sock < 0)
+	{
+		zlog_err ("socket: %s", safe_strerror (errno));
+		return sock;
+	}
+
+  memset (&serv, 0, sizeof (struct sockaddr_un));
+  serv.sun_family = AF_UNIX;
+  strncpy (serv.sun_path, path, sizeof (serv.sun_path) - 1);
+#ifdef HAVE_STRUCT_SOCKADDR_UN_SUN_LEN
+  len = serv.sun_len = SUN_LEN(&serv);
+#else
+  len = sizeof (serv.sun_family) + strlen (serv.sun_path);
+#endif /* HAVE_STRUCT_SOCKADDR_UN_SUN_LEN */
+
+	// Any local process may connect; addresses are checked against its pid
+  old_mask = umask (0111);
+  if (bind (sock, (struct sockaddr *) &serv, len) < 0 || listen (sock, SISIS_UNIX_BACKLOG) < 0)
+	{
+		zlog_err ("sisis_unix_socket: %s: %s", path, safe_strerror (errno));
+		umask (old_mask);
+		close (sock);
+		return -1;
+	}
+  umask (old_mask);
+
+	// Create listener
+  listener = XCALLOC (MTYPE_SISIS_LISTENER, sizeof(*listener));
+  listener->fd = sock;
+  listener->thread = thread_add_read (sisis_info->master, sisis_unix_accept, listener, sock);
+  listnode_add (sisis_info->listen_sockets, listener);
+
+  return sock;
+}
@@ -29,6 +29,11 @@
 #define SISIS_PORT_DEFAULT 54345
 #define SISIS_ADDRESS_TIMEOUT 30
 
+// Address lifetime in milliseconds when the client does not give one, and
+// the shortest lifetime allowed.
+#define SISIS_ADDRESS_TTL_DEFAULT (SISIS_ADDRESS_TIMEOUT * 1000)
+#define SISIS_ADDRESS_TTL_MIN 250
+
 /* Default configuration settings for sisisd.  */
 #define SISIS_DEFAULT_CONFIG             "sisisd.conf"
 
@@ -37,6 +42,112 @@
 #define SISIS_CMD_UNREGISTER_ADDRESS			2
 #define SISIS_ACK							            3
 #define SISIS_NACK							     			4
+#define SISIS_CMD_REGISTER_ADDRESSES			5
+#define SISIS_CMD_UNREGISTER_ADDRESSES		6
+#define SISIS_CMD_SUBSCRIBE							7
+#define SISIS_CMD_UNSUBSCRIBE						8
+#define SISIS_NOTIFY_ADDRESSES					9
+
+// Batch message layout.  Duplicated in sisis_api.h
+#define SISIS_BATCH_ADDRESS_SIZE				22
+#define SISIS_MAX_BATCH_ADDRESSES				45
+
+// Subscription layout.  Duplicated in sisis_api.h
+#define SISIS_SUBSCRIBE_SIZE						24
+#define SISIS_NOTIFY_HEADER_SIZE				12
+#define SISIS_NOTIFY_ENTRY_SIZE					17
+#define SISIS_MAX_NOTIFY_ENTRIES				59
+#define SISIS_NOTIFY_REMOVED						0
+#define SISIS_NOTIFY_ADDED							1
+#define SISIS_NOTIFY_FLAG_LOST					(1 << 0)
+
+// Subscriptions one Unix socket client may hold
+#define SISIS_CLIENT_MAX_SUBSCRIPTIONS	64
+
+// Admission control of new addresses.  Rates are addresses per second; a
+// zero rate means no limit.  See sisis_admission.c
+#define SISIS_PTYPE_BUCKET_HASH_SIZE		64
+#define SISIS_ADMISSION_SWEEP_INTERVAL	10
+#define SISIS_ADMIT_FORWARD							0		// Send to zebra now
+#define SISIS_ADMIT_HELD								1		// Accepted, sent once the coalesce window passes
+#define SISIS_ADMIT_REFUSED							2		// Over a rate limit
+#define SISIS_ADMIT_COALESCED						3		// Unregistered while held, never sent
+
+// Requests are read, and replies sent, up to SISIS_RECV_BATCH at a time
+#define SISIS_RECV_BATCH 32
+#define SISIS_RECV_BUFSIZ 1024
+#define SISIS_RECV_MAX_PER_READ 256
+#define SISIS_REPLY_BUFSIZ (8 + 2 + (SISIS_MAX_BATCH_ADDRESSES + 7) / 8)
+
+// Requests waiting for one client before new ones are refused, and the
+// number handed to zebra before other events get a turn
+#define SISIS_CLIENT_QUEUE_MAX 128
+#define SISIS_PROCESS_QUANTUM 64
+
+// Delay before trying again while zebra is not reading its socket
+#define SISIS_ZEBRA_BACKOFF_MSEC 10
+
+#define SISIS_CLIENT_HASH_SIZE 64
+
+// Request buffers and client records kept for reuse rather than freed
+#define SISIS_REQUEST_POOL_MAX 256
+#define SISIS_CLIENT_POOL_MAX 64
+
+// Pending connections on the Unix socket
+#define SISIS_UNIX_BACKLOG 16
+
+/* Request waiting to be processed.  */
+struct sisis_request
+{
+  struct sisis_request *next;
+  int len;
+  char msg[SISIS_RECV_BUFSIZ];
+};
+
+/* Client with queued requests, identified by its address, or a
+   connection on the Unix socket.  */
+struct sisis_client
+{
+  /* Hash chain */
+  struct sisis_client *next;
+
+  /* Round robin of clients with requests */
+  struct sisis_client *active_next;
+
+  struct sockaddr_in addr;
+  int sock;
+
+  /* Unix socket connection, its peer and its reader.  The socket is
+     closed (-1) once the peer goes away. */
+  int connected;
+  struct ucred cred;
+  struct thread *t_read;
+
+  /* Subscriptions, and a writer while notifications wait for room */
+  int subscriptions;
+  struct thread *t_write;
+
+  /* Request queue */
+  struct sisis_request *head;
+  struct sisis_request *tail;
+  int queued;
+};
+
+/* Unix socket client's interest in changes under a prefix.  Changes
+   collect in buf until sent as one notification.  */
+struct sisis_subscription
+{
+  struct sisis_subscription *next;
+  struct sisis_client *client;
+  u_int32_t id;
+  struct prefix_ipv6 p;
+
+  /* Changes were dropped since the last notification */
+  int lost;
+
+  int count;
+  char buf[SISIS_NOTIFY_HEADER_SIZE + SISIS_MAX_NOTIFY_ENTRIES * SISIS_NOTIFY_ENTRY_SIZE];
+};
 
 struct sisis_info
 { 
@@ -49,6 +160,24 @@ struct sisis_info
   
   /* Listening sockets */
   struct list *listen_sockets;
+
+  /* Clients by address, and those with queued requests in turn order */
+  struct sisis_client *clients[SISIS_CLIENT_HASH_SIZE];
+  struct sisis_client *active_head;
+  struct sisis_client *active_tail;
+
+  /* Request processing */
+  struct thread *t_process;
+
+  /* Freed request buffers and client records, for reuse */
+  struct sisis_request *free_requests;
+  int num_free_requests;
+  struct sisis_client *free_clients;
+  int num_free_clients;
+
+  /* Subscriptions, and their pending notifications */
+  struct sisis_subscription *subscriptions;
+  struct thread *t_notify;
   
   /* SIS-IS port number.  */
   u_int16_t port;
@@ -56,6 +185,17 @@ struct sisis_info
   /* Listener address */
   char *address;
 
+  /* Unix socket path, if clients may connect locally */
+  char *unix_path;
+
+  /* Limits on new addresses, host-wide and per process type, and how long
+     new addresses are held in case they are unregistered */
+  u_int32_t host_rate;
+  u_int32_t host_burst;
+  u_int32_t ptype_rate;
+  u_int32_t ptype_burst;
+  u_int32_t coalesce_msec;
+
   /* SIS-IS start time.  */
   time_t start_time;
 };
@@ -64,7 +204,7 @@ struct sisis_info
 struct sisis_addr
 {
   struct prefix p;
-  time_t expires;
+  u_int32_t ttl;
 };
 
 extern struct sisis_info * sisis_info;
@@ -74,9 +214,9 @@ time_t sisis_clock (void);
 void sisis_master_init (void);
 void sisis_terminate (void);
 
-// Duplicated in sisis_api.c
-int sisis_construct_message(char ** buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len);
-void sisis_process_message(char * msg, int msg_len, int sock, struct sockaddr * from, socklen_t from_len);
+// Similar to sisis_api.c
+int sisis_construct_message(char * buf, unsigned short version, unsigned int request_id, unsigned short cmd, void * data, unsigned int data_len);
+void sisis_process_message(char * msg, int msg_len, struct sisis_client * client);
 
 int sisis_rib_add_ipv4 (int type, int flags, struct prefix_ipv4 *p, 
 	      struct in_addr *gate, struct in_addr *src,
@@ -87,5 +227,26 @@ int sisis_rib_add_ipv6 (int type, int flags, struct prefix_ipv6 *p,
 	      u_int32_t metric, u_char distance);
 
 extern int sisis_socket (unsigned short, const char *);
+extern int sisis_unix_socket (const char *);
+
+/* Shared memory registry of SIS-IS addresses, see lib/sisis_registry.h */
+extern int sisis_registry_init (void);
+extern void sisis_registry_clear (void);
+extern void sisis_registry_set_live (void);
+extern void sisis_registry_heartbeat (void);
+extern void sisis_registry_finish (void);
+extern int sisis_registry_add (struct in6_addr *);
+extern int sisis_registry_delete (struct in6_addr *);
+extern void sisis_notify (struct in6_addr *, int);
+extern void sisis_notify_lost (void);
+extern int sisis_registry_walk (struct prefix_ipv6 *,
+                                void (*) (struct in6_addr *, void *), void *);
+
+
+/* Admission control of new addresses, see sisis_admission.c */
+extern void sisis_admission_init (void);
+extern int sisis_admission_register (struct in6_addr *, u_int32_t);
+extern void sisis_admission_forwarded (struct in6_addr *, u_int32_t, int);
+extern int sisis_admission_unregister (struct in6_addr *);
 
 #endif /* SISISD_H */
\ No newline at end of file
@@ -64,6 +64,7 @@ connected_withdraw (struct connected *ifc)
   if (!CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
     {
       listnode_delete (ifc->ifp->connected, ifc);
+      if_addr_expiry_remove (ifc);
       connected_free (ifc);
     }
 }
@@ -165,11 +166,12 @@ connected_implicit_withdraw (struct interface *ifp, struct connected *ifc)
       
       UNSET_FLAG(current->conf, ZEBRA_IFC_CONFIGURED);
 
+      // HSA - need to copy over address expiration info if we are to explicitly withdraw a route
       if(CHECK_FLAG (current->flags, ZEBRA_IFA_EXPIRES))
       {
-        SET_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES);
+        if_addr_expiry_add (ifc, current->expires);
+        if_addr_expiry_remove (current);
       }
-      ifc->expires = current->expires; // HSA - need to copy over address expiration info if we are to explicitly withdraw a route
 
       connected_withdraw (current); /* implicit withdraw - freebsd does this */
     }
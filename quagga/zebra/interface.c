@@ -33,11 +33,13 @@
 #include "connected.h"
 #include "log.h"
 #include "zclient.h"
+#include "pqueue.h"
 
 #include "zebra/interface.h"
 #include "zebra/rtadv.h"
 #include "zebra/rib.h"
 #include "zebra/zserv.h"
+#include "zebra/rt.h"
 #include "zebra/redistribute.h"
 #include "zebra/debug.h"
 #include "zebra/irdp.h"
@@ -103,6 +105,12 @@ static int
 if_zebra_delete_hook (struct interface *ifp)
 {
   struct zebra_if *zebra_if;
+  struct listnode *node;
+  struct connected *ifc;
+
+  /* The connected list is about to be freed. */
+  for (ALL_LIST_ELEMENTS_RO (ifp->connected, node, ifc))
+    if_addr_expiry_remove (ifc);
   
   if (ifp->info)
     {
@@ -453,6 +461,7 @@ if_delete_update (struct interface *ifp)
 		  if (!CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
 		    {
 		      listnode_delete (ifp->connected, ifc);
+		      if_addr_expiry_remove (ifc);
 		      connected_free (ifc);
                     }
                   else
@@ -478,6 +487,7 @@ if_delete_update (struct interface *ifp)
 	      else
 		{
 		  listnode_delete (ifp->connected, ifc);
+		  if_addr_expiry_remove (ifc);
 		  connected_free (ifc);
 		}
 	    }
@@ -1155,14 +1165,16 @@ ALIAS (no_bandwidth_if,
        "Set bandwidth informational parameter\n"
        "Bandwidth in kilobits\n")
 
+static int ip_address_install_prefix (struct vty *, struct interface *,
+				      struct prefix_ipv4 *, const char *,
+				      u_int64_t);
+
 int
 ip_address_install (struct vty *vty, struct interface *ifp,
 		    const char *addr_str, const char *peer_str,
-		    const char *label, time_t * expires)
+		    const char *label, u_int32_t * ttl)
 {
   struct prefix_ipv4 cp;
-  struct connected *ifc;
-  struct prefix_ipv4 *p;
   int ret;
 
   ret = str2prefix_ipv4 (addr_str, &cp);
@@ -1173,7 +1185,22 @@ ip_address_install (struct vty *vty, struct interface *ifp,
       return CMD_WARNING;
     }
 
-  ifc = connected_check (ifp, (struct prefix *) &cp);
+  return ip_address_install_prefix (vty, ifp, &cp, label,
+				    ttl ? if_addr_clock_ms () + *ttl : 0);
+}
+
+/* Install an IPv4 address given as a prefix.  expires is a deadline from
+   if_addr_clock_ms(), or 0 if the address does not expire. */
+static int
+ip_address_install_prefix (struct vty *vty, struct interface *ifp,
+			   struct prefix_ipv4 *cp, const char *label,
+			   u_int64_t expires)
+{
+  struct connected *ifc;
+  struct prefix_ipv4 *p;
+  int ret;
+
+  ifc = connected_check (ifp, (struct prefix *) cp);
   if (! ifc)
     {
       ifc = connected_new ();
@@ -1181,14 +1208,14 @@ ip_address_install (struct vty *vty, struct interface *ifp,
 
       /* Address. */
       p = prefix_ipv4_new ();
-      *p = cp;
+      *p = *cp;
       ifc->address = (struct prefix *) p;
 
       /* Broadcast. */
       if (p->prefixlen <= IPV4_MAX_PREFIXLEN-2)
 	{
 	  p = prefix_ipv4_new ();
-	  *p = cp;
+	  *p = *cp;
 	  p->prefix.s_addr = ipv4_broadcast_addr(p->prefix.s_addr,p->prefixlen);
 	  ifc->destination = (struct prefix *) p;
 	}
@@ -1202,11 +1229,8 @@ ip_address_install (struct vty *vty, struct interface *ifp,
     }
 		
 		// Check if this route expires
-		if (expires != NULL)
-		{
-			SET_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES);
-			ifc->expires = *expires;
-		}
+		if (expires)
+			if_addr_expiry_add (ifc, expires);
 
   /* This address is configured from zebra. */
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
@@ -1223,6 +1247,12 @@ ip_address_install (struct vty *vty, struct interface *ifp,
 	  if_refresh (ifp);
 	}
 
+      /* Requests from clients are batched; the CLI waits for the result. */
+#ifdef HAVE_NETLINK
+      if (! vty)
+	ret = kernel_address_queue_add (ifp, ifc);
+      else
+#endif /* HAVE_NETLINK */
       ret = if_set_prefix (ifp, ifc);
       if (ret < 0)
 	{
@@ -1249,6 +1279,9 @@ ip_address_install (struct vty *vty, struct interface *ifp,
   return CMD_SUCCESS;
 }
 
+static int ip_address_uninstall_connected (struct vty *, struct interface *,
+					   struct connected *);
+
 int
 ip_address_uninstall (struct vty *vty, struct interface *ifp,
 		      const char *addr_str, const char *peer_str,
@@ -1276,6 +1309,16 @@ ip_address_uninstall (struct vty *vty, struct interface *ifp,
       return CMD_WARNING;
     }
 
+  return ip_address_uninstall_connected (vty, ifp, ifc);
+}
+
+/* Remove a configured IPv4 address that has already been looked up. */
+static int
+ip_address_uninstall_connected (struct vty *vty, struct interface *ifp,
+				struct connected *ifc)
+{
+  int ret;
+
   /* This is not configured address. */
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
     return CMD_WARNING;
@@ -1287,11 +1330,17 @@ ip_address_uninstall (struct vty *vty, struct interface *ifp,
       || ! CHECK_FLAG (ifp->status, ZEBRA_INTERFACE_ACTIVE))
     {
       listnode_delete (ifp->connected, ifc);
+      if_addr_expiry_remove (ifc);
       connected_free (ifc);
       return CMD_WARNING;
     }
 
   /* This is real route. */
+#ifdef HAVE_NETLINK
+  if (! vty)
+    ret = kernel_address_queue_delete (ifp, ifc);
+  else
+#endif /* HAVE_NETLINK */
   ret = if_unset_prefix (ifp, ifc);
   if (ret < 0)
     {
@@ -1313,6 +1362,7 @@ ip_address_uninstall (struct vty *vty, struct interface *ifp,
 
   /* Free address information. */
   listnode_delete (ifp->connected, ifc);
+  if_addr_expiry_remove (ifc);
   connected_free (ifc);
 
 // HSA END
@@ -1369,14 +1419,16 @@ DEFUN (no_ip_address_label,
 #endif /* HAVE_NETLINK */
 
 #ifdef HAVE_IPV6
+static int ipv6_address_install_prefix (struct vty *, struct interface *,
+					struct prefix_ipv6 *, const char *,
+					int, u_int64_t);
+
 int
 ipv6_address_install (struct vty *vty, struct interface *ifp,
 		      const char *addr_str, const char *peer_str,
-		      const char *label, int secondary, time_t * expires)
+		      const char *label, int secondary, u_int32_t * ttl)
 {
   struct prefix_ipv6 cp;
-  struct connected *ifc;
-  struct prefix_ipv6 *p;
   int ret;
 
   ret = str2prefix_ipv6 (addr_str, &cp);
@@ -1387,7 +1439,22 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
       return CMD_WARNING;
     }
 
-  ifc = connected_check (ifp, (struct prefix *) &cp);
+  return ipv6_address_install_prefix (vty, ifp, &cp, label, secondary,
+				      ttl ? if_addr_clock_ms () + *ttl : 0);
+}
+
+/* Install an IPv6 address given as a prefix.  expires is a deadline from
+   if_addr_clock_ms(), or 0 if the address does not expire. */
+static int
+ipv6_address_install_prefix (struct vty *vty, struct interface *ifp,
+			     struct prefix_ipv6 *cp, const char *label,
+			     int secondary, u_int64_t expires)
+{
+  struct connected *ifc;
+  struct prefix_ipv6 *p;
+  int ret;
+
+  ifc = connected_check (ifp, (struct prefix *) cp);
 
   if (! ifc)
     {
@@ -1396,7 +1463,7 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
 
       /* Address. */
       p = prefix_ipv6_new ();
-      *p = cp;
+      *p = *cp;
       ifc->address = (struct prefix *) p;
 
       /* Secondary. */
@@ -1412,12 +1479,8 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
     }
 
   // Check if this route expires
-  if (expires != NULL)
-  {
-    
-    SET_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES);
-    ifc->expires = *expires;
-  }
+  if (expires)
+    if_addr_expiry_add (ifc, expires);
 
   /* This address is configured from zebra. */
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
@@ -1434,6 +1497,12 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
 	  if_refresh (ifp);
 	}
 
+      /* Requests from clients are batched; the CLI waits for the result. */
+#ifdef HAVE_NETLINK
+      if (! vty)
+	ret = kernel_address_queue_add (ifp, ifc);
+      else
+#endif /* HAVE_NETLINK */
       ret = if_prefix_add_ipv6 (ifp, ifc);
 
       if (ret < 0)
@@ -1460,7 +1529,7 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
 			//netlink_del_reject_route(AF_INET6, &p->prefix, p->prefixlen, lo_index);
 			struct interface * lo_ifp = if_lookup_by_name("lo");
 			if (lo_ifp != NULL && ifp == lo_ifp)
-				netlink_del_reject_route(AF_INET6, &p->prefix, 128, lo_ifp->ifindex);
+				netlink_del_reject_route(AF_INET6, &cp->prefix, 128, lo_ifp->ifindex);
     }
 		
   struct listnode *node, *node2, *node3;
@@ -1469,6 +1538,9 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
   return CMD_SUCCESS;
 }
 
+static int ipv6_address_uninstall_connected (struct vty *, struct interface *,
+					     struct connected *);
+
 int
 ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
 			const char *addr_str, const char *peer_str,
@@ -1496,6 +1568,16 @@ ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
       return CMD_WARNING;
     }
 
+  return ipv6_address_uninstall_connected (vty, ifp, ifc);
+}
+
+/* Remove a configured IPv6 address that has already been looked up. */
+static int
+ipv6_address_uninstall_connected (struct vty *vty, struct interface *ifp,
+				  struct connected *ifc)
+{
+  int ret;
+
   /* This is not configured address. */
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
     return CMD_WARNING;
@@ -1505,11 +1587,17 @@ ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
       || ! CHECK_FLAG (ifp->status, ZEBRA_INTERFACE_ACTIVE))
     {
       listnode_delete (ifp->connected, ifc);
+      if_addr_expiry_remove (ifc);
       connected_free (ifc);
       return CMD_WARNING;
     }
 
   /* This is real route. */
+#ifdef HAVE_NETLINK
+  if (! vty)
+    ret = kernel_address_queue_delete (ifp, ifc);
+  else
+#endif /* HAVE_NETLINK */
   ret = if_prefix_delete_ipv6 (ifp, ifc);
   if (ret < 0)
     {
@@ -1527,6 +1615,7 @@ ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
 
   /* Free address information. */
   listnode_delete (ifp->connected, ifc);
+  if_addr_expiry_remove (ifc);
   connected_free (ifc);
 
   return CMD_SUCCESS;
@@ -1626,42 +1715,174 @@ if_config_write (struct vty *vty)
   return 0;
 }
 
+/* Addresses with a lifetime, ordered by deadline.  Only the earliest
+   deadline has a timer. */
+static struct pqueue *if_addr_expiry_queue;
 struct thread * zebra_if_addr_expire_thread = NULL;
+static int if_addr_expiry_running = 0;
+
+/* Monotonic clock in milliseconds used for address expiration. */
+u_int64_t
+if_addr_clock_ms (void)
+{
+  struct timeval tv;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &tv);
+  return (u_int64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static int
+if_addr_expiry_cmp (void *a, void *b)
+{
+  struct connected *ca = a;
+  struct connected *cb = b;
+
+  if (ca->expires < cb->expires)
+    return -1;
+  return ca->expires > cb->expires;
+}
 
-/* Check for interface IP addresses that have expired. */
+static void
+if_addr_expiry_update (void *node, int pos)
+{
+  ((struct connected *) node)->expires_pos = pos + 1;
+}
+
+/* Arm the timer for the earliest deadline. */
+static void
+if_addr_expiry_schedule (void)
+{
+  struct connected *ifc;
+  u_int64_t now;
+
+  if (if_addr_expiry_running)
+    return;
+
+  THREAD_TIMER_OFF (zebra_if_addr_expire_thread);
+  if (if_addr_expiry_queue->size == 0)
+    return;
+
+  ifc = if_addr_expiry_queue->array[0];
+  now = if_addr_clock_ms ();
+  zebra_if_addr_expire_thread =
+    thread_add_timer_msec (zebrad.master, if_addr_expired_checker, NULL,
+			   ifc->expires > now ? ifc->expires - now : 0);
+}
+
+/* Set the deadline of an address and queue it for expiration, or move it
+   if it is already queued. */
+void
+if_addr_expiry_add (struct connected *ifc, u_int64_t expires)
+{
+  void *top = if_addr_expiry_queue->size ? if_addr_expiry_queue->array[0] : NULL;
+
+  SET_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES);
+  ifc->expires = expires;
+  if (ifc->expires_pos)
+    {
+      trickle_up (ifc->expires_pos - 1, if_addr_expiry_queue);
+      trickle_down (ifc->expires_pos - 1, if_addr_expiry_queue);
+    }
+  else
+    pqueue_enqueue (ifc, if_addr_expiry_queue);
+
+  if (if_addr_expiry_queue->array[0] != top || top == ifc)
+    if_addr_expiry_schedule ();
+}
+
+/* Take an address out of the expiry queue.  Must be called before the
+   connected structure is freed. */
+void
+if_addr_expiry_remove (struct connected *ifc)
+{
+  int pos = ifc->expires_pos - 1;
+
+  if (! ifc->expires_pos)
+    return;
+
+  ifc->expires_pos = 0;
+  pqueue_remove_at (pos, if_addr_expiry_queue);
+  if (pos == 0)
+    if_addr_expiry_schedule ();
+}
+
+/* Remove interface IP addresses that have expired. */
 int if_addr_expired_checker(struct thread* th)
 {
-  struct listnode *node, *node2, *node3;
-  struct interface *ifp;
-	struct connected *ifc;
+  struct connected *ifc;
+  u_int64_t now = if_addr_clock_ms ();
 
-  struct tm * exp_tm;
-  struct tm * lcl_tm;
-  time_t now;
-  char buf[80];
-	
-  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
-  {
-		for (ALL_LIST_ELEMENTS (ifp->connected, node2, node3, ifc))
-		{
-			// Check if it expired
-			if (CHECK_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES) && ifc->expires < time(NULL))
-			{
-				char buf[256];
-				prefix2str(ifc->address, buf, sizeof(buf));
-				zlog_debug ("Address %s expired from interface %s.", buf, ifp->name);
-				if (ifc->address->family == AF_INET)
-					ip_address_uninstall (NULL, ifp, buf, NULL, NULL);
-				else if (ifc->address->family == AF_INET6)
-					ipv6_address_uninstall (NULL, ifp, buf, NULL, NULL, 0);
-			}
-		}
+  zebra_if_addr_expire_thread = NULL;
+  if_addr_expiry_running = 1;
+  while (if_addr_expiry_queue->size > 0)
+    {
+      ifc = if_addr_expiry_queue->array[0];
+      if (ifc->expires > now)
+	break;
+
+      if (IS_ZEBRA_DEBUG_EVENT)
+	{
+	  char buf[256];
+	  prefix2str (ifc->address, buf, sizeof (buf));
+	  zlog_debug ("Address %s expired from interface %s.", buf, ifc->ifp->name);
 	}
-	
-	// Reschedule thread.
-	zebra_if_addr_expire_thread = thread_add_timer(zebrad.master, if_addr_expired_checker, NULL, ZEBRA_IF_ADDR_EXPIRATION_THREAD_TIMEOUT);
-	
-	return 0;
+      if (ifc->address->family == AF_INET)
+	ip_address_uninstall_connected (NULL, ifc->ifp, ifc);
+#ifdef HAVE_IPV6
+      else if (ifc->address->family == AF_INET6)
+	ipv6_address_uninstall_connected (NULL, ifc->ifp, ifc);
+#endif /* HAVE_IPV6 */
+
+      /* Still queued if it could not be removed.  Stop expiring it rather
+         than retrying forever. */
+      if (if_addr_expiry_queue->size > 0
+	  && if_addr_expiry_queue->array[0] == ifc)
+	{
+	  if_addr_expiry_remove (ifc);
+	  UNSET_FLAG (ifc->flags, ZEBRA_IFA_EXPIRES);
+	}
+    }
+  if_addr_expiry_running = 0;
+
+  if_addr_expiry_schedule ();
+  return 0;
+}
+
+/* Add an address to an interface without going through the CLI string
+   parser.  expires is a deadline from if_addr_clock_ms(), or 0 if the
+   address does not expire.  Refreshes the deadline if the address is
+   already configured. */
+int
+zebra_address_add (struct interface *ifp, struct prefix *p, u_int64_t expires)
+{
+  if (p->family == AF_INET)
+    return ip_address_install_prefix (NULL, ifp, (struct prefix_ipv4 *) p,
+				      NULL, expires);
+#ifdef HAVE_IPV6
+  if (p->family == AF_INET6)
+    return ipv6_address_install_prefix (NULL, ifp, (struct prefix_ipv6 *) p,
+					NULL, 0, expires);
+#endif /* HAVE_IPV6 */
+  return CMD_WARNING;
+}
+
+/* Remove an address added with zebra_address_add(). */
+int
+zebra_address_delete (struct interface *ifp, struct prefix *p)
+{
+  struct connected *ifc;
+
+  ifc = connected_check (ifp, p);
+  if (! ifc)
+    return CMD_WARNING;
+
+  if (p->family == AF_INET)
+    return ip_address_uninstall_connected (NULL, ifp, ifc);
+#ifdef HAVE_IPV6
+  if (p->family == AF_INET6)
+    return ipv6_address_uninstall_connected (NULL, ifp, ifc);
+#endif /* HAVE_IPV6 */
+  return CMD_WARNING;
 }
 
 /* Remove SIS-IS addresses from loopback*/
@@ -1739,6 +1960,8 @@ zebra_if_init (void)
   install_element (INTERFACE_NODE, &no_ip_address_label_cmd);
 #endif /* HAVE_NETLINK */
 
-	// Set up thread to expire interface IP addresses
-	zebra_if_addr_expire_thread = thread_add_timer(zebrad.master, if_addr_expired_checker, NULL, ZEBRA_IF_ADDR_EXPIRATION_THREAD_TIMEOUT);
+	// Set up queue to expire interface IP addresses
+	if_addr_expiry_queue = pqueue_create ();
+	if_addr_expiry_queue->cmp = if_addr_expiry_cmp;
+	if_addr_expiry_queue->update = if_addr_expiry_update;
 }
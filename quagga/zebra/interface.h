@@ -225,6 +225,9 @@ extern int if_subnet_add (struct interface *, struct connected *);
 extern int if_subnet_delete (struct interface *, struct connected *);
 
 extern int if_addr_expired_checker(struct thread* th);
+extern u_int64_t if_addr_clock_ms (void);
+extern void if_addr_expiry_add (struct connected *, u_int64_t);
+extern void if_addr_expiry_remove (struct connected *);
 extern void if_weed_sisis();
 
 #ifdef HAVE_PROC_NET_DEV
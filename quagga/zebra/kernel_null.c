@@ -39,5 +39,9 @@ int kernel_address_delete_ipv4 (struct interface *a, struct connected *b)
   return 0;
 }
 
+int kernel_address_queue_add (struct interface *a, struct connected *b)
+{ return 0; }
+#pragma weak kernel_address_queue_delete = kernel_address_queue_add
+
 void kernel_init (void) { return; }
 #pragma weak route_read = kernel_init
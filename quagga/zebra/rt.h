@@ -32,6 +32,8 @@ extern int kernel_delete_ipv4 (struct prefix *, struct rib *);
 extern int kernel_add_route (struct prefix_ipv4 *, struct in_addr *, int, int);
 extern int kernel_address_add_ipv4 (struct interface *, struct connected *);
 extern int kernel_address_delete_ipv4 (struct interface *, struct connected *);
+extern int kernel_address_queue_add (struct interface *, struct connected *);
+extern int kernel_address_queue_delete (struct interface *, struct connected *);
 
 #ifdef HAVE_IPV6
 extern int kernel_add_ipv6 (struct prefix *, struct rib *);
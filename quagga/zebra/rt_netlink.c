@@ -52,6 +52,31 @@ struct nlsock
 } netlink      = { -1, 0, {0}, "netlink-listen"},     /* kernel messages */
   netlink_cmd  = { -1, 0, {0}, "netlink-cmd"};        /* command channel */
 
+/* Requests queued on netlink_cmd and sent to the kernel together by
+   netlink_batch_flush (). */
+#define NL_BATCH_MAX_MSGS	64
+#define NL_BATCH_BUFSIZ		(NL_BATCH_MAX_MSGS * 128)
+#define NL_BATCH_FLUSH_MSEC	10
+
+struct nl_batch_entry
+{
+  int type;
+  unsigned int ifindex;
+  struct prefix p;
+};
+
+static struct
+{
+  char buf[NL_BATCH_BUFSIZ];
+  int len;
+  int count;
+  u_int32_t first_seq;
+  struct nl_batch_entry entries[NL_BATCH_MAX_MSGS];
+  struct thread *t_flush;
+} nl_batch;
+
+static int netlink_batch_flush (void);
+
 static const struct message nlmsg_str[] = {
   {RTM_NEWROUTE, "RTM_NEWROUTE"},
   {RTM_DELROUTE, "RTM_DELROUTE"},
@@ -231,6 +256,10 @@ netlink_request (int family, int type, struct nlsock *nl)
       return -1;
     }
 
+  /* Queued requests must be answered before the dump. */
+  if (nl == &netlink_cmd)
+    netlink_batch_flush ();
+
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
@@ -1180,6 +1209,11 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
   int save_errno;
 
+  /* Queued requests must be answered first so their ACKs are not
+     mistaken for ours. */
+  if (nl == &netlink_cmd)
+    netlink_batch_flush ();
+
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
@@ -1216,6 +1250,167 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   return netlink_parse_info (netlink_talk_filter, nl);
 }
 
+static int
+netlink_batch_timer (struct thread *thread)
+{
+  nl_batch.t_flush = NULL;
+  netlink_batch_flush ();
+  return 0;
+}
+
+/* Send every queued request on netlink_cmd with one sendmsg() and wait
+   for their ACKs.  Errors are matched back to the request by sequence
+   number. */
+static int
+netlink_batch_flush (void)
+{
+  int status;
+  int save_errno;
+  int count;
+  int pending;
+  int ret = 0;
+  struct sockaddr_nl snl;
+  struct iovec iov = { nl_batch.buf, nl_batch.len };
+  struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+
+  THREAD_TIMER_OFF (nl_batch.t_flush);
+  if (nl_batch.count == 0)
+    return 0;
+
+  memset (&snl, 0, sizeof snl);
+  snl.nl_family = AF_NETLINK;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("netlink_batch_flush: %s %d messages, seq=%u-%u",
+		netlink_cmd.name, nl_batch.count, nl_batch.first_seq,
+		nl_batch.first_seq + nl_batch.count - 1);
+
+  if (zserv_privs.change (ZPRIVS_RAISE))
+    zlog (NULL, LOG_ERR, "Can't raise privileges");
+  status = sendmsg (netlink_cmd.sock, &msg, 0);
+  save_errno = errno;
+  if (zserv_privs.change (ZPRIVS_LOWER))
+    zlog (NULL, LOG_ERR, "Can't lower privileges");
+
+  count = pending = nl_batch.count;
+  nl_batch.count = 0;
+  nl_batch.len = 0;
+
+  if (status < 0)
+    {
+      zlog (NULL, LOG_ERR, "netlink_batch_flush sendmsg() error: %s",
+	    safe_strerror (save_errno));
+      return -1;
+    }
+
+  /* Every request asked for an ACK, so expect one reply each. */
+  while (pending > 0)
+    {
+      char buf[4096];
+      struct iovec riov = { buf, sizeof buf };
+      struct msghdr rmsg = { (void *) &snl, sizeof snl, &riov, 1, NULL, 0, 0 };
+      struct nlmsghdr *h;
+
+      status = recvmsg (netlink_cmd.sock, &rmsg, 0);
+      if (status < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  zlog (NULL, LOG_ERR, "%s recvmsg error: %s", netlink_cmd.name,
+		safe_strerror (errno));
+	  return -1;
+	}
+      if (status == 0)
+	{
+	  zlog (NULL, LOG_ERR, "%s EOF", netlink_cmd.name);
+	  return -1;
+	}
+
+      for (h = (struct nlmsghdr *) buf; NLMSG_OK (h, (unsigned int) status);
+	   h = NLMSG_NEXT (h, status))
+	{
+	  struct nlmsgerr *err;
+	  struct nl_batch_entry *entry;
+	  u_int32_t i;
+	  char pbuf[INET6_BUFSIZ];
+
+	  if (h->nlmsg_type != NLMSG_ERROR)
+	    continue;
+
+	  err = (struct nlmsgerr *) NLMSG_DATA (h);
+	  i = err->msg.nlmsg_seq - nl_batch.first_seq;
+	  if (i >= (u_int32_t) count)
+	    continue;
+	  pending--;
+	  if (err->error == 0)
+	    continue;
+
+	  entry = &nl_batch.entries[i];
+	  prefix2str (&entry->p, pbuf, sizeof pbuf);
+
+	  /* Already in the state we asked for. */
+	  if ((entry->type == RTM_NEWADDR && -err->error == EEXIST)
+	      || (entry->type == RTM_DELADDR && -err->error == EADDRNOTAVAIL)
+	      || (entry->type == RTM_DELROUTE
+		  && (-err->error == ENODEV || -err->error == ESRCH)))
+	    {
+	      if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug ("%s: %s %s on %s: %s, seq=%u", netlink_cmd.name,
+			    lookup (nlmsg_str, entry->type), pbuf,
+			    ifindex2ifname (entry->ifindex),
+			    safe_strerror (-err->error), err->msg.nlmsg_seq);
+	      continue;
+	    }
+
+	  zlog_err ("%s error: %s %s on %s: %s, seq=%u", netlink_cmd.name,
+		    lookup (nlmsg_str, entry->type), pbuf,
+		    ifindex2ifname (entry->ifindex),
+		    safe_strerror (-err->error), err->msg.nlmsg_seq);
+	  ret = -1;
+	}
+    }
+  return ret;
+}
+
+/* Queue a request for netlink_batch_flush ().  The batch is sent once it
+   is full or NL_BATCH_FLUSH_MSEC after the first request.  ifindex and p
+   only identify the request in error messages.  Returns 0 once the request
+   is queued; errors from the kernel are only logged, since the flush
+   answers for the whole batch. */
+static int
+netlink_batch_add (struct nlmsghdr *n, unsigned int ifindex, struct prefix *p)
+{
+  struct nl_batch_entry *entry;
+  int len = NLMSG_ALIGN (n->nlmsg_len);
+
+  if (len > NL_BATCH_BUFSIZ)
+    return netlink_talk (n, &netlink_cmd);
+  if (nl_batch.len + len > NL_BATCH_BUFSIZ)
+    netlink_batch_flush ();
+
+  n->nlmsg_seq = ++netlink_cmd.seq;
+  n->nlmsg_flags |= NLM_F_ACK;
+  if (nl_batch.count == 0)
+    nl_batch.first_seq = n->nlmsg_seq;
+
+  memset (nl_batch.buf + nl_batch.len, 0, len);
+  memcpy (nl_batch.buf + nl_batch.len, n, n->nlmsg_len);
+  nl_batch.len += len;
+
+  entry = &nl_batch.entries[nl_batch.count++];
+  entry->type = n->nlmsg_type;
+  entry->ifindex = ifindex;
+  entry->p = *p;
+
+  if (nl_batch.count >= NL_BATCH_MAX_MSGS)
+    netlink_batch_flush ();
+  else if (! nl_batch.t_flush)
+    nl_batch.t_flush = thread_add_timer_msec (zebrad.master,
+					      netlink_batch_timer, NULL,
+					      NL_BATCH_FLUSH_MSEC);
+  return 0;
+}
+
 /* Routing table change via netlink interface. */
 static int
 netlink_route (int cmd, int family, void *dest, int length, void *gate,
@@ -1293,9 +1488,8 @@ netlink_route (int cmd, int family, void *dest, int length, void *gate,
 /* Routing table change via netlink interface. */
 int netlink_del_reject_route (int family, void *dest, int length, int index)
 {
-  int ret;
   int bytelen;
-  struct sockaddr_nl snl;
+  struct prefix p;
 
   struct
   {
@@ -1324,16 +1518,13 @@ int netlink_del_reject_route (int family, void *dest, int length, int index)
 	if (index > 0)
 		addattr32 (&req.n, sizeof req, RTA_OIF, index);
 
-  /* Destination netlink address. */
-  memset (&snl, 0, sizeof snl);
-  snl.nl_family = AF_NETLINK;
-	
-	/* Talk to netlink socket. */
-  ret = netlink_talk (&req.n, &netlink_cmd);
-	if (ret < 0)
-    return -1;
-
-  return 0;
+  /* Queue behind the address change that made the kernel add it. */
+  memset (&p, 0, sizeof p);
+  p.family = family;
+  p.prefixlen = length;
+  if (dest)
+    memcpy (&p.u.prefix, dest, bytelen);
+  return netlink_batch_add (&req.n, index, &p);
 }
 
 /* Routing table change via netlink interface. */
@@ -1798,56 +1989,82 @@ kernel_delete_ipv6_old (struct prefix_ipv6 *dest, struct in6_addr *gate,
 }
 #endif /* HAVE_IPV6 */
 
-/* Interface address modification. */
-static int
-netlink_address (int cmd, int family, struct interface *ifp,
-                 struct connected *ifc)
+/* Build an interface address modification request. */
+static void
+netlink_address_build (int cmd, int family, struct interface *ifp,
+		       struct connected *ifc, struct nlmsghdr *n, int maxlen)
 {
   int bytelen;
   struct prefix *p;
-
-  struct
-  {
-    struct nlmsghdr n;
-    struct ifaddrmsg ifa;
-    char buf[1024];
-  } req;
+  struct ifaddrmsg *ifa;
 
   p = ifc->address;
-  memset (&req, 0, sizeof req);
 
   bytelen = (family == AF_INET ? 4 : 16);
 
-  req.n.nlmsg_len = NLMSG_LENGTH (sizeof (struct ifaddrmsg));
-  req.n.nlmsg_flags = NLM_F_REQUEST;
-  req.n.nlmsg_type = cmd;
-  req.ifa.ifa_family = family;
+  n->nlmsg_len = NLMSG_LENGTH (sizeof (struct ifaddrmsg));
+  n->nlmsg_flags = NLM_F_REQUEST;
+  n->nlmsg_type = cmd;
 
-  req.ifa.ifa_index = ifp->ifindex;
-  req.ifa.ifa_prefixlen = p->prefixlen;
+  ifa = NLMSG_DATA (n);
+  ifa->ifa_family = family;
+  ifa->ifa_index = ifp->ifindex;
+  ifa->ifa_prefixlen = p->prefixlen;
 
-  addattr_l (&req.n, sizeof req, IFA_LOCAL, &p->u.prefix, bytelen);
+  addattr_l (n, maxlen, IFA_LOCAL, &p->u.prefix, bytelen);
 
   if (family == AF_INET && cmd == RTM_NEWADDR)
     {
       if (!CONNECTED_PEER(ifc) && ifc->destination)
         {
           p = ifc->destination;
-          addattr_l (&req.n, sizeof req, IFA_BROADCAST, &p->u.prefix,
-                     bytelen);
+          addattr_l (n, maxlen, IFA_BROADCAST, &p->u.prefix, bytelen);
         }
     }
 
   if (CHECK_FLAG (ifc->flags, ZEBRA_IFA_SECONDARY))
-    SET_FLAG (req.ifa.ifa_flags, IFA_F_SECONDARY);
+    SET_FLAG (ifa->ifa_flags, IFA_F_SECONDARY);
 
   if (ifc->label)
-    addattr_l (&req.n, sizeof req, IFA_LABEL, ifc->label,
-               strlen (ifc->label) + 1);
+    addattr_l (n, maxlen, IFA_LABEL, ifc->label, strlen (ifc->label) + 1);
+}
+
+/* Interface address modification. */
+static int
+netlink_address (int cmd, int family, struct interface *ifp,
+                 struct connected *ifc)
+{
+  struct
+  {
+    struct nlmsghdr n;
+    struct ifaddrmsg ifa;
+    char buf[1024];
+  } req;
+
+  memset (&req, 0, sizeof req);
+  netlink_address_build (cmd, family, ifp, ifc, &req.n, sizeof req);
 
   return netlink_talk (&req.n, &netlink_cmd);
 }
 
+/* Interface address modification through the request batch. */
+static int
+netlink_address_queue (int cmd, struct interface *ifp, struct connected *ifc)
+{
+  struct
+  {
+    struct nlmsghdr n;
+    struct ifaddrmsg ifa;
+    char buf[1024];
+  } req;
+
+  memset (&req, 0, sizeof req);
+  netlink_address_build (cmd, ifc->address->family, ifp, ifc, &req.n,
+			 sizeof req);
+
+  return netlink_batch_add (&req.n, ifp->ifindex, ifc->address);
+}
+
 int
 kernel_address_add_ipv4 (struct interface *ifp, struct connected *ifc)
 {
@@ -1860,6 +2077,20 @@ kernel_address_delete_ipv4 (struct interface *ifp, struct connected *ifc)
   return netlink_address (RTM_DELADDR, AF_INET, ifp, ifc);
 }
 
+/* Queue an address change of either family.  Returns 0 once the change is
+   queued; failures are only logged, once the batch is answered. */
+int
+kernel_address_queue_add (struct interface *ifp, struct connected *ifc)
+{
+  return netlink_address_queue (RTM_NEWADDR, ifp, ifc);
+}
+
+int
+kernel_address_queue_delete (struct interface *ifp, struct connected *ifc)
+{
+  return netlink_address_queue (RTM_DELADDR, ifp, ifc);
+}
+
 
 extern struct thread_master *master;
 
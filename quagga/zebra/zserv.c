@@ -39,6 +39,7 @@
 #include "buffer.h"
 
 #include "zebra/zserv.h"
+#include "zebra/interface.h"
 #include "zebra/router-id.h"
 #include "zebra/redistribute.h"
 #include "zebra/debug.h"
@@ -716,6 +717,18 @@ zread_interface_add (struct zserv *client, u_short length)
   return 0;
 }
 
+/*
+ * Add or remove one address on an interface for ZEBRA_INTERFACE_ADDRESS_ADD
+ * or ZEBRA_INTERFACE_ADDRESS_DELETE.
+ */
+static void zserv_interface_address_apply (int command, struct interface *ifp, struct prefix *p, u_int32_t * ttl)
+{
+	if (command == ZEBRA_INTERFACE_ADDRESS_ADD)
+		zebra_address_add (ifp, p, ttl ? if_addr_clock_ms () + *ttl : 0);
+	else if (command == ZEBRA_INTERFACE_ADDRESS_DELETE)
+		zebra_address_delete (ifp, p);
+}
+
 /* 
  * Parse the ZEBRA_INTERFACE_ADDRESS_ADD or ZEBRA_INTERFACE_ADDRESS_DELETE sent from client. Adds address to interface
  */
@@ -739,42 +752,64 @@ static int zread_interface_address_add_or_delete (int command, struct zserv *cli
 	stream_get (&p.u.prefix, s, plen);
 	p.prefixlen = stream_getc (s);
 	
-	char tmp_addrstr[INET6_ADDRSTRLEN];
-	char addr_str[INET6_ADDRSTRLEN+5];
-	inet_ntop (p.family, &p.u.prefix, tmp_addrstr, INET6_ADDRSTRLEN+5);
-	sprintf(addr_str, "%s/%d", tmp_addrstr, p.prefixlen);
+	// Check for lifetime in milliseconds
+	u_int32_t ttl, * ttl_ptr = NULL;
+	if (command == ZEBRA_INTERFACE_ADDRESS_ADD && STREAM_READABLE(s) == sizeof(ttl))
+	{
+		ttl = stream_getl (s);
+		ttl_ptr = &ttl;
+	}
 	
 	// Get interface
 	struct interface *ifp = if_lookup_by_index (ifindex);
 	if (ifp)
-	{
-		if (command == ZEBRA_INTERFACE_ADDRESS_ADD)
-		{
-			// Check for expiration date
-			time_t expires, * expires_ptr = NULL;
-			if (STREAM_READABLE(s) == sizeof(expires))
-			{
-				stream_get (&expires, s, sizeof(expires));
-				expires_ptr = &expires;
-			}
-			
-			if (p.family == AF_INET)
-				ip_address_install (NULL, ifp, addr_str, NULL, NULL, expires_ptr);
-			else if (p.family == AF_INET6)
-				ipv6_address_install(NULL, ifp, addr_str, NULL, NULL, 0, expires_ptr);
-		}
-		else if (command == ZEBRA_INTERFACE_ADDRESS_DELETE)
-		{
-			if (p.family == AF_INET)
-				ip_address_uninstall (NULL, ifp, addr_str, NULL, NULL);
-			else if (p.family == AF_INET6)
-				ipv6_address_uninstall (NULL, ifp, addr_str, NULL, NULL, 0);
-		}
-	}
+		zserv_interface_address_apply (command, ifp, &p, ttl_ptr);
 
   return 0;
 }
 
+/*
+ * Parse the ZEBRA_INTERFACE_ADDRESS_ADD_BATCH or
+ * ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH sent from client.  Adds or removes
+ * every address in the message.
+ */
+static int zread_interface_address_batch (int command, struct zserv *client, u_short length)
+{
+	unsigned int ifindex;
+	u_short count, i;
+	struct stream *s;
+	
+	/* Get input stream.  */
+	s = client->ibuf;
+	
+	/* Get interface index and number of addresses. */
+	ifindex = stream_getl (s);
+	count = stream_getw (s);
+	if (STREAM_READABLE(s) < (size_t)count * ZAPI_ADDRESS_BATCH_ENTRY_SIZE)
+	{
+		zlog_warn ("zread_interface_address_batch: truncated batch of %u addresses", count);
+		return -1;
+	}
+	
+	int single_command = (command == ZEBRA_INTERFACE_ADDRESS_ADD_BATCH) ? ZEBRA_INTERFACE_ADDRESS_ADD : ZEBRA_INTERFACE_ADDRESS_DELETE;
+	struct interface *ifp = if_lookup_by_index (ifindex);
+	for (i = 0; i < count; i++)
+	{
+		struct prefix p;
+		memset (&p, 0, sizeof(p));
+		p.family = stream_getc (s);
+		stream_get (&p.u.prefix, s, 16);
+		p.prefixlen = stream_getc (s);
+		u_int32_t ttl = stream_getl (s);
+		
+		// Lifetime of 0 means the address does not expire
+		if (ifp)
+			zserv_interface_address_apply (single_command, ifp, &p, (ttl && single_command == ZEBRA_INTERFACE_ADDRESS_ADD) ? &ttl : NULL);
+	}
+	
+	return 0;
+}
+
 /* Unregister zebra server interface information. */
 static int
 zread_interface_delete (struct zserv *client, u_short length)
@@ -1309,6 +1344,10 @@ zebra_client_read (struct thread *thread)
 		case ZEBRA_INTERFACE_ADDRESS_DELETE:
 			zread_interface_address_add_or_delete (command, client, length);
 			break;
+		case ZEBRA_INTERFACE_ADDRESS_ADD_BATCH:
+		case ZEBRA_INTERFACE_ADDRESS_DELETE_BATCH:
+			zread_interface_address_batch (command, client, length);
+			break;
     case ZEBRA_INTERFACE_DELETE:
       zread_interface_delete (client, length);
       break;
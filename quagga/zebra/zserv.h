@@ -100,10 +100,12 @@ extern void route_read (void);
 extern void zebra_route_map_init (void);
 extern void zebra_snmp_init (void);
 extern void zebra_vty_init (void);
-extern int ip_address_install (struct vty *, struct interface *, const char *, const char *, const char *, time_t * expires);
+extern int ip_address_install (struct vty *, struct interface *, const char *, const char *, const char *, u_int32_t * ttl);
 extern int ip_address_uninstall (struct vty *, struct interface *, const char *, const char *, const char *);
-extern int ipv6_address_install (struct vty *, struct interface *, const char *, const char *, const char *, int, time_t * expires);
+extern int ipv6_address_install (struct vty *, struct interface *, const char *, const char *, const char *, int, u_int32_t * ttl);
 extern int ipv6_address_uninstall (struct vty *, struct interface *, const char *, const char *, const char *, int);
+extern int zebra_address_add (struct interface *, struct prefix *, u_int64_t);
+extern int zebra_address_delete (struct interface *, struct prefix *);
 
 extern int zsend_interface_add (struct zserv *, struct interface *);
 extern int zsend_interface_delete (struct zserv *, struct interface *);
@@ -0,0 +1,194 @@
+/*
+ * SIS-IS message path benchmark.
+ *
+ * Sends unregister requests from several threads to a stand-in for sisisd
+ * on a Unix socket that ACKs everything, while the refresh engine keeps
+ * reregistering a set of addresses with a short lifetime.  Heap allocations
+ * are counted while the benchmark runs; the register/refresh/ACK path should
+ * not make any once warmed up.
+ *
+ * Usage: bench_messages [messages] [threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "sisis_api.h"
+
+#define BENCH_TARGET_RATE 100000
+#define BENCH_REFRESHED_ADDRS 4096
+#define BENCH_TTL_MS 1500
+
+// Counted allocations.  glibc lets the program replace malloc.
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+
+volatile int counting = 0;
+unsigned long allocations = 0;
+
+void * malloc(size_t size)
+{
+	if (counting)
+		__sync_fetch_and_add(&allocations, 1);
+	return __libc_malloc(size);
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+	if (counting)
+		__sync_fetch_and_add(&allocations, 1);
+	return __libc_calloc(nmemb, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+	if (counting)
+		__sync_fetch_and_add(&allocations, 1);
+	return __libc_realloc(ptr, size);
+}
+
+int listen_sock = -1;
+unsigned long refreshes = 0;
+int messages_per_thread = 0;
+
+/** Stand-in for sisisd.  ACKs every request, batches with every bit set. */
+void * listener(void * null)
+{
+	(void)null;
+	int sock = accept(listen_sock, NULL, NULL);
+	if (sock < 0)
+		return NULL;
+
+	char buf[SISIS_MAX_MESSAGE_SIZE], reply[SISIS_MAX_MESSAGE_SIZE];
+	int len;
+	while ((len = recv(sock, buf, sizeof(buf), 0)) > 0)
+	{
+		if (len < 8)
+			continue;
+		unsigned short cmd = ntohs(*(unsigned short *)(buf+6));
+		unsigned short ack = htons(SISIS_ACK);
+		memcpy(reply, buf, 6);
+		memcpy(reply+6, &ack, 2);
+		int reply_len = 8;
+		if ((cmd == SISIS_CMD_REGISTER_ADDRESSES || cmd == SISIS_CMD_UNREGISTER_ADDRESSES) && len >= 10)
+		{
+			unsigned short count = ntohs(*(unsigned short *)(buf+8));
+			if (cmd == SISIS_CMD_REGISTER_ADDRESSES)
+				__sync_fetch_and_add(&refreshes, count);
+			memcpy(reply+8, buf+8, 2);
+			memset(reply+10, 0xff, (count + 7) / 8);
+			reply_len += 2 + (count + 7) / 8;
+		}
+		send(sock, reply, reply_len, 0);
+	}
+	close(sock);
+	return NULL;
+}
+
+/** Sends unregister requests one at a time. */
+void * sender(void * arg)
+{
+	long id = (long)arg;
+	int i, failed = 0;
+	struct in6_addr addr;
+	unsigned char acked[1];
+	sisis_create_in6_addr(&addr, (uint64_t)1, (uint64_t)1, (uint64_t)id, (uint64_t)getpid(), (uint64_t)0);
+	for (i = 0; i < messages_per_thread; i++)
+		if (sisis_unregister_addrs(&addr, 1, acked) != 0)
+			failed++;
+	return (void *)(long)failed;
+}
+
+double elapsed(struct timespec * start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char ** argv)
+{
+	int messages = (argc > 1) ? atoi(argv[1]) : 1000000;
+	int num_threads = (argc > 2) ? atoi(argv[2]) : 8;
+	if (messages <= 0 || num_threads <= 0)
+	{
+		fprintf(stderr, "Usage: %s [messages] [threads]\n", argv[0]);
+		return 2;
+	}
+	messages_per_thread = messages / num_threads;
+
+	// Set up stand-in listener
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/bench_messages.%d", getpid());
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if ((listen_sock = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0 || bind(listen_sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listen_sock, 1) < 0)
+	{
+		perror("listener");
+		return 2;
+	}
+	pthread_t listener_thread;
+	pthread_create(&listener_thread, NULL, listener, NULL);
+	sisis_listener_unix_path = path;
+
+	// Addresses kept alive by the refresh engine
+	sisis_address_ttl = BENCH_TTL_MS;
+	struct in6_addr * addrs = malloc(sizeof(struct in6_addr) * BENCH_REFRESHED_ADDRS);
+	int i;
+	for (i = 0; i < BENCH_REFRESHED_ADDRS; i++)
+		sisis_create_in6_addr(&addrs[i], (uint64_t)2, (uint64_t)1, (uint64_t)1, (uint64_t)getpid(), (uint64_t)i);
+	if (sisis_register_addrs(addrs, BENCH_REFRESHED_ADDRS, NULL) != 0)
+	{
+		fprintf(stderr, "Failed to register addresses\n");
+		unlink(path);
+		return 2;
+	}
+
+	// Let the refresh engine size its buffers
+	sleep(BENCH_TTL_MS * 2 / 1000 + 1);
+
+	// Run
+	pthread_t * threads = malloc(sizeof(pthread_t) * num_threads);
+	unsigned long start_refreshes = refreshes;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	long t, failed = 0;
+	for (t = 0; t < num_threads; t++)
+		pthread_create(&threads[t], NULL, sender, (void *)t);
+
+	// Thread stacks are allocated outside malloc; count once they exist
+	counting = 1;
+	for (t = 0; t < num_threads; t++)
+	{
+		void * rtn;
+		pthread_join(threads[t], &rtn);
+		failed += (long)rtn;
+	}
+	counting = 0;
+	double secs = elapsed(&start);
+	unsigned long refreshed = refreshes - start_refreshes;
+	unlink(path);
+
+	int sent = messages_per_thread * num_threads;
+	double rate = sent / secs;
+	printf("%d messages from %d threads in %.3fs: %.0f messages/s (target %d)\n", sent, num_threads, secs, rate, BENCH_TARGET_RATE);
+	printf("%lu addresses refreshed meanwhile\n", refreshed);
+	printf("%lu heap allocations (%.4f per message), %ld failed\n", allocations, (double)allocations / sent, failed);
+
+	if (allocations != 0 || failed != 0)
+		return 1;
+	if (rate < BENCH_TARGET_RATE)
+		printf("Below target rate\n");
+	return 0;
+}
@@ -4,56 +4,131 @@
  * University of Delaware
  */
 
+/*
+ * Define SISIS_ADDR_FORMAT_CODEC_ONLY before including this to get only the
+ * address layout and accessors, without sisis_api.h.  sisisd does this since
+ * it has its own copies of the API definitions.
+ */
+#ifndef SISIS_ADDR_FORMAT_CODEC_ONLY
 #include "sisis_api.h"
+#endif /* SISIS_ADDR_FORMAT_CODEC_ONLY */
 
 #ifndef _SISIS_ADDR_FORMAT_H
 #define _SISIS_ADDR_FORMAT_H
 
+#include <stdint.h>
+#include <netinet/in.h>
+
+#ifndef SISIS_COMPONENT_FIXED
+#define SISIS_COMPONENT_FIXED					(1 << 0)
+#endif /* SISIS_COMPONENT_FIXED */
+
+/**
+ * SIS-IS address components in order from the most significant bit:
+ * X(name, bits, flags, fixed value).  Everything below is generated from
+ * this list.
+ */
+#define SISIS_ADDR_COMPONENTS(X) \
+	X(prefix,          16, SISIS_COMPONENT_FIXED, 0xfcff) \
+	X(sisis_version,    5, SISIS_COMPONENT_FIXED, 2) \
+	X(process_type,    16, 0,                     0) \
+	X(process_version,  5, 0,                     0) \
+	X(sys_id,          32, 0,                     0) \
+	X(pid,             22, 0,                     0) \
+	X(timestamp,       32, 0,                     0)
+
+#ifndef SISIS_ADDR_FORMAT_CODEC_ONLY
 // SIS-IS address component info
+#define SISIS_ADDR_COMPONENT_INFO(name, bits, flags, fixed_val) { #name, bits, flags, fixed_val },
 static sisis_component_t components[] = {
+	SISIS_ADDR_COMPONENTS(SISIS_ADDR_COMPONENT_INFO)
+};
+enum { num_components = sizeof(components) / sizeof(components[0]) };
+#endif /* SISIS_ADDR_FORMAT_CODEC_ONLY */
+
+// Bit offset of each component.  Each offset follows the last bit of the
+// component before it.
+#define SISIS_ADDR_COMPONENT_OFFSET(name, bits, flags, fixed_val) \
+	SISIS_ADDR_OFFSET_##name, SISIS_ADDR_LAST_BIT_##name = SISIS_ADDR_OFFSET_##name + (bits) - 1,
+enum { SISIS_ADDR_COMPONENTS(SISIS_ADDR_COMPONENT_OFFSET) SISIS_ADDR_TOTAL_BITS };
+
+// Width of each component
+#define SISIS_ADDR_COMPONENT_BITS(name, bits, flags, fixed_val) SISIS_ADDR_BITS_##name = (bits),
+enum { SISIS_ADDR_COMPONENTS(SISIS_ADDR_COMPONENT_BITS) };
+
+// Fails to compile if the components do not fit in an IPv6 address
+typedef char sisis_addr_components_fit[SISIS_ADDR_TOTAL_BITS <= 128 ? 1 : -1];
+
+/** Length of the prefix that ends with the given component. */
+#define SISIS_ADDR_PREFIX_LEN(name) (SISIS_ADDR_LAST_BIT_##name + 1)
+
+/** Loads one 64 bit half of an address in host order. */
+static inline uint64_t sisis_addr_load64(const struct in6_addr * addr, int half)
+{
+	const uint8_t * p = addr->s6_addr + half * 8;
+	return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32)
+		| ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+/** Stores one 64 bit half of an address from host order. */
+static inline void sisis_addr_store64(struct in6_addr * addr, int half, uint64_t val)
+{
+	uint8_t * p = addr->s6_addr + half * 8;
+	int i;
+	for (i = 7; i >= 0; i--, val >>= 8)
+		p[i] = val & 0xff;
+}
+
+/** Reads bits [offset, offset + bits) of an address.  Bits must be 1 to 64. */
+static inline uint64_t sisis_addr_get_bits(const struct in6_addr * addr, int offset, int bits)
+{
+	uint64_t mask = bits == 64 ? ~0ULL : ((1ULL << bits) - 1);
+	int end = offset + bits;
+	if (end <= 64)
+		return (sisis_addr_load64(addr, 0) >> (64 - end)) & mask;
+	if (offset >= 64)
+		return (sisis_addr_load64(addr, 1) >> (128 - end)) & mask;
+	return ((sisis_addr_load64(addr, 0) << (end - 64)) | (sisis_addr_load64(addr, 1) >> (128 - end))) & mask;
+}
+
+/** Writes bits [offset, offset + bits) of an address.  Bits must be 1 to 64. */
+static inline void sisis_addr_set_bits(struct in6_addr * addr, int offset, int bits, uint64_t val)
+{
+	uint64_t mask = bits == 64 ? ~0ULL : ((1ULL << bits) - 1);
+	int end = offset + bits;
+	val &= mask;
+	if (end <= 64)
+		sisis_addr_store64(addr, 0, (sisis_addr_load64(addr, 0) & ~(mask << (64 - end))) | (val << (64 - end)));
+	else if (offset >= 64)
+		sisis_addr_store64(addr, 1, (sisis_addr_load64(addr, 1) & ~(mask << (128 - end))) | (val << (128 - end)));
+	else
 	{
-		"prefix",
-		16,
-		SISIS_COMPONENT_FIXED,
-		0xfcff
-	},
-	{
-		"sisis_version",
-		5,
-		SISIS_COMPONENT_FIXED,
-		2
-	},
-	{
-		"process_type",
-		16,
-		0,
-		0
-	},
-	{
-		"process_version",
-		5,
-		0,
-		0
-	},
-	{
-		"sys_id",
-		32,
-		0,
-		0
-	},
-	{
-		"pid",
-		22,
-		0,
-		0
-	},
-	{
-		"timestamp",
-		32,
-		0,
-		0
+		int low_bits = end - 64;
+		sisis_addr_store64(addr, 0, (sisis_addr_load64(addr, 0) & ~(mask >> low_bits)) | (val >> low_bits));
+		sisis_addr_store64(addr, 1, (sisis_addr_load64(addr, 1) & ~(mask << (128 - end))) | (val << (128 - end)));
 	}
-};
-static int num_components = sizeof(components);
+}
+
+// sisis_addr_get_<component>() and sisis_addr_set_<component>()
+#define SISIS_ADDR_COMPONENT_ACCESSORS(name, bits, flags, fixed_val) \
+static inline uint64_t sisis_addr_get_##name(const struct in6_addr * addr) \
+{ \
+	return sisis_addr_get_bits(addr, SISIS_ADDR_OFFSET_##name, bits); \
+} \
+static inline void sisis_addr_set_##name(struct in6_addr * addr, uint64_t val) \
+{ \
+	sisis_addr_set_bits(addr, SISIS_ADDR_OFFSET_##name, bits, val); \
+}
+SISIS_ADDR_COMPONENTS(SISIS_ADDR_COMPONENT_ACCESSORS)
+
+// Checks every fixed component
+#define SISIS_ADDR_COMPONENT_CHECK_FIXED(name, bits, flags, fixed_val) \
+	&& (!((flags) & SISIS_COMPONENT_FIXED) || sisis_addr_get_##name(addr) == (fixed_val))
+
+/** Checks if an address is an SIS-IS address. */
+static inline int sisis_addr_is_sisis(const struct in6_addr * addr)
+{
+	return 1 SISIS_ADDR_COMPONENTS(SISIS_ADDR_COMPONENT_CHECK_FIXED);
+}
 
 #endif
@@ -0,0 +1,416 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sisis_api.h"
+#include "sisis_structs.h"
+#include "sisis_netlink.h"
+#include "sisis_addr_index.h"
+
+// The index
+pthread_mutex_t sisis_addr_index_init_mutex = PTHREAD_MUTEX_INITIALIZER;
+volatile short sisis_addr_index_ready = 0;
+time_t sisis_addr_index_next_attempt = 0;
+volatile unsigned int sisis_addr_index_overruns = 0;
+struct sisis_addr_index sisis_addr_index = { PTHREAD_RWLOCK_INITIALIZER, NULL, NULL, NULL, NULL };
+
+/** Checks whether an entry was seen in a routing table. */
+static int sisis_addr_index_has_table(struct sisis_addr_index_entry * entry, u_int32_t table)
+{
+	int i;
+	for (i = 0; i < entry->num_tables; i++)
+		if (entry->tables[i] == table)
+			return 1;
+	return 0;
+}
+
+/** Notes that an entry was seen in a routing table, if there is room. */
+static void sisis_addr_index_add_table(struct sisis_addr_index_entry * entry, u_int32_t table)
+{
+	if (!sisis_addr_index_has_table(entry, table) && entry->num_tables < SISIS_ADDR_INDEX_MAX_TABLES)
+		entry->tables[entry->num_tables++] = table;
+}
+
+/** Notes that an entry is gone from a routing table. */
+static void sisis_addr_index_remove_table(struct sisis_addr_index_entry * entry, u_int32_t table)
+{
+	int i;
+	for (i = 0; i < entry->num_tables; i++)
+		if (entry->tables[i] == table)
+		{
+			entry->tables[i] = entry->tables[--entry->num_tables];
+			return;
+		}
+}
+
+/** Frees a trie along with its entries. */
+static void sisis_addr_index_free_trie(struct sisis_addr_trie * trie)
+{
+	struct sisis_addr_trie_node * node;
+	for (node = trie->top; node != NULL; node = sisis_addr_trie_next_until(node, NULL))
+		free(node->info);
+	sisis_addr_trie_finish(trie);
+}
+
+/** Gets the entry for an address in a trie, adding one if needed.  Caller must hold the index lock. */
+static struct sisis_addr_index_entry * sisis_addr_index_get_entry(struct sisis_addr_trie * trie, struct in6_addr * addr, int * added)
+{
+	*added = 0;
+	struct sisis_addr_trie_node * node = sisis_addr_trie_get(trie, addr, 128);
+	if (node == NULL)
+		return NULL;
+	struct sisis_addr_index_entry * entry = node->info;
+	if (entry == NULL)
+	{
+		if ((entry = malloc(sizeof(*entry))) == NULL)
+		{
+			sisis_addr_trie_unset_info(trie, node);
+			return NULL;
+		}
+		entry->addr = *addr;
+		entry->num_tables = 0;
+		sisis_addr_trie_set_info(node, entry);
+		*added = 1;
+	}
+	return entry;
+}
+
+/** Builds the host trie key for a SIS-IS address. */
+static void sisis_addr_index_host_key(struct in6_addr * addr, struct in6_addr * key)
+{
+	memset(key, 0, sizeof(*key));
+	sisis_addr_set_bits(key, 0, SISIS_ADDR_BITS_sys_id, sisis_addr_get_sys_id(addr));
+	sisis_addr_set_bits(key, SISIS_ADDR_BITS_sys_id, SISIS_ADDR_INDEX_PTYPE_AND_VERSION_LEN, sisis_addr_get_bits(addr, SISIS_ADDR_OFFSET_process_type, SISIS_ADDR_INDEX_PTYPE_AND_VERSION_LEN));
+	sisis_addr_set_bits(key, SISIS_ADDR_BITS_sys_id + SISIS_ADDR_INDEX_PTYPE_AND_VERSION_LEN, SISIS_ADDR_INDEX_REST_LEN, sisis_addr_get_bits(addr, SISIS_ADDR_OFFSET_pid, SISIS_ADDR_INDEX_REST_LEN));
+}
+
+/** Builds the host trie prefix for a sys_id. */
+static void sisis_addr_index_host_prefix(u_int32_t sys_id, struct in6_addr * key)
+{
+	memset(key, 0, sizeof(*key));
+	sisis_addr_set_bits(key, 0, SISIS_ADDR_BITS_sys_id, sys_id);
+}
+
+/**
+ * Adds an address to the index.  Routes from the seeding dump are skipped if
+ * the subscription has removed them since.
+ */
+static void sisis_addr_index_add(struct in6_addr * addr, u_int32_t table, int from_dump)
+{
+	pthread_rwlock_wrlock(&sisis_addr_index.lock);
+	if (from_dump && sisis_addr_index.seed_removed != NULL)
+	{
+		struct sisis_addr_trie_node * removed = sisis_addr_trie_lookup(sisis_addr_index.seed_removed, addr, 128);
+		if (removed != NULL && sisis_addr_index_has_table(removed->info, table))
+		{
+			pthread_rwlock_unlock(&sisis_addr_index.lock);
+			return;
+		}
+	}
+	int added;
+	struct sisis_addr_index_entry * entry = sisis_addr_index_get_entry(sisis_addr_index.addrs, addr, &added);
+	if (entry != NULL)
+	{
+		if (added)
+		{
+			// Also index by host
+			if (sisis_addr_is_sisis(addr))
+			{
+				struct in6_addr key;
+				sisis_addr_index_host_key(addr, &key);
+				struct sisis_addr_trie_node * host_node = sisis_addr_trie_get(sisis_addr_index.hosts, &key, SISIS_ADDR_INDEX_HOST_KEY_LEN);
+				if (host_node != NULL)
+					sisis_addr_trie_set_info(host_node, entry);
+			}
+		}
+		sisis_addr_index_add_table(entry, table);
+	}
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+}
+
+/** Removes an address from the index once it is gone from every table. */
+static void sisis_addr_index_remove(struct in6_addr * addr, u_int32_t table)
+{
+	pthread_rwlock_wrlock(&sisis_addr_index.lock);
+
+	// Keep the seeding dump from adding it back
+	int added;
+	struct sisis_addr_index_entry * entry;
+	if (sisis_addr_index.seed_removed != NULL && (entry = sisis_addr_index_get_entry(sisis_addr_index.seed_removed, addr, &added)) != NULL)
+		sisis_addr_index_add_table(entry, table);
+
+	struct sisis_addr_trie_node * node = sisis_addr_trie_lookup(sisis_addr_index.addrs, addr, 128);
+	if (node != NULL)
+	{
+		entry = node->info;
+		sisis_addr_index_remove_table(entry, table);
+		if (entry->num_tables == 0)
+		{
+			if (sisis_addr_is_sisis(addr))
+			{
+				struct in6_addr key;
+				sisis_addr_index_host_key(addr, &key);
+				struct sisis_addr_trie_node * host_node = sisis_addr_trie_lookup(sisis_addr_index.hosts, &key, SISIS_ADDR_INDEX_HOST_KEY_LEN);
+				if (host_node != NULL)
+					sisis_addr_trie_unset_info(sisis_addr_index.hosts, host_node);
+			}
+			sisis_addr_trie_unset_info(sisis_addr_index.addrs, node);
+			free(entry);
+		}
+	}
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+}
+
+/** Builds a list of copies of the addresses under a trie prefix.  Caller must hold the index lock. */
+static struct list * sisis_addr_index_collect(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen)
+{
+	struct list * rtn = malloc(sizeof(struct list));
+	if (rtn == NULL)
+		return NULL;
+	memset(rtn, 0, sizeof(*rtn));
+
+	struct sisis_addr_trie_node * top, * node;
+	SISIS_ADDR_TRIE_FOREACH(trie, key, keylen, top, node)
+	{
+		// Add to list
+		struct listnode * new_node = malloc(sizeof(struct listnode));
+		if (new_node != NULL)
+		{
+			if ((new_node->data = malloc(sizeof(struct in6_addr))) != NULL)
+			{
+				memcpy(new_node->data, &((struct sisis_addr_index_entry *)node->info)->addr, sizeof(struct in6_addr));
+				LIST_APPEND(rtn, new_node);
+			}
+			else
+				free(new_node);
+		}
+	}
+
+	return rtn;
+}
+
+/** RIB callback when an IPv6 route is added. */
+static int sisis_addr_index_rib_add_ipv6(struct route_ipv6 * route, void * data)
+{
+	(void)data;
+	// Only host addresses are indexed
+	if (route->p->prefixlen == 128)
+		sisis_addr_index_add(&route->p->prefix, route->vrf_id, 0);
+
+	// Free memory
+	free(route->p);
+	free(route);
+	return 0;
+}
+
+/** Dump callback for an IPv6 route while seeding the index. */
+static int sisis_addr_index_seed_ipv6(struct route_ipv6 * route, void * data)
+{
+	(void)data;
+	// Only SIS-IS host addresses are kept current by the subscription
+	if (route->p->prefixlen == 128 && sisis_addr_is_sisis(&route->p->prefix))
+		sisis_addr_index_add(&route->p->prefix, route->vrf_id, 1);
+
+	// Free memory
+	free(route->p);
+	free(route);
+	return 0;
+}
+
+/** RIB callback when an IPv6 route is removed. */
+static int sisis_addr_index_rib_remove_ipv6(struct route_ipv6 * route, void * data)
+{
+	(void)data;
+	if (route->p->prefixlen == 128)
+		sisis_addr_index_remove(&route->p->prefix, route->vrf_id);
+
+	// Free memory
+	free(route->p);
+	free(route);
+	return 0;
+}
+
+/**
+ * Route changes were lost because the subscription fell behind.  The index
+ * is seeded again on the next query.
+ */
+static void sisis_addr_index_rib_overrun(void * data)
+{
+	(void)data;
+	__sync_fetch_and_add(&sisis_addr_index_overruns, 1);
+	sisis_addr_index_ready = 0;
+}
+
+/**
+ * Sets up the address index.  The index is seeded from one kernel route dump
+ * and then kept current from the netlink RIB change stream.  If changes are
+ * lost, it is cleared and seeded again.  Safe to call more than once; once
+ * the index is ready this does not lock anything.
+ *
+ * Returns zero on success.
+ */
+int sisis_addr_index_init(void)
+{
+	if (sisis_addr_index_ready)
+	{
+		__sync_synchronize();
+		return 0;
+	}
+
+	int rtn = 0;
+	pthread_mutex_lock(&sisis_addr_index_init_mutex);
+	if (!sisis_addr_index_ready)
+	{
+		// Do not retry a failed setup on every query
+		time_t now = time(NULL);
+		if (now < sisis_addr_index_next_attempt)
+			rtn = -1;
+		else
+		{
+			unsigned int overruns = sisis_addr_index_overruns;
+			struct sisis_addr_trie * addrs = sisis_addr_trie_init();
+			struct sisis_addr_trie * hosts = sisis_addr_trie_init();
+			struct sisis_addr_trie * seed_removed = sisis_addr_trie_init();
+			if (addrs == NULL || hosts == NULL || seed_removed == NULL)
+			{
+				sisis_addr_trie_finish(addrs);
+				sisis_addr_trie_finish(hosts);
+				sisis_addr_trie_finish(seed_removed);
+				rtn = -1;
+			}
+			else
+			{
+				// Start from empty tries.  A dump record may be older than a removal
+				// the subscription has already applied, so removals are remembered
+				// until the dump is done.
+				pthread_rwlock_wrlock(&sisis_addr_index.lock);
+				struct sisis_addr_trie * old_addrs = sisis_addr_index.addrs;
+				struct sisis_addr_trie * old_hosts = sisis_addr_index.hosts;
+				struct sisis_addr_trie * old_removed = sisis_addr_index.seed_removed;
+				sisis_addr_index.addrs = addrs;
+				sisis_addr_index.hosts = hosts;
+				sisis_addr_index.seed_removed = seed_removed;
+				pthread_rwlock_unlock(&sisis_addr_index.lock);
+				if (old_addrs != NULL)
+					sisis_addr_index_free_trie(old_addrs);
+				sisis_addr_trie_finish(old_hosts);
+				if (old_removed != NULL)
+					sisis_addr_index_free_trie(old_removed);
+
+				// Subscribe before the dump so no change can be missed.  The
+				// subscription is kept when seeding again.
+				if (sisis_addr_index.subscribe_info == NULL)
+				{
+					struct sisis_netlink_routing_table_info * info = malloc(sizeof(*info));
+					if (info == NULL)
+						rtn = -1;
+					else
+					{
+						memset(info, 0, sizeof(*info));
+						info->rib_add_ipv6_route = sisis_addr_index_rib_add_ipv6;
+						info->rib_remove_ipv6_route = sisis_addr_index_rib_remove_ipv6;
+						info->rib_overrun = sisis_addr_index_rib_overrun;
+						info->filter = SISIS_NETLINK_FILTER_SISIS;
+						if (sisis_netlink_subscribe_to_rib_changes(info) != 0)
+						{
+							free(info);
+							rtn = -1;
+						}
+						else
+							sisis_addr_index.subscribe_info = info;
+					}
+				}
+
+				// Seed from one dump
+				if (rtn == 0)
+				{
+					struct sisis_netlink_routing_table_info dump_info;
+					memset(&dump_info, 0, sizeof(dump_info));
+					dump_info.rib_add_ipv6_route = sisis_addr_index_seed_ipv6;
+					if (sisis_netlink_route_read(&dump_info) != 0)
+						rtn = -1;
+				}
+
+				if (rtn == 0)
+				{
+					pthread_rwlock_wrlock(&sisis_addr_index.lock);
+					sisis_addr_index.seed_removed = NULL;
+					pthread_rwlock_unlock(&sisis_addr_index.lock);
+					sisis_addr_index_free_trie(seed_removed);
+
+					// Publish the index only once it is seeded, unless changes were
+					// lost meanwhile
+					__sync_synchronize();
+					sisis_addr_index_ready = 1;
+					__sync_synchronize();
+					if (overruns != sisis_addr_index_overruns)
+					{
+						sisis_addr_index_ready = 0;
+						rtn = -1;
+					}
+				}
+			}
+			if (rtn != 0)
+				sisis_addr_index_next_attempt = now + 1;
+		}
+	}
+	pthread_mutex_unlock(&sisis_addr_index_init_mutex);
+	return rtn;
+}
+
+/**
+ * Get addresses in the index that match a given IPv6 prefix.  It is the
+ * receiver's responsibility to free the list when done with it.
+ */
+struct list * sisis_addr_index_get(struct prefix_ipv6 * p)
+{
+	pthread_rwlock_rdlock(&sisis_addr_index.lock);
+	struct list * rtn = sisis_addr_index_collect(sisis_addr_index.addrs, &p->prefix, p->prefixlen);
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+	return rtn;
+}
+
+/** Count addresses in the index that match a given IPv6 prefix. */
+int sisis_addr_index_count(struct prefix_ipv6 * p)
+{
+	pthread_rwlock_rdlock(&sisis_addr_index.lock);
+	int cnt = sisis_addr_trie_count(sisis_addr_index.addrs, &p->prefix, p->prefixlen);
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+	return cnt;
+}
+
+/**
+ * Get SIS-IS addresses in the index for a single host.  It is the
+ * receiver's responsibility to free the list when done with it.
+ */
+struct list * sisis_addr_index_get_host(u_int32_t sys_id)
+{
+	struct in6_addr key;
+	sisis_addr_index_host_prefix(sys_id, &key);
+
+	pthread_rwlock_rdlock(&sisis_addr_index.lock);
+	struct list * rtn = sisis_addr_index_collect(sisis_addr_index.hosts, &key, SISIS_ADDR_BITS_sys_id);
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+	return rtn;
+}
+
+/** Count SIS-IS addresses in the index for a single host. */
+int sisis_addr_index_count_host(u_int32_t sys_id)
+{
+	struct in6_addr key;
+	sisis_addr_index_host_prefix(sys_id, &key);
+
+	pthread_rwlock_rdlock(&sisis_addr_index.lock);
+	int cnt = sisis_addr_trie_count(sisis_addr_index.hosts, &key, SISIS_ADDR_BITS_sys_id);
+	pthread_rwlock_unlock(&sisis_addr_index.lock);
+	return cnt;
+}
@@ -0,0 +1,82 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#ifndef _SISIS_ADDR_INDEX_H
+#define _SISIS_ADDR_INDEX_H
+
+#include "sisis_structs.h"
+#include "sisis_addr_trie.h"
+#include "sisis_addr_format.h"
+
+// Host keys put the sys_id bits first so one host is a single subtree,
+// followed by the process type and version and then the remaining bits.
+#define SISIS_ADDR_INDEX_PTYPE_AND_VERSION_LEN (SISIS_ADDR_BITS_process_type + SISIS_ADDR_BITS_process_version)
+#define SISIS_ADDR_INDEX_REST_LEN (SISIS_ADDR_TOTAL_BITS - SISIS_ADDR_OFFSET_pid)
+#define SISIS_ADDR_INDEX_HOST_KEY_LEN (SISIS_ADDR_BITS_sys_id + SISIS_ADDR_INDEX_PTYPE_AND_VERSION_LEN + SISIS_ADDR_INDEX_REST_LEN)
+
+// Routing tables tracked for an address.  Host addresses are normally only in
+// the main and local tables; further tables are not tracked.
+#define SISIS_ADDR_INDEX_MAX_TABLES 4
+
+/** Index entry for a single host address */
+struct sisis_addr_index_entry
+{
+	struct in6_addr addr;
+
+	// Routing tables the address was seen in
+	u_int32_t tables[SISIS_ADDR_INDEX_MAX_TABLES];
+	int num_tables;
+};
+
+/**
+ * In-process index of SIS-IS host addresses.  Addresses are kept in a binary
+ * trie so all addresses under a prefix form one subtree.  They are also kept
+ * in a second trie keyed by sys_id first so that all addresses for one host
+ * form one subtree.
+ */
+struct sisis_addr_index
+{
+	pthread_rwlock_t lock;
+	struct sisis_addr_trie * addrs;
+	struct sisis_addr_trie * hosts;
+
+	// Netlink subscription keeping the index current
+	struct sisis_netlink_routing_table_info * subscribe_info;
+
+	// While the index is seeded from a dump, routes removed by the
+	// subscription, so that older dump records do not add them back
+	struct sisis_addr_trie * seed_removed;
+};
+
+/**
+ * Sets up the address index.  The index is seeded from one kernel route dump
+ * and then kept current from the netlink RIB change stream.  If changes are
+ * lost, it is cleared and seeded again.  Safe to call more than once; once
+ * the index is ready this does not lock anything.
+ *
+ * Returns zero on success.
+ */
+int sisis_addr_index_init(void);
+
+/**
+ * Get addresses in the index that match a given IPv6 prefix.  It is the
+ * receiver's responsibility to free the list when done with it.
+ */
+struct list * sisis_addr_index_get(struct prefix_ipv6 * p);
+
+/** Count addresses in the index that match a given IPv6 prefix. */
+int sisis_addr_index_count(struct prefix_ipv6 * p);
+
+/**
+ * Get SIS-IS addresses in the index for a single host.  It is the
+ * receiver's responsibility to free the list when done with it.
+ */
+struct list * sisis_addr_index_get_host(u_int32_t sys_id);
+
+/** Count SIS-IS addresses in the index for a single host. */
+int sisis_addr_index_count_host(u_int32_t sys_id);
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <netinet/in.h>
+
+#include "sisis_api.h"
+#include "sisis_structs.h"
+#include "sisis_addr_trie.h"
+
+/* Utility mask array. */
+static const u_char maskbit[] =
+{
+	0x00, 0x80, 0xc0, 0xe0, 0xf0, 0xf8, 0xfc, 0xfe, 0xff
+};
+
+/** Gets a single bit of a key. */
+static int sisis_addr_trie_bit(struct in6_addr * key, int bit)
+{
+	return (key->s6_addr[bit / 8] >> (7 - (bit % 8))) & 1;
+}
+
+/** Checks if the first keylen bits of two keys are equal. */
+static int sisis_addr_trie_key_match(struct in6_addr * a, struct in6_addr * b, int keylen)
+{
+	int bytes = keylen / 8, bits = keylen % 8;
+	if (memcmp(a, b, bytes) != 0)
+		return 0;
+	if (bits && ((a->s6_addr[bytes] ^ b->s6_addr[bytes]) & maskbit[bits]))
+		return 0;
+	return 1;
+}
+
+/** Creates a node with all bits beyond keylen cleared. */
+static struct sisis_addr_trie_node * sisis_addr_trie_node_new(struct in6_addr * key, int keylen)
+{
+	struct sisis_addr_trie_node * node = malloc(sizeof(*node));
+	if (node == NULL)
+		return NULL;
+	memset(node, 0, sizeof(*node));
+
+	int bytes = keylen / 8, bits = keylen % 8;
+	memcpy(&node->key, key, bytes);
+	if (bits)
+		node->key.s6_addr[bytes] = key->s6_addr[bytes] & maskbit[bits];
+	node->keylen = keylen;
+	return node;
+}
+
+/** Attaches new below node on the side given by the next bit of new's key. */
+static void sisis_addr_trie_set_link(struct sisis_addr_trie_node * node, struct sisis_addr_trie_node * new)
+{
+	node->link[sisis_addr_trie_bit(&new->key, node->keylen)] = new;
+	new->parent = node;
+}
+
+/** Length of the common leading bits of two keys, capped at max. */
+static int sisis_addr_trie_common_len(struct in6_addr * a, struct in6_addr * b, int max)
+{
+	int i, len = 0;
+	for (i = 0; i < 16 && len < max; i++)
+	{
+		u_char diff = a->s6_addr[i] ^ b->s6_addr[i];
+		if (diff == 0)
+			len += 8;
+		else
+		{
+			while (!(diff & 0x80))
+			{
+				diff <<= 1;
+				len++;
+			}
+			break;
+		}
+	}
+	return len < max ? len : max;
+}
+
+/** Creates an empty trie. */
+struct sisis_addr_trie * sisis_addr_trie_init(void)
+{
+	struct sisis_addr_trie * trie = malloc(sizeof(*trie));
+	if (trie != NULL)
+		trie->top = NULL;
+	return trie;
+}
+
+/** Frees a trie and all of its nodes.  Info pointers are not freed. */
+void sisis_addr_trie_finish(struct sisis_addr_trie * trie)
+{
+	if (trie == NULL)
+		return;
+
+	struct sisis_addr_trie_node * node = trie->top, * tmp;
+	while (node)
+	{
+		if (node->link[0])
+		{
+			node = node->link[0];
+			continue;
+		}
+		if (node->link[1])
+		{
+			node = node->link[1];
+			continue;
+		}
+
+		tmp = node;
+		node = node->parent;
+		if (node != NULL)
+		{
+			if (node->link[0] == tmp)
+				node->link[0] = NULL;
+			else
+				node->link[1] = NULL;
+		}
+		free(tmp);
+	}
+	free(trie);
+}
+
+/** Gets the node for a key, creating it if needed. */
+struct sisis_addr_trie_node * sisis_addr_trie_get(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen)
+{
+	struct sisis_addr_trie_node * match = NULL, * node = trie->top, * new;
+	while (node && node->keylen <= keylen && sisis_addr_trie_key_match(&node->key, key, node->keylen))
+	{
+		if (node->keylen == keylen)
+			return node;
+		match = node;
+		node = node->link[sisis_addr_trie_bit(key, node->keylen)];
+	}
+
+	if (node == NULL)
+	{
+		if ((new = sisis_addr_trie_node_new(key, keylen)) == NULL)
+			return NULL;
+		if (match)
+			sisis_addr_trie_set_link(match, new);
+		else
+			trie->top = new;
+	}
+	else
+	{
+		// Branch point where the new key and the existing subtree diverge
+		int common = sisis_addr_trie_common_len(&node->key, key, node->keylen < keylen ? node->keylen : keylen);
+		if ((new = sisis_addr_trie_node_new(key, common)) == NULL)
+			return NULL;
+		new->count = node->count;
+		sisis_addr_trie_set_link(new, node);
+		if (match)
+			sisis_addr_trie_set_link(match, new);
+		else
+			trie->top = new;
+
+		if (new->keylen != keylen)
+		{
+			match = new;
+			if ((new = sisis_addr_trie_node_new(key, keylen)) == NULL)
+				return NULL;
+			sisis_addr_trie_set_link(match, new);
+		}
+	}
+	return new;
+}
+
+/** Finds the node for a key.  Returns NULL if there is no node with info. */
+struct sisis_addr_trie_node * sisis_addr_trie_lookup(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen)
+{
+	struct sisis_addr_trie_node * node = trie->top;
+	while (node && node->keylen <= keylen && sisis_addr_trie_key_match(&node->key, key, node->keylen))
+	{
+		if (node->keylen == keylen)
+			return node->info ? node : NULL;
+		node = node->link[sisis_addr_trie_bit(key, node->keylen)];
+	}
+	return NULL;
+}
+
+/** Finds the longest key with info that covers an address. */
+struct sisis_addr_trie_node * sisis_addr_trie_match(struct sisis_addr_trie * trie, struct in6_addr * addr)
+{
+	struct sisis_addr_trie_node * matched = NULL, * node = trie->top;
+	while (node && sisis_addr_trie_key_match(&node->key, addr, node->keylen))
+	{
+		if (node->info)
+			matched = node;
+		if (node->keylen == 128)
+			break;
+		node = node->link[sisis_addr_trie_bit(addr, node->keylen)];
+	}
+	return matched;
+}
+
+/**
+ * Finds the top node of the subtree holding every key under a prefix.
+ * Returns NULL if nothing is under the prefix.
+ */
+struct sisis_addr_trie_node * sisis_addr_trie_subtree(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen)
+{
+	struct sisis_addr_trie_node * node = trie->top;
+	while (node)
+	{
+		if (node->keylen >= keylen)
+			return sisis_addr_trie_key_match(&node->key, key, keylen) ? node : NULL;
+		if (!sisis_addr_trie_key_match(&node->key, key, node->keylen))
+			return NULL;
+		node = node->link[sisis_addr_trie_bit(key, node->keylen)];
+	}
+	return NULL;
+}
+
+/** Gets the next node in a pre-order walk that stays under limit. */
+struct sisis_addr_trie_node * sisis_addr_trie_next_until(struct sisis_addr_trie_node * node, struct sisis_addr_trie_node * limit)
+{
+	if (node->link[0])
+		return node->link[0];
+	if (node->link[1])
+		return node->link[1];
+
+	while (node->parent && node != limit)
+	{
+		if (node->parent->link[0] == node && node->parent->link[1])
+			return node->parent->link[1];
+		node = node->parent;
+	}
+	return NULL;
+}
+
+/** Sets the info for a node and keeps subtree counts current. */
+void sisis_addr_trie_set_info(struct sisis_addr_trie_node * node, void * info)
+{
+	if (node->info == NULL && info != NULL)
+	{
+		struct sisis_addr_trie_node * tmp;
+		for (tmp = node; tmp; tmp = tmp->parent)
+			tmp->count++;
+	}
+	node->info = info;
+}
+
+/** Clears the info for a node and removes nodes that are no longer needed. */
+void sisis_addr_trie_unset_info(struct sisis_addr_trie * trie, struct sisis_addr_trie_node * node)
+{
+	if (node->info != NULL)
+	{
+		struct sisis_addr_trie_node * tmp;
+		for (tmp = node; tmp; tmp = tmp->parent)
+			tmp->count--;
+		node->info = NULL;
+	}
+
+	// Remove nodes that are neither holding info nor a branch point
+	while (node && node->info == NULL && !(node->link[0] && node->link[1]))
+	{
+		struct sisis_addr_trie_node * child = node->link[0] ? node->link[0] : node->link[1];
+		struct sisis_addr_trie_node * parent = node->parent;
+
+		if (child)
+			child->parent = parent;
+		if (parent)
+		{
+			if (parent->link[0] == node)
+				parent->link[0] = child;
+			else
+				parent->link[1] = child;
+		}
+		else
+			trie->top = child;
+
+		free(node);
+		node = parent;
+	}
+}
+
+/** Count keys with info under a prefix. */
+unsigned int sisis_addr_trie_count(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen)
+{
+	struct sisis_addr_trie_node * node = sisis_addr_trie_subtree(trie, key, keylen);
+	return node ? node->count : 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#ifndef _SISIS_ADDR_TRIE_H
+#define _SISIS_ADDR_TRIE_H
+
+#include "sisis_structs.h"
+
+/**
+ * Compressed binary trie keyed on raw 128-bit IPv6 addresses.  Works like
+ * quagga's lib/table.c but without reference counting; the caller is
+ * responsible for locking.
+ */
+struct sisis_addr_trie
+{
+	struct sisis_addr_trie_node * top;
+};
+
+struct sisis_addr_trie_node
+{
+	// Key of this node
+	struct in6_addr key;
+	u_char keylen;
+
+	// Tree links
+	struct sisis_addr_trie_node * parent;
+	struct sisis_addr_trie_node * link[2];
+
+	// Number of nodes with info in this subtree (including this one)
+	unsigned int count;
+
+	// User data.  Nodes without info are only kept as branch points.
+	void * info;
+};
+
+/** Creates an empty trie. */
+struct sisis_addr_trie * sisis_addr_trie_init(void);
+
+/** Frees a trie and all of its nodes.  Info pointers are not freed. */
+void sisis_addr_trie_finish(struct sisis_addr_trie * trie);
+
+/** Gets the node for a key, creating it if needed. */
+struct sisis_addr_trie_node * sisis_addr_trie_get(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen);
+
+/** Finds the node for a key.  Returns NULL if there is no node with info. */
+struct sisis_addr_trie_node * sisis_addr_trie_lookup(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen);
+
+/** Finds the longest key with info that covers an address. */
+struct sisis_addr_trie_node * sisis_addr_trie_match(struct sisis_addr_trie * trie, struct in6_addr * addr);
+
+/**
+ * Finds the top node of the subtree holding every key under a prefix.
+ * Returns NULL if nothing is under the prefix.
+ */
+struct sisis_addr_trie_node * sisis_addr_trie_subtree(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen);
+
+/** Gets the next node in a pre-order walk that stays under limit. */
+struct sisis_addr_trie_node * sisis_addr_trie_next_until(struct sisis_addr_trie_node * node, struct sisis_addr_trie_node * limit);
+
+/** Sets the info for a node and keeps subtree counts current. */
+void sisis_addr_trie_set_info(struct sisis_addr_trie_node * node, void * info);
+
+/** Clears the info for a node and removes nodes that are no longer needed. */
+void sisis_addr_trie_unset_info(struct sisis_addr_trie * trie, struct sisis_addr_trie_node * node);
+
+/** Count keys with info under a prefix. */
+unsigned int sisis_addr_trie_count(struct sisis_addr_trie * trie, struct in6_addr * key, int keylen);
+
+/** Walk each node with info under a prefix. */
+#define SISIS_ADDR_TRIE_FOREACH(trie,key,keylen,top,node) \
+	for (top = node = sisis_addr_trie_subtree(trie, key, keylen); node != NULL; node = sisis_addr_trie_next_until(node, top)) \
+		if (node->info != NULL)
+
+#endif
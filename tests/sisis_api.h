@@ -15,13 +15,38 @@
 
 #define SISIS_VERSION 1
 
-#define SISIS_REREGISTRATION_TIMEOUT			20
+// Default lifetime of a registered address in milliseconds
+#define SISIS_ADDRESS_TTL_DEFAULT				30000
 
 // SIS-IS Commands/Messages
 #define SISIS_CMD_REGISTER_ADDRESS				1
 #define SISIS_CMD_UNREGISTER_ADDRESS			2
 #define SISIS_ACK							            3
 #define SISIS_NACK							     			4
+#define SISIS_CMD_REGISTER_ADDRESSES			5
+#define SISIS_CMD_UNREGISTER_ADDRESSES		6
+
+// Batch messages carry a count followed by a family, raw address and lifetime
+// in milliseconds for each address.  The ACK carries the count followed by a bitmap of the addresses
+// that were accepted.
+#define SISIS_BATCH_ADDRESS_SIZE				22
+#define SISIS_MAX_BATCH_ADDRESSES				45
+
+// Largest message sent: the header and a full batch
+#define SISIS_MAX_MESSAGE_SIZE					(8 + 2 + SISIS_MAX_BATCH_ADDRESSES * SISIS_BATCH_ADDRESS_SIZE)
+
+// Subscriptions to address changes, Unix socket only.  SUBSCRIBE carries the
+// client's subscription id, family, prefix length and raw prefix.
+// UNSUBSCRIBE carries the subscription id.  NOTIFY_ADDRESSES is sent with the
+// subscription id in place of a request id and carries flags, a count, and a
+// kind and raw address for each change.
+#define SISIS_CMD_SUBSCRIBE								7
+#define SISIS_CMD_UNSUBSCRIBE							8
+#define SISIS_NOTIFY_ADDRESSES						9
+#define SISIS_SUBSCRIBE_SIZE							24
+#define SISIS_NOTIFY_HEADER_SIZE					12
+#define SISIS_NOTIFY_ENTRY_SIZE						17
+#define SISIS_NOTIFY_FLAG_LOST						(1 << 0)	// Changes were dropped
 
 #ifndef USE_IPV6 /* IPv4 Version */
 // Prefix lengths
@@ -42,18 +67,81 @@ typedef struct {
 extern int sisis_listener_port;
 extern char * sisis_listener_ip_addr;
 
-#define AWAITING_ACK_POOL_SIZE 25
+// Unix socket of sisisd, or NULL to use UDP.  Must be set before the first
+// request.
+extern char * sisis_listener_unix_path;
 
-#define MAX_REREGISTRATION_THREADS 5
+// Lifetime in milliseconds given to addresses registered from now on.  They
+// are refreshed after about two thirds of it.
+extern unsigned int sisis_address_ttl;
 
-/** Information for reregistration thread */
-typedef struct {
-	pthread_t thread;
+// Outstanding requests are kept in an open addressing table indexed by
+// request id.  The size must be a power of two.
+#define SISIS_REQUEST_TABLE_SIZE 1024
+
+// Slots tried for a request id, starting with the one it maps to
+#define SISIS_REQUEST_MAX_PROBES 32
+
+// Freed asynchronous requests kept for reuse.  Refreshes are sent one
+// request per batch without waiting, so this covers refreshing about ten
+// thousand addresses at once.
+#define SISIS_REQUEST_POOL_MAX 256
+
+// Seconds to wait for an ACK or NACK
+#define SISIS_REQUEST_TIMEOUT 5
+
+// Milliseconds between checks for timed out asynchronous requests
+#define SISIS_REQUEST_EXPIRY_CHECK_MS 100
+
+// Request outcomes passed to sisis_request_callback_t
+#define SISIS_REQUEST_ACKED						0
+#define SISIS_REQUEST_NACKED					1
+#define SISIS_REQUEST_TIMED_OUT				2
+
+/**
+ * Called when an asynchronous request finishes.  status is one of
+ * SISIS_REQUEST_ACKED, SISIS_REQUEST_NACKED or SISIS_REQUEST_TIMED_OUT.  For
+ * batch requests, acked has one bit per address.  Otherwise it is NULL.
+ */
+typedef void (*sisis_request_callback_t)(unsigned int request_id, int status, unsigned char * acked, int num_addrs, void * data);
+
+// Reregistration timer wheel.  Refreshes are pulled in by random jitter of
+// up to a sixth of the lifetime, and anything due within that window is sent
+// in the same batch.  At most SISIS_REREGISTRATION_MAX_AHEAD ticks are
+// searched ahead.
+#define SISIS_REREGISTRATION_TICK_MS			100
+#define SISIS_REREGISTRATION_WHEEL_SLOTS		256
+#define SISIS_REREGISTRATION_MAX_AHEAD			64
+
+// Refreshes are sent without waiting for the ACK.  A refresh waits a sixth of
+// the shortest lifetime in its batch for the ACK, between a tick and
+// SISIS_REQUEST_TIMEOUT.  Addresses that are NACKed or time out are tried
+// again SISIS_REREGISTRATION_RETRY_TICKS later.
+#define SISIS_REREGISTRATION_RETRY_TICKS		2
+
+/** Address in the reregistration timer wheel */
+typedef struct reregistration_info {
+	struct reregistration_info * next;
+	struct reregistration_info * prev;
+	unsigned int slot;
+	int rounds;		// Wheel revolutions left before it is due
+	unsigned int ttl;	// Lifetime in milliseconds
+#ifdef USE_IPV6
+	struct in6_addr addr;
+#else /* IPv4 Version */
 	char * addr;
-	short active;
-	int idx;
+#endif /* USE_IPV6 */
 } reregistration_info_t;
 
+#ifdef USE_IPV6
+/** Addresses in a refresh waiting for its ACK */
+typedef struct reregistration_batch {
+	struct reregistration_batch * next;		// Next free batch
+	int count;
+	struct in6_addr addrs[SISIS_MAX_BATCH_ADDRESSES];
+} reregistration_batch_t;
+#endif /* USE_IPV6 */
+
 // IPv4 & IPv6 RIBs
 extern struct list * ipv4_rib_routes;
 extern struct list * ipv6_rib_routes;
@@ -69,6 +157,15 @@ void sisis_process_message(char * msg, int msg_len);
  */
 #ifdef USE_IPV6
 int sisis_create_addr(char * sisis_addr, ...);
+
+/**
+ * Construct SIS-IS address without going through a string.
+ *
+ * sisis_addr Address to store resulting SIS-IS/IP address in.
+ * 
+ * Returns zero on success.
+ */
+int sisis_create_in6_addr(struct in6_addr * sisis_addr, ...);
 #else /* IPv4 Version */
 int sisis_create_addr(unsigned int ptype, unsigned int host_num, unsigned int pid, char * sisis_addr);
 #endif /* USE_IPV6 */
@@ -80,6 +177,13 @@ int sisis_create_addr(unsigned int ptype, unsigned int host_num, unsigned int pi
  */
 #ifdef USE_IPV6
 int get_sisis_addr_components(char * sisis_addr, ...);
+
+/**
+ * Split an SIS-IS address into components without going through a string.
+ *
+ * sisis_addr SIS-IS/IP address
+ */
+int get_sisis_in6_addr_components(const struct in6_addr * sisis_addr, ...);
 #else /* IPv4 Version */
 struct sisis_addr_components get_sisis_addr_components(char * sisis_addr);
 #endif /* USE_IPV6 */
@@ -98,6 +202,17 @@ int sisis_register(unsigned int ptype, unsigned int host_num, unsigned int pid,
 #endif /* USE_IPV6 */
 
 #ifdef USE_IPV6
+/**
+ * Registers SIS-IS process without waiting for the reply.  The callback is
+ * run with the outcome once the ACK or NACK arrives or the request times
+ * out.  See sisis_completion_fd() for where the callback runs.
+ *
+ * sisis_addr String to store resulting SIS-IS/IP address in.
+ * 
+ * Returns zero if the request was sent.
+ */
+int sisis_register_async(sisis_request_callback_t callback, void * data, char * sisis_addr, ...);
+
 /**
  * Unregisters SIS-IS process.
  *
@@ -106,6 +221,38 @@ int sisis_register(unsigned int ptype, unsigned int host_num, unsigned int pid,
  * Returns zero on success.
  */
 int sisis_unregister(void * nil, ...);
+
+/**
+ * Registers a batch of SIS-IS addresses with one message per
+ * SISIS_MAX_BATCH_ADDRESSES addresses.  The addresses are reregistered
+ * together.
+ *
+ * acked If not NULL, bit i is set if address i was ACKed.  Must hold at
+ *       least (count+7)/8 bytes.
+ * 
+ * Returns zero if every address was registered.
+ */
+int sisis_register_addrs(struct in6_addr * addrs, int count, unsigned char * acked);
+
+/**
+ * Unregisters a batch of SIS-IS addresses with one message per
+ * SISIS_MAX_BATCH_ADDRESSES addresses.
+ *
+ * acked If not NULL, bit i is set if address i was ACKed.  Must hold at
+ *       least (count+7)/8 bytes.
+ * 
+ * Returns zero if every address was unregistered.
+ */
+int sisis_unregister_addrs(struct in6_addr * addrs, int count, unsigned char * acked);
+
+/**
+ * Registers a batch of at most SISIS_MAX_BATCH_ADDRESSES SIS-IS addresses
+ * without waiting for the reply.  The callback receives the bitmap of
+ * ACKed addresses.  See sisis_completion_fd() for where the callback runs.
+ * 
+ * Returns zero if the request was sent.
+ */
+int sisis_register_addrs_async(struct in6_addr * addrs, int count, sisis_request_callback_t callback, void * data);
 #else /* IPv4 Version */
 /**
  * Unregisters SIS-IS process.
@@ -114,6 +261,23 @@ int sisis_unregister(void * nil, ...);
 int sisis_unregister(unsigned int ptype, unsigned int host_num, unsigned int pid);
 #endif /* USE_IPV6 */
 
+/**
+ * Gets a file descriptor that becomes readable when asynchronous requests
+ * finish.  Once this is called, callbacks are no longer run from the receive
+ * thread; call sisis_dispatch_completions() when the fd is readable to run
+ * them on the caller's thread.
+ *
+ * Returns the fd or -1 on error.
+ */
+int sisis_completion_fd(void);
+
+/**
+ * Runs the callbacks of finished asynchronous requests.
+ *
+ * Returns the number of callbacks run.
+ */
+int sisis_dispatch_completions(void);
+
 /**
  * Dump kernel routing table.
  * Returns zero on success.
@@ -149,16 +313,70 @@ struct subscribe_to_rib_changes_info
 /** Subscribe to route add/remove messages */
 int subscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info);
 
+#ifdef HAVE_IPV6
+/**
+ * Subscribe to add/remove messages for SIS-IS host routes only, of one
+ * process type or of any if ptype is negative.  Other routes are dropped by
+ * a socket filter before they reach the process.
+ */
+int subscribe_to_sisis_rib_changes(struct subscribe_to_rib_changes_info * info, int ptype);
+#endif /* HAVE_IPV6 */
+
 /** Unsubscribe to route add/remove messages */
 int unsubscribe_to_rib_changes(struct subscribe_to_rib_changes_info * info);
 
 #ifdef USE_IPV6
+// Address change events
+#define SISIS_ADDRESS_REMOVED					0
+#define SISIS_ADDRESS_ADDED						1
+#define SISIS_ADDRESSES_LOST					-1		// addr is NULL; changes were missed
+
+/**
+ * Called on the receive thread for each SIS-IS address added or removed
+ * under a subscribed prefix.  After SISIS_ADDRESSES_LOST the caller should
+ * get the addresses again with get_sisis_addrs_for_prefix().
+ */
+typedef void (*sisis_address_callback_t)(const struct in6_addr * addr, int event, void * data);
+
+/**
+ * Subscribe to SIS-IS addresses being added or removed under a prefix.
+ * sisisd parses each routing change once and sends only matching ones, so
+ * this is much cheaper than subscribe_to_rib_changes().  Addresses already
+ * registered are reported as added first.  Needs sisis_listener_unix_path.
+ *
+ * Returns the subscription id or -1 on error.
+ */
+int sisis_subscribe_addresses(struct prefix_ipv6 * p, sisis_address_callback_t callback, void * data);
+
+/**
+ * Ends a subscription.  The callback is not called once this returns.
+ *
+ * Returns zero on success.
+ */
+int sisis_unsubscribe_addresses(int id);
+
 /**
  * Get SIS-IS addresses that match a given IP prefix.  It is the receiver's
  * responsibility to free the list when done with it.
  */
 struct list * get_sisis_addrs_for_prefix(struct prefix_ipv6 * p);
 
+/**
+ * Count SIS-IS addresses that match a given IP prefix.
+ */
+int get_sisis_addr_count_for_prefix(struct prefix_ipv6 * p);
+
+/**
+ * Get SIS-IS addresses on a given host.  It is the receiver's responsibility
+ * to free the list when done with it.
+ */
+struct list * get_sisis_addrs_for_host(uint64_t sys_id);
+
+/**
+ * Count SIS-IS addresses on a given host.
+ */
+int get_sisis_addr_count_for_host(uint64_t sys_id);
+
 /**
  * Creates an IPv6 prefix
  */
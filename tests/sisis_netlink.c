@@ -24,13 +24,21 @@
 #include "sisis_netlink.h"
 #include "sisis_structs.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <errno.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <linux/filter.h>
 #include <pthread.h>
 
+#include "sisis_addr_format.h"
+
+/* sisis_netlink_parse_info () result when messages were dropped because the
+   socket buffer overran */
+#define SISIS_NETLINK_OVERRUN -2
+
 /* Socket interface to kernel */
 struct nlsock sisis_netlink_cmd  = { -1, 0, {0}, "netlink-cmd"};        /* command channel */
 
@@ -153,6 +161,8 @@ sisis_netlink_parse_info (int (*filter) (struct sockaddr_nl *, struct nlmsghdr *
             continue;
           if (errno == EWOULDBLOCK || errno == EAGAIN)
             break;
+          if (errno == ENOBUFS)
+            return SISIS_NETLINK_OVERRUN;
           continue;
         }
 
@@ -289,6 +299,17 @@ sisis_netlink_routing_table (struct sockaddr_nl *snl, struct nlmsghdr *h, void *
   if (rtm->rtm_src_len != 0)
     return 0;
 
+  /* Kernels without the socket filter pass everything */
+  if (real_info->filter)
+    {
+      if (rtm->rtm_family != AF_INET6 || rtm->rtm_dst_len != 128
+          || !tb[RTA_DST] || !sisis_addr_is_sisis (RTA_DATA (tb[RTA_DST])))
+        return 0;
+      if ((real_info->filter & SISIS_NETLINK_FILTER_PTYPE)
+          && sisis_addr_get_process_type (RTA_DATA (tb[RTA_DST])) != real_info->filter_ptype)
+        return 0;
+    }
+
   index = 0;
   metric = 0;
   dest = NULL;
@@ -408,11 +429,86 @@ int sisis_netlink_route_read (struct sisis_netlink_routing_table_info * info)
   return 0;
 }
 
+/* Install a socket filter passing only the route changes info asks for.
+   Like zebra's netlink_install_filter (), but the destination has to be
+   found among the route attributes, which SKF_AD_NLATTR does for us. */
+static int
+sisis_netlink_install_filter (int sock, struct sisis_netlink_routing_table_info * info)
+{
+  struct in6_addr fixed;
+  unsigned int fixed_bits, fixed_val, ptype_byte, ptype_shift;
+
+  /* Fixed leading components of every SIS-IS address */
+  memset (&fixed, 0, sizeof fixed);
+  sisis_addr_set_prefix (&fixed, 0xfcff);
+  sisis_addr_set_sisis_version (&fixed, 2);
+  fixed_bits = SISIS_ADDR_PREFIX_LEN (sisis_version);
+  fixed_val = sisis_addr_get_bits (&fixed, 0, fixed_bits);
+
+  /* Process type from the 32 bits starting at its first byte */
+  ptype_byte = SISIS_ADDR_OFFSET_process_type / 8;
+  ptype_shift = ptype_byte * 8 + 32 - SISIS_ADDR_PREFIX_LEN (process_type);
+
+  struct sock_filter filter[] = {
+    /* 0: ldh [4]                       */
+    BPF_STMT(BPF_LD|BPF_ABS|BPF_H, offsetof(struct nlmsghdr, nlmsg_type)),
+    /* 1: jeq RTM_NEWROUTE jt 3 jf 2    */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(RTM_NEWROUTE), 1, 0),
+    /* 2: jeq RTM_DELROUTE jt 3 jf 19   */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(RTM_DELROUTE), 0, 16),
+    /* 3: ldb [16]                      */
+    BPF_STMT(BPF_LD|BPF_ABS|BPF_B, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_family)),
+    /* 4: jeq AF_INET6 jt 5 jf 19       */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, AF_INET6, 0, 14),
+    /* 5: ldb [17]                      */
+    BPF_STMT(BPF_LD|BPF_ABS|BPF_B, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_dst_len)),
+    /* 6: jeq 128 jt 7 jf 19            */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 128, 0, 12),
+    /* 7: A = offset of RTA_DST         */
+    BPF_STMT(BPF_LD|BPF_IMM, NLMSG_LENGTH (sizeof (struct rtmsg))),
+    BPF_STMT(BPF_LDX|BPF_IMM, RTA_DST),
+    BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_AD_OFF + SKF_AD_NLATTR),
+    /* 10: jeq 0 jt 19 jf 11            */
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0, 8, 0),
+    /* 11: check the fixed components   */
+    BPF_STMT(BPF_MISC|BPF_TAX, 0),
+    BPF_STMT(BPF_LD|BPF_IND|BPF_W, RTA_LENGTH (0)),
+    BPF_STMT(BPF_ALU|BPF_RSH|BPF_K, 32 - fixed_bits),
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, fixed_val, 0, 4),
+    /* 15: check the process type       */
+    BPF_STMT(BPF_LD|BPF_IND|BPF_W, RTA_LENGTH (0) + ptype_byte),
+    BPF_STMT(BPF_ALU|BPF_RSH|BPF_K, ptype_shift),
+    BPF_STMT(BPF_ALU|BPF_AND|BPF_K, (1 << SISIS_ADDR_BITS_process_type) - 1),
+    BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, info->filter_ptype, 1, 0),
+    /* 19: ret 0    (skip)              */
+    BPF_STMT(BPF_RET|BPF_K, 0),
+    /* 20: ret 0xffff (keep)            */
+    BPF_STMT(BPF_RET|BPF_K, 0xffff),
+  };
+
+  struct sock_fprog prog = {
+    .len = sizeof(filter) / sizeof(filter[0]),
+    .filter = filter,
+  };
+
+  /* Any process type: keep once the fixed components match */
+  if (!(info->filter & SISIS_NETLINK_FILTER_PTYPE))
+    filter[14].jt = 5;
+
+  return setsockopt (sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
 /* Thread to wait for and process rib changes on a socket. */
 void * sisis_netlink_wait_for_rib_changes(void * info)
 {
 	struct sisis_netlink_wait_for_rib_changes_info * real_info = (struct sisis_netlink_wait_for_rib_changes_info *)info;
-	sisis_netlink_parse_info(sisis_netlink_routing_table, real_info->netlink_rib, (void*)real_info->info);
+	while (sisis_netlink_parse_info(sisis_netlink_routing_table, real_info->netlink_rib, (void*)real_info->info) == SISIS_NETLINK_OVERRUN)
+	{
+		// Changes were lost; keep going once the subscriber knows
+		if (real_info->info->rib_overrun)
+			real_info->info->rib_overrun(real_info->info->data);
+	}
+	return NULL;
 }
 
 /* Subscribe to routing table using netlink interface. */
@@ -431,10 +527,25 @@ int sisis_netlink_subscribe_to_rib_changes(struct sisis_netlink_routing_table_in
 	unsigned long groups= RTMGRP_IPV4_ROUTE;
 #ifdef HAVE_IPV6
   groups |= RTMGRP_IPV6_ROUTE;
+	if (info->filter)
+		groups = RTMGRP_IPV6_ROUTE;
 #endif /* HAVE_IPV6 */
 	int rtn = sisis_netlink_socket (netlink_rib, groups);
 	if (rtn < 0)
 		return rtn;
+	
+	// Make room for bursts of changes.  Forcing the size past rmem_max needs
+	// CAP_NET_ADMIN, so fall back to what is allowed.
+	int rcvbuf = SISIS_NETLINK_RCVBUF_SIZE;
+#ifdef SO_RCVBUFFORCE
+	if (setsockopt (netlink_rib->sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+#endif /* SO_RCVBUFFORCE */
+		setsockopt (netlink_rib->sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	
+	// Drop other changes before they are copied to us.  They are still
+	// checked when parsing if the kernel cannot filter.
+	if (info->filter)
+		sisis_netlink_install_filter (netlink_rib->sock, info);
 
 	// Start thread
 	pthread_t * thread = malloc(sizeof(pthread_t));
@@ -38,6 +38,10 @@
 #define MSG_TRUNC      0x20
 #endif /* MSG_TRUNC */
 
+/* Receive buffer size asked for on subscription sockets, so bursts of
+   route changes do not overrun it. */
+#define SISIS_NETLINK_RCVBUF_SIZE (4 * 1024 * 1024)
+
 /* Socket interface to kernel */
 struct nlsock
 {
@@ -58,6 +62,16 @@ struct sisis_netlink_routing_table_info
 	#endif /* HAVE_IPV6 */
 	void * data;
 	struct sisis_netlink_wait_for_rib_changes_info * nl_info;
+	
+	// Called when route changes were lost because the subscription fell
+	// behind and the socket buffer overran.  Optional.
+	void (*rib_overrun)(void *);
+	
+	// Changes to deliver.  Filtered in the kernel when subscribing.
+	int filter;
+	#define SISIS_NETLINK_FILTER_SISIS			(1<<0)	// SIS-IS host routes only
+	#define SISIS_NETLINK_FILTER_PTYPE			(1<<1)	// ...of filter_ptype only
+	unsigned int filter_ptype;
 };
 
 /* Make socket for Linux netlink interface. */
@@ -0,0 +1,92 @@
+/*
+ * SIS-IS Test program.
+ * Stephen Sigwart
+ * University of Delaware
+ */
+
+#ifndef _SISIS_REGISTRY_H
+#define _SISIS_REGISTRY_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+/**
+ * Shared memory registry of SIS-IS addresses published by sisisd.  sisisd
+ * learns every SIS-IS host route from zebra, local and remote, and keeps
+ * them sorted in one POSIX shared memory segment.  Clients map it read only
+ * and look addresses up without any system calls.
+ *
+ * The segment is protected by a sequence lock.  sisisd makes seq odd while
+ * it changes the segment and even again when done.  Readers retry if seq
+ * was odd or changed while they read.
+ *
+ * sisisd stamps heartbeat with CLOCK_MONOTONIC seconds every
+ * SISIS_REGISTRY_HEARTBEAT_SECS.  Readers treat the registry as unavailable
+ * once it is more than SISIS_REGISTRY_STALE_SECS old, as when sisisd was
+ * killed.
+ *
+ * This header is shared with sisisd and must not depend on sisis_api.h.
+ */
+#define SISIS_REGISTRY_NAME "/sisisd-registry"
+#define SISIS_REGISTRY_MAGIC 0x53495352
+#define SISIS_REGISTRY_VERSION 2
+#define SISIS_REGISTRY_MAX_ADDRS 65536
+#define SISIS_REGISTRY_HEARTBEAT_SECS 1
+#define SISIS_REGISTRY_STALE_SECS 5
+
+// Registry state
+#define SISIS_REGISTRY_STATE_DOWN				0		// Not being kept current
+#define SISIS_REGISTRY_STATE_LIVE				1
+#define SISIS_REGISTRY_STATE_OVERFLOW		2		// More addresses than fit
+
+// Only addresses under this prefix are registered
+#define SISIS_REGISTRY_PREFIX						0xfcff
+#define SISIS_REGISTRY_PREFIX_LEN				16
+
+/** Registry segment layout */
+struct sisis_registry
+{
+	uint32_t magic;
+	uint32_t version;
+	volatile uint32_t seq;
+	uint32_t state;
+	uint32_t max_addrs;
+	uint32_t count;
+	volatile uint32_t heartbeat;
+
+	// Addresses in ascending order
+	struct in6_addr addrs[];
+};
+
+// Times a reader checks for sisisd to finish a change (about a millisecond)
+// before treating the registry as unavailable
+#define SISIS_REGISTRY_MAX_SPINS 4096
+
+/** Size of a registry segment. */
+#define SISIS_REGISTRY_SIZE(max_addrs) (sizeof(struct sisis_registry) + (size_t)(max_addrs) * sizeof(struct in6_addr))
+
+/**
+ * Maps the registry.  Safe to call more than once.
+ *
+ * Returns zero if the registry is mapped and being kept current.
+ */
+int sisis_registry_open(void);
+
+/**
+ * Get registered addresses under a prefix.  The prefix must lie within the
+ * SIS-IS prefix.  *addrs is set to an array the caller must free.
+ *
+ * Returns the number of addresses or -1 if the registry is unavailable.
+ */
+int sisis_registry_get(const struct in6_addr * prefix, int prefixlen, struct in6_addr ** addrs);
+
+/** Count registered addresses under a prefix, or -1 if the registry is unavailable. */
+int sisis_registry_count(const struct in6_addr * prefix, int prefixlen);
+
+/** Checks whether a prefix can be answered from the registry. */
+static inline int sisis_registry_covers(const struct in6_addr * prefix, int prefixlen)
+{
+	return prefixlen >= SISIS_REGISTRY_PREFIX_LEN && ((prefix->s6_addr[0] << 8) | prefix->s6_addr[1]) == SISIS_REGISTRY_PREFIX;
+}
+
+#endif